@@ -1,318 +1,2677 @@
-#include "SQLite.h"
-
-bool momo::SQLite3::isThreadSafe()
-{
-	return sqlite3_threadsafe();
-}
-
-momo::SQLite3::SQLite3()
-	: _database(nullptr), _success(true), _isOpen(false)
-{
-	 
-}
-
-momo::SQLite3::SQLite3(sqlite3* database, const std::string& name)
-	: _name(name), _database(database), _success(true), _isOpen(true)
-{
-
-}
-
-momo::SQLite3::SQLite3(const std::string& name)
-	: _success(true), _isOpen(true)
-{
-	open(name);
-}
-
-bool momo::SQLite3::isOpen() const
-{
-	return _isOpen;
-}
-
-bool momo::SQLite3::success() const
-{
-	return _success;
-}
-
-const std::string& momo::SQLite3::getErrorMessage() const
-{
-	return _errorMessage;
-}
-
-bool momo::SQLite3::open(const std::string& name)
-{
-	close();
-	_name = name;
-	if (sqlite3_open(_name.c_str(), &_database))
-	{
-		_errorMessage = std::string(sqlite3_errmsg(_database));
-		_isOpen = false;
-	}
-	return _isOpen;
-}
-
-bool momo::SQLite3::execute(const std::string& SQL)
-{
-	return execute(SQL, nullptr, nullptr);
-}
-
-bool momo::SQLite3::execute(const std::string& SQL, momo::sqlite3_callback function, momo::callback_arg arg)
-{
-	char* error;
-	_success = true;
-	if (sqlite3_exec(_database, SQL.c_str(), function, arg, &error))
-	{
-		_errorMessage = std::string(error);
-		_success = false;
-		sqlite3_free(error);
-	}
-	return _success;
-}
-
-momo::SQLite3& momo::SQLite3::operator<<(const std::string& SQL)
-{
-	execute(SQL);
-	return *this;
-}
-
-void momo::SQLite3::close()
-{
-	if (_isOpen)
-	{
-		sqlite3_close(_database);
-	}
-}
-
-momo::SQLite3::~SQLite3()
-{
-	close();
-}
-
-const char* momo::convertType(momo::TYPE type)
-{
-	switch (type)
-	{
-	case momo::TYPE::INT:
-		return "INT";
-	case momo::TYPE::TEXT:
-		return "TEXT";
-	case momo::TYPE::NUMERIC:
-		return "NUMERIC";
-	case momo::TYPE::REAL:
-		return "REAL";
-	case momo::TYPE::BLOB:
-		return "BLOB";
-	}
-	return "TEXT";
-}
-
-momo::SQLBuilder<momo::OPERATION::CREATE>::SQLBuilder()
-	: tableName("UNNAMED")
-{
-
-}
-
-momo::SQLBuilder<momo::OPERATION::CREATE>::SQLBuilder(std::string tableName)
-	: tableName(std::move(tableName))
-{
-
-}
-
-momo::SQLBuilder<momo::OPERATION::ALTER>& momo::SQLBuilder<momo::OPERATION::ALTER>::rename(const std::string newName)
-{
-	_newName = newName;
-	return *this;
-}
-
-momo::SQLBuilder<momo::OPERATION::ALTER>& momo::SQLBuilder<momo::OPERATION::ALTER>::addColumn(const std::string& name, TYPE type, bool isNull)
-{
-	addColumn(name, convertType(type), isNull);
-	return *this;
-}
-
-momo::SQLBuilder<momo::OPERATION::ALTER>& momo::SQLBuilder<momo::OPERATION::ALTER>::addColumn(const std::string& name, const std::string& type, bool isNull)
-{
-	const char* IsNULL = (isNull == NULL ? " NULL" : " NOT NULL");
-	std::string column = name + ' ' + type + IsNULL;
-	_newColumns.push_back(std::move(column));
-	return *this;
-}
-
-momo::SQLBuilder<momo::OPERATION::ALTER>& momo::SQLBuilder<momo::OPERATION::ALTER>::renameColumn(const std::string& columnName, const std::string& newColumnName)
-{
-	_renamedColumns.push_back({ columnName, newColumnName });
-	return *this;
-}
-
-momo::SQLBuilder<momo::OPERATION::ALTER>::SQLBuilder(std::string tableName)
-	: _tableName(std::move(tableName))
-{
-
-}
-
-momo::SQLBuilder<momo::OPERATION::CREATE>& momo::SQLBuilder<momo::OPERATION::CREATE>::addColumn(const std::string& name, TYPE type, bool isNull, bool isPrimaryKey)
-{
-	addColumn(name, convertType(type), isNull, isPrimaryKey);
-	return *this;
-}
-
-momo::SQLBuilder<momo::OPERATION::CREATE>& momo::SQLBuilder<momo::OPERATION::CREATE>::addColumn(const std::string& name, const std::string& type, bool isNull, bool isPrimaryKey)
-{
-	const char* IsNULL = (isNull == NULL ? " NULL" : " NOT NULL");
-	const char* IsKEY = (isPrimaryKey == momo::PRIMARY_KEY ? " PRIMARY KEY" : "");
-	*this << (name + ' ' + type + IsNULL + IsKEY);
-	return *this;
-}
-
-momo::SQLBuilder<momo::OPERATION::CREATE>& momo::SQLBuilder<momo::OPERATION::CREATE>::operator<<(std::string column)
-{
-	if(!_columns.empty()) _columns.back() += ',';
-	_columns.push_back(std::move(column));
-	return *this;
-}
-
-momo::SQLBuilder<momo::OPERATION::CREATE>::operator std::string() const
-{
-	std::stringstream SQL;
-	SQL << "CREATE TABLE " << tableName << '(';
-	for (const auto& column : _columns)
-	{
-		SQL << column;
-	}
-	SQL << ");";
-	return SQL.str();
-}
-
-momo::SQLBuilder<momo::OPERATION::DELETE>::operator std::string() const
-{
-	std::stringstream SQL;
-	SQL << "DELETE FROM " << _tableName << " WHERE " << _whereExpression << ';';
-	return SQL.str();
-}
-
-momo::SQLite3& momo::operator<<(SQLite3& database, const SQLBuilder<OPERATION::ALTER>& sql)
-{
-	std::string alterString = "ALTER TABLE " + sql._tableName;
-	if (!sql._newName.empty())
-	{
-		if (!database.execute(alterString + " RENAME TO " + sql._newName + ';'))
-			return database;
-	}
-
-	for (const auto& column : sql._newColumns)
-	{
-		if (!database.execute(alterString + " ADD " + column + ';'))
-			return database;
-	}
-	for (const auto& columnPair : sql._renamedColumns)
-	{
-		if(!database.execute(alterString + " RENAME COLUMN " + columnPair.first + " TO " + columnPair.second + ';'))
-			return database;
-	}
-	return database;
-}
-
-momo::SQLBuilder<momo::OPERATION::INSERT>::SQLBuilder(const std::string& tableName, const std::string& values)
-	: _insertionLine("INSERT INTO " + tableName + '(' + values + ')')
-{
-
-}
-
-momo::SQLBuilder<momo::OPERATION::INSERT>::operator std::string() const
-{
-	std::stringstream SQL;
-	for (const auto& value : _values)
-	{
-		SQL << _insertionLine;
-		SQL << value;
-	}
-	return SQL.str();
-}
-
-momo::SQLBuilder<momo::OPERATION::INSERT>& momo::SQLBuilder<momo::OPERATION::INSERT>::addValues(std::string values)
-{
-	_values.push_back("VALUES (" + values + ");");
-	return *this;
-}
-
-momo::SQLBuilder<momo::OPERATION::SELECT>::SQLBuilder(std::string tableName)
-	: _tableName(std::move(tableName)), _columns(), callback(nullptr), callbackArg(nullptr)
-{
-
-}
-
-momo::SQLBuilder<momo::OPERATION::SELECT>::SQLBuilder(std::string tableName, std::string columns)
-	: _tableName(std::move(tableName)), _columns(std::move(columns)), callback(nullptr), callbackArg(nullptr)
-{
-
-}
-
-momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::addColumn(const std::string& columnName)
-{
-	if (!_columns.empty()) _columns += ',';
-	_columns += columnName;
-	return *this;
-}
-
-momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::addColumn(const std::string& columnName, const std::string& alias)
-{
-	if (!_columns.empty()) _columns += ',';
-	_columns += columnName + " AS " + alias;
-	return *this;
-}
-
-momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::where(const std::string& whereExpression)
-{
-	if (!_whereExpression.empty()) _whereExpression += "AND";
-	_whereExpression += '(' + whereExpression + ')';
-	return *this;
-}
-
-momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::orderBy(const std::string& column, momo::ORDER order)
-{
-	if (!_orderExpression.empty()) _orderExpression += ',';
-	_orderExpression += column + (order == ORDER::ASC ? " ASC" : " DESC");
-	return *this;
-}
-
-momo::SQLBuilder<momo::OPERATION::SELECT>::operator std::string() const
-{
-	std::stringstream SQL;
-	SQL << "SELECT " << (_columns.empty() ? "*" : _columns);
-	SQL << " FROM " << _tableName;
-	if (!_whereExpression.empty()) SQL << " WHERE " << _whereExpression;
-	if (!_orderExpression.empty()) SQL << " ORDER BY " << _orderExpression;
-	SQL << ';';
-	return SQL.str();
-}
-
-momo::SQLBuilder<momo::OPERATION::DROP>::SQLBuilder(std::string tableName)
-	: _tableName(std::move(tableName))
-{
-
-}
-
-momo::SQLBuilder<momo::OPERATION::DELETE>::SQLBuilder(std::string tableName)
-	: _tableName(std::move(tableName))
-{
-
-}
-
-momo::SQLBuilder<momo::OPERATION::DELETE>& momo::SQLBuilder<momo::OPERATION::DELETE>::where(const std::string& whereExpression)
-{
-	if (!_whereExpression.empty()) _whereExpression += "AND";
-	_whereExpression += '(' + whereExpression + ')';
-	return *this;
-}
-
-momo::SQLBuilder<momo::OPERATION::DROP>::operator std::string() const
-{
-	std::stringstream SQL;
-	SQL << "DROP TABLE " << _tableName << ';';
-	return SQL.str();
-}
-
-momo::SQLite3& momo::operator<<(SQLite3& database, const SQLBuilder<OPERATION::SELECT>& sql)
-{
-	database.execute(sql, sql.callback, sql.callbackArg);
-	return database;
+#include "SQLite.h"
+#include <cstring>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+	/*
+	virtual table instance created for each connection which uses TableView
+	*/
+	struct ViewTable
+	{
+		sqlite3_vtab base;
+		const momo::detail::ViewDefinition* definition;
+	};
+
+	/*
+	cursor iterating half-open range [row, end) of viewed rows
+	*/
+	struct ViewCursor
+	{
+		sqlite3_vtab_cursor base;
+		size_t row;
+		size_t end;
+	};
+
+	/*
+	bits of idxNum passed from xBestIndex to xFilter, one bit for each constraint on the key column
+	arguments are passed to xFilter in the same order as bits
+	*/
+	enum ViewConstraint
+	{
+		VIEW_EQ = 1,
+		VIEW_GT = 2,
+		VIEW_GE = 4,
+		VIEW_LT = 8,
+		VIEW_LE = 16,
+	};
+
+	int viewConnect(sqlite3* database, void* aux, int, const char* const*, sqlite3_vtab** vtab, char**)
+	{
+		auto definition = static_cast<const momo::detail::ViewDefinition*>(aux);
+		std::string schema = "CREATE TABLE x(";
+		for (size_t i = 0; i < definition->columns.size(); i++)
+		{
+			if (i != 0) schema += ',';
+			schema += '"' + definition->columns[i].name + "\" " + definition->columns[i].type;
+		}
+		schema += ')';
+		int code = sqlite3_declare_vtab(database, schema.c_str());
+		if (code != SQLITE_OK) return code;
+
+		auto table = static_cast<ViewTable*>(sqlite3_malloc(sizeof(ViewTable)));
+		if (table == nullptr) return SQLITE_NOMEM;
+		memset(table, 0, sizeof(ViewTable));
+		table->definition = definition;
+		*vtab = &table->base;
+		return SQLITE_OK;
+	}
+
+	int viewDisconnect(sqlite3_vtab* vtab)
+	{
+		sqlite3_free(vtab);
+		return SQLITE_OK;
+	}
+
+	int viewBestIndex(sqlite3_vtab* vtab, sqlite3_index_info* info)
+	{
+		auto definition = reinterpret_cast<ViewTable*>(vtab)->definition;
+		const std::pair<int, int> operators[] = {
+			{ SQLITE_INDEX_CONSTRAINT_EQ, VIEW_EQ },
+			{ SQLITE_INDEX_CONSTRAINT_GT, VIEW_GT },
+			{ SQLITE_INDEX_CONSTRAINT_GE, VIEW_GE },
+			{ SQLITE_INDEX_CONSTRAINT_LT, VIEW_LT },
+			{ SQLITE_INDEX_CONSTRAINT_LE, VIEW_LE },
+		};
+		int constraints[5] = { -1, -1, -1, -1, -1 };
+		for (int i = 0; i < info->nConstraint; i++)
+		{
+			const auto& constraint = info->aConstraint[i];
+			if (!constraint.usable || constraint.iColumn != definition->keyColumn || definition->keyColumn < 0)
+				continue;
+			for (int j = 0; j < 5; j++)
+			{
+				if (constraint.op == operators[j].first && constraints[j] < 0) constraints[j] = i;
+			}
+		}
+		// equality makes range constraints redundant
+		if (constraints[0] >= 0)
+		{
+			for (int j = 1; j < 5; j++) constraints[j] = -1;
+		}
+
+		int idxNum = 0;
+		int argument = 0;
+		for (int j = 0; j < 5; j++)
+		{
+			if (constraints[j] < 0) continue;
+			idxNum |= operators[j].second;
+			info->aConstraintUsage[constraints[j]].argvIndex = ++argument;
+			info->aConstraintUsage[constraints[j]].omit = 1;
+		}
+		info->idxNum = idxNum;
+
+		double rows = (double)definition->rowCount;
+		double search = 1.0;
+		for (size_t n = definition->rowCount; n > 1; n /= 2) search += 1.0;
+		if (idxNum & VIEW_EQ)
+		{
+			info->estimatedCost = search;
+			info->estimatedRows = 1;
+		}
+		else if (idxNum != 0)
+		{
+			bool bounded = (idxNum & (VIEW_GT | VIEW_GE)) && (idxNum & (VIEW_LT | VIEW_LE));
+			info->estimatedCost = search + rows / (bounded ? 8 : 4);
+			info->estimatedRows = (sqlite3_int64)(rows / (bounded ? 8 : 4)) + 1;
+		}
+		else
+		{
+			info->estimatedCost = rows + 1;
+			info->estimatedRows = (sqlite3_int64)rows + 1;
+		}
+
+		// rows are already sorted by the key
+		if (info->nOrderBy == 1 && info->aOrderBy[0].iColumn == definition->keyColumn && !info->aOrderBy[0].desc)
+		{
+			info->orderByConsumed = 1;
+		}
+		return SQLITE_OK;
+	}
+
+	int viewOpen(sqlite3_vtab*, sqlite3_vtab_cursor** cursor)
+	{
+		auto viewCursor = static_cast<ViewCursor*>(sqlite3_malloc(sizeof(ViewCursor)));
+		if (viewCursor == nullptr) return SQLITE_NOMEM;
+		memset(viewCursor, 0, sizeof(ViewCursor));
+		*cursor = &viewCursor->base;
+		return SQLITE_OK;
+	}
+
+	int viewClose(sqlite3_vtab_cursor* cursor)
+	{
+		sqlite3_free(cursor);
+		return SQLITE_OK;
+	}
+
+	/*
+	returns index of first row in [begin, end) for which compare(row, value) > 0 (upper = true) or >= 0 (upper = false)
+	*/
+	size_t viewSearch(const momo::detail::ViewDefinition* definition, size_t begin, size_t end, sqlite3_value* value, bool upper)
+	{
+		const auto& compare = definition->columns[definition->keyColumn].compare;
+		while (begin < end)
+		{
+			size_t middle = begin + (end - begin) / 2;
+			int order = compare(definition->data + middle * definition->rowSize, value);
+			if (order < 0 || (upper && order == 0)) begin = middle + 1;
+			else end = middle;
+		}
+		return begin;
+	}
+
+	int viewFilter(sqlite3_vtab_cursor* cursor, int idxNum, const char*, int argc, sqlite3_value** argv)
+	{
+		auto viewCursor = reinterpret_cast<ViewCursor*>(cursor);
+		auto definition = reinterpret_cast<ViewTable*>(cursor->pVtab)->definition;
+		size_t begin = 0;
+		size_t end = definition->rowCount;
+		int argument = 0;
+		for (int bit = VIEW_EQ; bit <= VIEW_LE && argument < argc; bit <<= 1)
+		{
+			if (!(idxNum & bit)) continue;
+			sqlite3_value* value = argv[argument++];
+			// comparison with NULL is never true
+			if (sqlite3_value_type(value) == SQLITE_NULL)
+			{
+				begin = end;
+				break;
+			}
+			switch (bit)
+			{
+			case VIEW_EQ:
+				begin = viewSearch(definition, begin, end, value, false);
+				end = viewSearch(definition, begin, end, value, true);
+				break;
+			case VIEW_GT:
+				begin = viewSearch(definition, begin, end, value, true);
+				break;
+			case VIEW_GE:
+				begin = viewSearch(definition, begin, end, value, false);
+				break;
+			case VIEW_LT:
+				end = viewSearch(definition, begin, end, value, false);
+				break;
+			case VIEW_LE:
+				end = viewSearch(definition, begin, end, value, true);
+				break;
+			}
+		}
+		viewCursor->row = begin;
+		viewCursor->end = std::max(begin, end);
+		return SQLITE_OK;
+	}
+
+	int viewNext(sqlite3_vtab_cursor* cursor)
+	{
+		reinterpret_cast<ViewCursor*>(cursor)->row++;
+		return SQLITE_OK;
+	}
+
+	int viewEof(sqlite3_vtab_cursor* cursor)
+	{
+		auto viewCursor = reinterpret_cast<ViewCursor*>(cursor);
+		return viewCursor->row >= viewCursor->end;
+	}
+
+	int viewColumn(sqlite3_vtab_cursor* cursor, sqlite3_context* context, int column)
+	{
+		auto viewCursor = reinterpret_cast<ViewCursor*>(cursor);
+		auto definition = reinterpret_cast<ViewTable*>(cursor->pVtab)->definition;
+		definition->columns[column].result(definition->data + viewCursor->row * definition->rowSize, context);
+		return SQLITE_OK;
+	}
+
+	int viewRowid(sqlite3_vtab_cursor* cursor, sqlite3_int64* rowid)
+	{
+		*rowid = (sqlite3_int64)reinterpret_cast<ViewCursor*>(cursor)->row;
+		return SQLITE_OK;
+	}
+
+	void viewDestroyDefinition(void* definition)
+	{
+		delete static_cast<momo::detail::ViewDefinition*>(definition);
+	}
+
+	/*
+	eponymous-only module: xCreate is NULL, so table exists as soon as module is registered
+	*/
+	const sqlite3_module viewModule = {
+		0, // iVersion
+		nullptr, // xCreate: eponymous-only, cannot be created by CREATE VIRTUAL TABLE
+		viewConnect, // xConnect
+		viewBestIndex, // xBestIndex
+		viewDisconnect, // xDisconnect
+		nullptr, // xDestroy
+		viewOpen, // xOpen
+		viewClose, // xClose
+		viewFilter, // xFilter
+		viewNext, // xNext
+		viewEof, // xEof
+		viewColumn, // xColumn
+		viewRowid, // xRowid
+		nullptr, // xUpdate: read-only
+		nullptr, // xBegin
+		nullptr, // xSync
+		nullptr, // xCommit
+		nullptr, // xRollback
+		nullptr, // xFindFunction
+		nullptr, // xRename
+		nullptr, // xSavepoint
+		nullptr, // xRelease
+		nullptr, // xRollbackTo
+		nullptr, // xShadowName
+	};
+
+	/*
+	SQLite orders values of different types as NULL < INTEGER, REAL < TEXT < BLOB
+	*/
+	int typeRank(int type)
+	{
+		switch (type)
+		{
+		case SQLITE_NULL:
+			return 0;
+		case SQLITE_INTEGER:
+		case SQLITE_FLOAT:
+			return 1;
+		case SQLITE_TEXT:
+			return 2;
+		}
+		return 3;
+	}
+
+	template<typename T>
+	int compareNumbers(T key, T value)
+	{
+		return key < value ? -1 : (value < key ? 1 : 0);
+	}
+
+	int compareText(const char* key, size_t keySize, sqlite3_value* value)
+	{
+		int type = sqlite3_value_type(value);
+		// column has TEXT affinity, so numbers are compared as text
+		if (type != SQLITE_INTEGER && type != SQLITE_FLOAT && type != SQLITE_TEXT)
+			return compareNumbers(typeRank(SQLITE_TEXT), typeRank(type));
+
+		auto text = reinterpret_cast<const char*>(sqlite3_value_text(value));
+		size_t textSize = (size_t)sqlite3_value_bytes(value);
+		int order = memcmp(key, text, std::min(keySize, textSize));
+		if (order != 0) return order;
+		return compareNumbers(keySize, textSize);
+	}
+
+	/*
+	name of pointer type used to bind Value::Array with sqlite3_bind_pointer()
+	*/
+	const char* const arrayPointerType = "momo_array";
+
+	/*
+	cursor of momo_array() table-valued function
+	*/
+	struct ArrayCursor
+	{
+		sqlite3_vtab_cursor base;
+		const momo::Value::Array* array;
+		size_t row;
+	};
+
+	int arrayConnect(sqlite3* database, void*, int, const char* const*, sqlite3_vtab** vtab, char**)
+	{
+		int code = sqlite3_declare_vtab(database, "CREATE TABLE x(value, pointer HIDDEN)");
+		if (code != SQLITE_OK) return code;
+
+		*vtab = static_cast<sqlite3_vtab*>(sqlite3_malloc(sizeof(sqlite3_vtab)));
+		if (*vtab == nullptr) return SQLITE_NOMEM;
+		memset(*vtab, 0, sizeof(sqlite3_vtab));
+		return SQLITE_OK;
+	}
+
+	int arrayBestIndex(sqlite3_vtab*, sqlite3_index_info* info)
+	{
+		for (int i = 0; i < info->nConstraint; i++)
+		{
+			const auto& constraint = info->aConstraint[i];
+			if (constraint.iColumn == 1 && constraint.op == SQLITE_INDEX_CONSTRAINT_EQ && constraint.usable)
+			{
+				info->aConstraintUsage[i].argvIndex = 1;
+				info->aConstraintUsage[i].omit = 1;
+				info->idxNum = 1;
+				info->estimatedCost = 1;
+				info->estimatedRows = 100;
+				return SQLITE_OK;
+			}
+		}
+		// without array pointer the function produces no rows
+		info->idxNum = 0;
+		info->estimatedCost = 1e99;
+		info->estimatedRows = 1;
+		return SQLITE_OK;
+	}
+
+	int arrayOpen(sqlite3_vtab*, sqlite3_vtab_cursor** cursor)
+	{
+		auto arrayCursor = static_cast<ArrayCursor*>(sqlite3_malloc(sizeof(ArrayCursor)));
+		if (arrayCursor == nullptr) return SQLITE_NOMEM;
+		memset(arrayCursor, 0, sizeof(ArrayCursor));
+		*cursor = &arrayCursor->base;
+		return SQLITE_OK;
+	}
+
+	int arrayFilter(sqlite3_vtab_cursor* cursor, int idxNum, const char*, int argc, sqlite3_value** argv)
+	{
+		auto arrayCursor = reinterpret_cast<ArrayCursor*>(cursor);
+		arrayCursor->array = nullptr;
+		arrayCursor->row = 0;
+		if (idxNum == 1 && argc == 1)
+		{
+			arrayCursor->array = static_cast<const momo::Value::Array*>(sqlite3_value_pointer(argv[0], arrayPointerType));
+		}
+		return SQLITE_OK;
+	}
+
+	int arrayNext(sqlite3_vtab_cursor* cursor)
+	{
+		reinterpret_cast<ArrayCursor*>(cursor)->row++;
+		return SQLITE_OK;
+	}
+
+	int arrayEof(sqlite3_vtab_cursor* cursor)
+	{
+		auto arrayCursor = reinterpret_cast<ArrayCursor*>(cursor);
+		return arrayCursor->array == nullptr || arrayCursor->row >= arrayCursor->array->count;
+	}
+
+	int arrayColumn(sqlite3_vtab_cursor* cursor, sqlite3_context* context, int column)
+	{
+		auto arrayCursor = reinterpret_cast<ArrayCursor*>(cursor);
+		const momo::Value::Array* array = arrayCursor->array;
+		if (column != 0)
+		{
+			sqlite3_result_null(context);
+			return SQLITE_OK;
+		}
+		// elements are alive while statement is executed, so no copy is needed
+		switch (array->element)
+		{
+		case momo::Value::Array::INT64:
+			sqlite3_result_int64(context, static_cast<const std::int64_t*>(array->data)[arrayCursor->row]);
+			break;
+		case momo::Value::Array::STRING:
+		{
+			const std::string& text = static_cast<const std::string*>(array->data)[arrayCursor->row];
+			sqlite3_result_text(context, text.data(), (int)text.size(), SQLITE_STATIC);
+			break;
+		}
+		case momo::Value::Array::STRING_VIEW:
+		{
+			std::string_view text = static_cast<const std::string_view*>(array->data)[arrayCursor->row];
+			sqlite3_result_text(context, text.data(), (int)text.size(), SQLITE_STATIC);
+			break;
+		}
+		}
+		return SQLITE_OK;
+	}
+
+	int arrayRowid(sqlite3_vtab_cursor* cursor, sqlite3_int64* rowid)
+	{
+		*rowid = (sqlite3_int64)reinterpret_cast<ArrayCursor*>(cursor)->row;
+		return SQLITE_OK;
+	}
+
+	/*
+	eponymous-only module of momo_array() table-valued function, registered for every opened database
+	*/
+	const sqlite3_module arrayModule = {
+		0, // iVersion
+		nullptr, // xCreate: eponymous-only, cannot be created by CREATE VIRTUAL TABLE
+		arrayConnect, // xConnect
+		arrayBestIndex, // xBestIndex
+		viewDisconnect, // xDisconnect
+		nullptr, // xDestroy
+		arrayOpen, // xOpen
+		viewClose, // xClose
+		arrayFilter, // xFilter
+		arrayNext, // xNext
+		arrayEof, // xEof
+		arrayColumn, // xColumn
+		arrayRowid, // xRowid
+		nullptr, // xUpdate: read-only
+		nullptr, // xBegin
+		nullptr, // xSync
+		nullptr, // xCommit
+		nullptr, // xRollback
+		nullptr, // xFindFunction
+		nullptr, // xRename
+		nullptr, // xSavepoint
+		nullptr, // xRelease
+		nullptr, // xRollbackTo
+		nullptr, // xShadowName
+	};
+
+	/*
+	calls sqlite3_exec-like callback with the current row of statement
+	returns value returned by callback
+	*/
+	int invokeCallback(momo::sqlite3_callback function, momo::callback_arg arg, const momo::Statement& statement)
+	{
+		int count = statement.columnCount();
+		std::vector<char*> values(count);
+		std::vector<char*> names(count);
+		for (int i = 0; i < count; i++)
+		{
+			values[i] = const_cast<char*>(statement.columnText(i));
+			names[i] = const_cast<char*>(statement.columnName(i));
+		}
+		return function(arg, count, values.data(), names.data());
+	}
+
+	/*
+	returns delay before retry number count (starting from 0) of busy policy, randomized by its jitter
+	*/
+	std::chrono::microseconds backoffDelay(const momo::BusyPolicy& policy, int count, std::uint64_t& random)
+	{
+		double delay = (double)policy.initialDelay.count();
+		for (int i = 0; i < count && delay < (double)policy.maxDelay.count(); i++)
+			delay *= policy.multiplier;
+		if (delay > (double)policy.maxDelay.count()) delay = (double)policy.maxDelay.count();
+
+		// xorshift64, quality of random numbers is not important here
+		random ^= random << 13;
+		random ^= random >> 7;
+		random ^= random << 17;
+		double jitter = (double)(random >> 11) / (double)(1ull << 53);
+		delay -= delay * policy.jitter * jitter;
+		return std::chrono::microseconds((long long)delay);
+	}
+
+	std::uint64_t randomSeed(const void* object)
+	{
+		return ((std::uint64_t)std::chrono::steady_clock::now().time_since_epoch().count() ^ (std::uint64_t)(std::uintptr_t)object) | 1;
+	}
+
+	bool isLockError(int code)
+	{
+		code &= 0xff;
+		return code == SQLITE_BUSY || code == SQLITE_LOCKED;
+	}
+
+	void freeArray(void* array)
+	{
+		delete static_cast<momo::Value::Array*>(array);
+	}
+
+	void notifyStep(momo::detail::HookState& hooks, sqlite3_stmt* statement, bool finished, int result)
+	{
+		std::lock_guard<std::mutex> lock(hooks.mutex);
+		for (auto& hook : hooks.step) hook.second(statement, finished, result);
+	}
+
+	/*
+	length-prefixed field of cursor token: {type}{length}:{bytes}
+	*/
+	void writeCursorField(std::string& out, char type, const std::string& bytes)
+	{
+		out += type;
+		out += std::to_string(bytes.size());
+		out += ':';
+		out += bytes;
+	}
+
+	bool readCursorField(const std::string& in, size_t& position, char& type, std::string& bytes)
+	{
+		if (position >= in.size()) return false;
+		type = in[position++];
+		size_t length = 0, digits = 0;
+		while (position < in.size() && std::isdigit((unsigned char)in[position]) && digits++ < 10)
+			length = length * 10 + (size_t)(in[position++] - '0');
+		if (digits == 0 || position >= in.size() || in[position++] != ':' || in.size() - position < length) return false;
+		bytes = in.substr(position, length);
+		position += length;
+		return true;
+	}
+}
+
+
+bool momo::SQLite3::isThreadSafe()
+{
+	return sqlite3_threadsafe();
+}
+
+momo::SQLite3::SQLite3()
+	: _database(nullptr), _success(true), _isOpen(false), _lastVMSteps(0)
+{
+	 
+}
+
+momo::SQLite3::SQLite3(sqlite3* database, const std::string& name)
+	: _name(name), _database(database), _success(true), _isOpen(true), _lastVMSteps(0)
+{
+	sqlite3_create_module_v2(_database, arrayPointerType, &arrayModule, nullptr, nullptr);
+	installHooks();
+}
+
+momo::SQLite3::SQLite3(const std::string& name)
+	: _success(true), _database(nullptr), _isOpen(false), _lastVMSteps(0)
+{
+	open(name);
+}
+
+bool momo::SQLite3::isOpen() const
+{
+	return _isOpen;
+}
+
+sqlite3* momo::SQLite3::handle() const
+{
+	return _database;
+}
+
+const std::string& momo::SQLite3::getName() const
+{
+	return _name;
+}
+
+bool momo::SQLite3::success() const
+{
+	return _success;
+}
+
+const std::string& momo::SQLite3::getErrorMessage() const
+{
+	return _errorMessage;
+}
+
+bool momo::SQLite3::open(const std::string& name)
+{
+	return open(name, OpenOptions());
+}
+
+bool momo::SQLite3::open(const std::string& name, const OpenOptions& options)
+{
+	close();
+	_name = name;
+	_options = options;
+	const char* vfs = options.vfs.empty() ? nullptr : options.vfs.c_str();
+	if (sqlite3_open_v2(_name.c_str(), &_database, options.flags, vfs))
+	{
+		_errorMessage = std::string(sqlite3_errmsg(_database));
+		sqlite3_close(_database);
+		_database = nullptr;
+		_isOpen = false;
+		return _isOpen;
+	}
+	_isOpen = true;
+	if (options.lookasideSlotSize > 0 && options.lookasideSlotCount > 0)
+	{
+		sqlite3_db_config(_database, SQLITE_DBCONFIG_LOOKASIDE, nullptr, options.lookasideSlotSize, options.lookasideSlotCount);
+	}
+	sqlite3_create_module_v2(_database, arrayPointerType, &arrayModule, nullptr, nullptr);
+	if (_busy.installed) sqlite3_busy_handler(_database, busyHandler, this);
+	installHooks();
+	return _isOpen;
+}
+
+const momo::OpenOptions& momo::SQLite3::getOpenOptions() const
+{
+	return _options;
+}
+
+bool momo::SQLite3::execute(const std::string& SQL)
+{
+	return execute(SQL, nullptr, nullptr);
+}
+
+bool momo::SQLite3::execute(const std::string& SQL, momo::sqlite3_callback function, momo::callback_arg arg)
+{
+	// statements are stepped by wrapper rather than sqlite3_exec, so step hooks see them
+	if (_hooks.stepHooks.load(std::memory_order_relaxed) > 0)
+		return execute(SQL, std::vector<Value>(), QueryLimits(), function, arg);
+
+	char* error;
+	_success = true;
+	if (sqlite3_exec(_database, SQL.c_str(), function, arg, &error))
+	{
+		_errorMessage = std::string(error);
+		_success = false;
+		sqlite3_free(error);
+	}
+	return _success;
+}
+
+bool momo::SQLite3::createTableView(const std::string& name, const detail::ViewDefinition& definition)
+{
+	auto copy = new detail::ViewDefinition(definition);
+	return checkResult(sqlite3_create_module_v2(_database, name.c_str(), &viewModule, copy, viewDestroyDefinition));
+}
+
+bool momo::SQLite3::execute(const std::string& SQL, const std::vector<Value>& parameters, momo::sqlite3_callback function, momo::callback_arg arg)
+{
+	return execute(SQL, parameters, QueryLimits(), function, arg);
+}
+
+bool momo::SQLite3::execute(const std::string& SQL, const std::vector<Value>& parameters, const QueryLimits& limits, momo::sqlite3_callback function, momo::callback_arg arg)
+{
+	bool limited = limits.timeout.count() > 0 || limits.token != nullptr || limits.maxSteps > 0;
+	auto deadline = std::chrono::steady_clock::now() + limits.timeout;
+	_lastVMSteps = 0;
+
+	const char* tail = SQL.c_str();
+	bool first = true;
+	while (*tail != '\0')
+	{
+		sqlite3_stmt* handle = nullptr;
+		if (!checkResult(sqlite3_prepare_v2(_database, tail, -1, &handle, &tail)))
+			return _success;
+		// whitespace or comment at the end of SQL
+		if (handle == nullptr)
+			break;
+
+		Statement statement(handle, &_hooks);
+		if (!first && !parameters.empty() && sqlite3_bind_parameter_count(handle) > 0)
+		{
+			// statements after the first would silently see the same values or NULLs
+			_errorMessage = "parameters can be bound only to the first command of SQL";
+			_success = false;
+			return _success;
+		}
+		int count = first ? std::min((int)parameters.size(), sqlite3_bind_parameter_count(handle)) : 0;
+		first = false;
+		for (int i = 0; i < count; i++)
+		{
+			if (!statement.bind(i + 1, parameters[i]))
+			{
+				_errorMessage = statement.getErrorMessage();
+				_success = false;
+				return _success;
+			}
+		}
+		if (limited)
+		{
+			// commands of SQL share timeout and step limit
+			QueryLimits remaining = limits;
+			if (limits.timeout.count() > 0)
+			{
+				remaining.timeout = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+				// negative timeout is already expired, zero would mean no limit
+				if (remaining.timeout.count() <= 0) remaining.timeout = std::chrono::milliseconds(-1);
+			}
+			if (limits.maxSteps > 0)
+			{
+				remaining.maxSteps = _lastVMSteps < limits.maxSteps ? limits.maxSteps - _lastVMSteps : 1;
+			}
+			statement.setLimits(remaining);
+		}
+		while (statement.step())
+		{
+			if (function != nullptr && invokeCallback(function, arg, statement) != 0)
+			{
+				_lastVMSteps += statement.vmSteps();
+				_errorMessage = "query aborted";
+				_success = false;
+				return _success;
+			}
+		}
+		_lastVMSteps += statement.vmSteps();
+		if (!statement.success())
+		{
+			_errorMessage = statement.getErrorMessage();
+			_success = false;
+			return _success;
+		}
+	}
+	_success = true;
+	return _success;
+}
+
+std::uint64_t momo::SQLite3::getLastVMSteps() const
+{
+	return _lastVMSteps;
+}
+
+void momo::SQLite3::interrupt()
+{
+	if (_isOpen) sqlite3_interrupt(_database);
+}
+
+void momo::SQLite3::installHooks()
+{
+	if (!_isOpen) return;
+	bool installed, wal, authorizer;
+	bool walChanged, authorizerChanged;
+	int autoCheckpoint;
+	{
+		std::lock_guard<std::mutex> lock(_hooks.mutex);
+		installed = !_hooks.update.empty() || !_hooks.commit.empty() || !_hooks.rollback.empty();
+		wal = !_hooks.wal.empty();
+		authorizer = !_hooks.authorizers.empty();
+		walChanged = wal != _hooks.walInstalled;
+		authorizerChanged = authorizer != _hooks.authorizerInstalled;
+		_hooks.walInstalled = wal;
+		_hooks.authorizerInstalled = authorizer;
+		autoCheckpoint = _hooks.autoCheckpoint;
+	}
+	if (walChanged && wal)
+	{
+		sqlite3_wal_hook(_database, [](void* hooks, sqlite3* handle, const char* name, int pages)
+		{
+			auto state = static_cast<detail::HookState*>(hooks);
+			int autoCheckpoint;
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				for (auto& hook : state->wal) hook.second(name, pages);
+				autoCheckpoint = state->autoCheckpoint;
+			}
+			// the same as default WAL hook of SQLite
+			if (autoCheckpoint > 0 && pages >= autoCheckpoint) sqlite3_wal_checkpoint(handle, name);
+			return SQLITE_OK;
+		}, &_hooks);
+	}
+	else if (walChanged)
+	{
+		sqlite3_wal_autocheckpoint(_database, autoCheckpoint);
+	}
+	if (authorizerChanged)
+	{
+		if (!authorizer)
+			sqlite3_set_authorizer(_database, nullptr, nullptr);
+		else
+			sqlite3_set_authorizer(_database, [](void* hooks, int action, const char* first, const char* second, const char* database, const char* trigger)
+			{
+				auto state = static_cast<detail::HookState*>(hooks);
+				std::lock_guard<std::mutex> lock(state->mutex);
+				int result = SQLITE_OK;
+				for (auto& hook : state->authorizers)
+				{
+					int code = hook.second(action, first, second, database, trigger);
+					if (code == SQLITE_DENY) return SQLITE_DENY;
+					if (code == SQLITE_IGNORE) result = SQLITE_IGNORE;
+				}
+				return result;
+			}, &_hooks);
+	}
+	// dispatchers lock hook mutex while database mutex is held, so hooks are installed without holding hook mutex
+	if (!installed)
+	{
+		sqlite3_update_hook(_database, nullptr, nullptr);
+		sqlite3_commit_hook(_database, nullptr, nullptr);
+		sqlite3_rollback_hook(_database, nullptr, nullptr);
+		return;
+	}
+	sqlite3_update_hook(_database, [](void* hooks, int operation, const char* database, const char* table, sqlite3_int64 rowid)
+	{
+		auto state = static_cast<detail::HookState*>(hooks);
+		std::lock_guard<std::mutex> lock(state->mutex);
+		for (auto& hook : state->update) hook.second(operation, database, table, rowid);
+	}, &_hooks);
+	sqlite3_commit_hook(_database, [](void* hooks)
+	{
+		auto state = static_cast<detail::HookState*>(hooks);
+		std::lock_guard<std::mutex> lock(state->mutex);
+		for (auto& hook : state->commit) hook.second();
+		return 0;
+	}, &_hooks);
+	sqlite3_rollback_hook(_database, [](void* hooks)
+	{
+		auto state = static_cast<detail::HookState*>(hooks);
+		std::lock_guard<std::mutex> lock(state->mutex);
+		for (auto& hook : state->rollback) hook.second();
+	}, &_hooks);
+}
+
+int momo::SQLite3::addUpdateHook(UpdateHook hook)
+{
+	int id;
+	{
+		std::lock_guard<std::mutex> lock(_hooks.mutex);
+		id = _hooks.nextId++;
+		_hooks.update.emplace_back(id, std::move(hook));
+	}
+	installHooks();
+	return id;
+}
+
+int momo::SQLite3::addCommitHook(CommitHook hook)
+{
+	int id;
+	{
+		std::lock_guard<std::mutex> lock(_hooks.mutex);
+		id = _hooks.nextId++;
+		_hooks.commit.emplace_back(id, std::move(hook));
+	}
+	installHooks();
+	return id;
+}
+
+int momo::SQLite3::addRollbackHook(RollbackHook hook)
+{
+	int id;
+	{
+		std::lock_guard<std::mutex> lock(_hooks.mutex);
+		id = _hooks.nextId++;
+		_hooks.rollback.emplace_back(id, std::move(hook));
+	}
+	installHooks();
+	return id;
+}
+
+int momo::SQLite3::addWalHook(WalHook hook)
+{
+	int id;
+	{
+		std::lock_guard<std::mutex> lock(_hooks.mutex);
+		id = _hooks.nextId++;
+		_hooks.wal.emplace_back(id, std::move(hook));
+	}
+	installHooks();
+	return id;
+}
+
+int momo::SQLite3::addStepHook(StepHook hook)
+{
+	std::lock_guard<std::mutex> lock(_hooks.mutex);
+	int id = _hooks.nextId++;
+	_hooks.step.emplace_back(id, std::move(hook));
+	_hooks.stepHooks = _hooks.step.size();
+	return id;
+}
+
+int momo::SQLite3::addAuthorizer(Authorizer authorizer)
+{
+	int id;
+	{
+		std::lock_guard<std::mutex> lock(_hooks.mutex);
+		id = _hooks.nextId++;
+		_hooks.authorizers.emplace_back(id, std::move(authorizer));
+	}
+	installHooks();
+	return id;
+}
+
+void momo::SQLite3::setAutoCheckpoint(int pages)
+{
+	bool wal;
+	{
+		std::lock_guard<std::mutex> lock(_hooks.mutex);
+		_hooks.autoCheckpoint = pages;
+		wal = _hooks.walInstalled;
+	}
+	if (_isOpen && !wal) sqlite3_wal_autocheckpoint(_database, pages);
+}
+
+int momo::SQLite3::getAutoCheckpoint() const
+{
+	std::lock_guard<std::mutex> lock(_hooks.mutex);
+	return _hooks.autoCheckpoint;
+}
+
+void momo::SQLite3::removeHook(int id)
+{
+	{
+		std::lock_guard<std::mutex> lock(_hooks.mutex);
+		auto matches = [id](const auto& hook) { return hook.first == id; };
+		_hooks.update.erase(std::remove_if(_hooks.update.begin(), _hooks.update.end(), matches), _hooks.update.end());
+		_hooks.commit.erase(std::remove_if(_hooks.commit.begin(), _hooks.commit.end(), matches), _hooks.commit.end());
+		_hooks.rollback.erase(std::remove_if(_hooks.rollback.begin(), _hooks.rollback.end(), matches), _hooks.rollback.end());
+		_hooks.wal.erase(std::remove_if(_hooks.wal.begin(), _hooks.wal.end(), matches), _hooks.wal.end());
+		_hooks.authorizers.erase(std::remove_if(_hooks.authorizers.begin(), _hooks.authorizers.end(), matches), _hooks.authorizers.end());
+		_hooks.step.erase(std::remove_if(_hooks.step.begin(), _hooks.step.end(), matches), _hooks.step.end());
+		_hooks.stepHooks = _hooks.step.size();
+	}
+	installHooks();
+}
+
+momo::Statement* momo::detail::StatementCache::find(const std::string& SQL)
+{
+	auto entry = index.find(SQL);
+	if (entry == index.end())
+	{
+		misses++;
+		return nullptr;
+	}
+	hits++;
+	entries.splice(entries.begin(), entries, entry->second);
+	return &entry->second->second;
+}
+
+momo::Statement* momo::detail::StatementCache::insert(const std::string& SQL, Statement statement)
+{
+	while (!entries.empty() && entries.size() >= capacity)
+	{
+		index.erase(entries.back().first);
+		entries.pop_back();
+	}
+	entries.emplace_front(SQL, std::move(statement));
+	index[SQL] = entries.begin();
+	return &entries.front().second;
+}
+
+void momo::detail::StatementCache::clear()
+{
+	index.clear();
+	entries.clear();
+}
+
+bool momo::SQLite3::executeCached(const std::string& SQL, const std::vector<Value>& parameters, momo::sqlite3_callback function, momo::callback_arg arg)
+{
+	Statement uncached;
+	Statement* statement = _statements.capacity != 0 ? _statements.find(SQL) : nullptr;
+	if (statement == nullptr)
+	{
+		sqlite3_stmt* handle = nullptr;
+		const char* tail = nullptr;
+		unsigned int flags = _statements.capacity != 0 ? SQLITE_PREPARE_PERSISTENT : 0;
+		if (!checkResult(sqlite3_prepare_v3(_database, SQL.c_str(), (int)SQL.size(), flags, &handle, &tail)))
+			return _success;
+		uncached = Statement(handle, &_hooks);
+		// whitespace or comment only
+		if (handle == nullptr)
+			return _success;
+		while (*tail == ';' || std::isspace((unsigned char)*tail)) tail++;
+		if (*tail != '\0')
+		{
+			_errorMessage = "cached SQL must contain a single command";
+			_success = false;
+			return _success;
+		}
+		statement = _statements.capacity != 0 ? _statements.insert(SQL, std::move(uncached)) : &uncached;
+	}
+
+	sqlite3_stmt* handle = statement->handle();
+	int count = std::min((int)parameters.size(), sqlite3_bind_parameter_count(handle));
+	_success = true;
+	for (int i = 0; i < count && _success; i++)
+	{
+		if (!statement->bind(i + 1, parameters[i]))
+		{
+			_errorMessage = statement->getErrorMessage();
+			_success = false;
+		}
+	}
+	while (_success && statement->step())
+	{
+		if (function != nullptr && invokeCallback(function, arg, *statement) != 0)
+		{
+			_errorMessage = "query aborted";
+			_success = false;
+		}
+	}
+	if (_success && !statement->success())
+	{
+		_errorMessage = statement->getErrorMessage();
+		_success = false;
+	}
+	// reset releases locks held by the statement, bindings are cleared so arrays are not referenced after return
+	statement->reset();
+	sqlite3_clear_bindings(handle);
+	return _success;
+}
+
+void momo::SQLite3::setStatementCacheSize(size_t size)
+{
+	_statements.capacity = size;
+	while (_statements.entries.size() > size)
+	{
+		_statements.index.erase(_statements.entries.back().first);
+		_statements.entries.pop_back();
+	}
+}
+
+momo::StatementCacheStatistics momo::SQLite3::getStatementCacheStatistics() const
+{
+	StatementCacheStatistics statistics;
+	statistics.hits = _statements.hits;
+	statistics.misses = _statements.misses;
+	statistics.entries = _statements.entries.size();
+	return statistics;
+}
+
+bool momo::SQLite3::prepare(const std::string& SQL, Statement& statement)
+{
+	sqlite3_stmt* handle = nullptr;
+	if (!checkResult(sqlite3_prepare_v2(_database, SQL.c_str(), (int)SQL.size(), &handle, nullptr)))
+		return _success;
+	statement = Statement(handle, &_hooks);
+	return _success;
+}
+
+int momo::SQLite3::busyHandler(void* database, int count)
+{
+	auto& busy = static_cast<SQLite3*>(database)->_busy;
+	auto now = std::chrono::steady_clock::now();
+	// count is zero on the first call for each lock SQLite waits for
+	if (count == 0)
+	{
+		busy.eventStart = now;
+		busy.busyEvents.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - busy.eventStart);
+	auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(busy.policy.maxWait) - elapsed;
+	if (remaining.count() <= 0)
+	{
+		busy.timeouts.fetch_add(1, std::memory_order_relaxed);
+		return 0;
+	}
+
+	auto sleep = backoffDelay(busy.policy, count, busy.random);
+	if (sleep > remaining) sleep = remaining;
+	std::this_thread::sleep_for(sleep);
+
+	auto waited = std::chrono::steady_clock::now() - now;
+	busy.retries.fetch_add(1, std::memory_order_relaxed);
+	busy.waitMicroseconds.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(waited).count(), std::memory_order_relaxed);
+	return 1;
+}
+
+bool momo::SQLite3::setBusyPolicy(const BusyPolicy& policy)
+{
+	_busy.policy = policy;
+	if (_busy.policy.multiplier < 1.0) _busy.policy.multiplier = 1.0;
+	if (_busy.policy.jitter < 0.0) _busy.policy.jitter = 0.0;
+	if (_busy.policy.jitter > 1.0) _busy.policy.jitter = 1.0;
+	if (_busy.random == 0) _busy.random = randomSeed(this);
+	_busy.installed = true;
+	resetBusyStatistics();
+	if (!_isOpen) return _success = true;
+	return checkResult(sqlite3_busy_handler(_database, busyHandler, this));
+}
+
+void momo::SQLite3::clearBusyPolicy()
+{
+	_busy.installed = false;
+	if (_isOpen) sqlite3_busy_handler(_database, nullptr, nullptr);
+}
+
+momo::BusyStatistics momo::SQLite3::getBusyStatistics() const
+{
+	BusyStatistics statistics;
+	statistics.busyEvents = _busy.busyEvents;
+	statistics.retries = _busy.retries;
+	statistics.timeouts = _busy.timeouts;
+	statistics.totalWait = std::chrono::microseconds(_busy.waitMicroseconds);
+	return statistics;
+}
+
+void momo::SQLite3::resetBusyStatistics()
+{
+	_busy.busyEvents = 0;
+	_busy.retries = 0;
+	_busy.timeouts = 0;
+	_busy.waitMicroseconds = 0;
+}
+
+int momo::SQLite3::getErrorCode() const
+{
+	if (!_isOpen) return SQLITE_MISUSE;
+	return sqlite3_errcode(_database);
+}
+
+bool momo::SQLite3::runWriteTransaction(const std::function<bool(Transaction&)>& body, const TransactionPolicy& policy)
+{
+	std::uint64_t random = randomSeed(&body);
+	auto start = std::chrono::steady_clock::now();
+	auto deadline = start + policy.backoff.maxWait;
+	bool locked = false;
+
+	for (int attempt = 1; ; attempt++)
+	{
+		_transactions.attempts.fetch_add(1, std::memory_order_relaxed);
+		if (attempt > 1) _transactions.retries.fetch_add(1, std::memory_order_relaxed);
+
+		bool retry = false;
+		if (!execute("BEGIN IMMEDIATE;"))
+		{
+			if (!isLockError(getErrorCode()))
+			{
+				_transactions.failed.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			retry = true;
+		}
+		else
+		{
+			if (!locked)
+			{
+				locked = true;
+				long long wait = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+				size_t bucket = 0;
+				while (bucket < TransactionStatistics::LOCK_WAIT_BOUNDS.size() && wait >= TransactionStatistics::LOCK_WAIT_BOUNDS[bucket]) bucket++;
+				_transactions.lockWait[bucket].fetch_add(1, std::memory_order_relaxed);
+			}
+
+			Transaction transaction(*this, attempt);
+			bool result;
+			try
+			{
+				result = body(transaction);
+			}
+			catch (...)
+			{
+				// exception leaves the closure: roll back and let it propagate, without retrying
+				if (sqlite3_get_autocommit(_database) == 0) execute("ROLLBACK;");
+				_transactions.failed.fetch_add(1, std::memory_order_relaxed);
+				throw;
+			}
+			if (!result && !transaction.isBusy() && isLockError(getErrorCode())) transaction.check(false);
+
+			if (result && !transaction.isFailed())
+			{
+				if (execute("COMMIT;"))
+				{
+					_transactions.committed.fetch_add(1, std::memory_order_relaxed);
+					return true;
+				}
+				retry = isLockError(getErrorCode());
+			}
+			else retry = transaction.isBusy();
+
+			std::string errorMessage = _errorMessage;
+			if (sqlite3_get_autocommit(_database) == 0) execute("ROLLBACK;");
+			_errorMessage = errorMessage;
+			_success = false;
+		}
+
+		auto delay = backoffDelay(policy.backoff, attempt - 1, random);
+		if (!retry || (policy.maxAttempts > 0 && attempt >= policy.maxAttempts) || std::chrono::steady_clock::now() + delay > deadline)
+		{
+			_transactions.failed.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		std::this_thread::sleep_for(delay);
+	}
+}
+
+momo::TransactionStatistics momo::SQLite3::getTransactionStatistics() const
+{
+	TransactionStatistics statistics;
+	statistics.committed = _transactions.committed;
+	statistics.failed = _transactions.failed;
+	statistics.attempts = _transactions.attempts;
+	statistics.retries = _transactions.retries;
+	for (size_t i = 0; i < statistics.lockWait.size(); i++)
+		statistics.lockWait[i] = _transactions.lockWait[i];
+	return statistics;
+}
+
+void momo::SQLite3::resetTransactionStatistics()
+{
+	_transactions.committed = 0;
+	_transactions.failed = 0;
+	_transactions.attempts = 0;
+	_transactions.retries = 0;
+	for (auto& bucket : _transactions.lockWait) bucket = 0;
+}
+
+momo::Transaction::Transaction(SQLite3& database, int attempt)
+	: _database(database), _attempt(attempt), _busy(false), _failed(false), _aborted(false)
+{
+
+}
+
+momo::SQLite3& momo::Transaction::database()
+{
+	return _database;
+}
+
+int momo::Transaction::attempt() const
+{
+	return _attempt;
+}
+
+bool momo::Transaction::execute(const std::string& SQL)
+{
+	return check(_database.execute(SQL));
+}
+
+bool momo::Transaction::execute(const std::string& SQL, const std::vector<Value>& parameters)
+{
+	return check(_database.execute(SQL, parameters));
+}
+
+momo::Transaction& momo::Transaction::operator<<(const std::string& SQL)
+{
+	execute(SQL);
+	return *this;
+}
+
+bool momo::Transaction::check(bool result)
+{
+	if (!result)
+	{
+		_failed = true;
+		if (isLockError(_database.getErrorCode())) _busy = true;
+	}
+	return result;
+}
+
+void momo::Transaction::abort()
+{
+	_aborted = true;
+	_failed = true;
+}
+
+bool momo::Transaction::isBusy() const
+{
+	return _busy && !_aborted;
+}
+
+bool momo::Transaction::isFailed() const
+{
+	return _failed;
+}
+
+bool momo::SQLite3::checkResult(int code)
+{
+	_success = (code == SQLITE_OK);
+	if (!_success)
+	{
+		_errorMessage = std::string(sqlite3_errmsg(_database));
+	}
+	return _success;
+}
+
+momo::SQLite3& momo::SQLite3::operator<<(const std::string& SQL)
+{
+	execute(SQL);
+	return *this;
+}
+
+void momo::SQLite3::close()
+{
+	if (_isOpen)
+	{
+		// cached statements must be finalized before connection is closed
+		_statements.clear();
+		sqlite3_close(_database);
+		_database = nullptr;
+		_isOpen = false;
+		// dispatchers are installed again when another database is opened
+		std::lock_guard<std::mutex> lock(_hooks.mutex);
+		_hooks.walInstalled = false;
+		_hooks.authorizerInstalled = false;
+		_hooks.autoCheckpoint = 1000;
+	}
+}
+
+momo::SQLite3::~SQLite3()
+{
+	close();
+}
+
+momo::Value::Value()
+	: _type(NULL_VALUE), _integer(0), _real(0), _array()
+{
+
+}
+
+momo::Value::Value(std::nullptr_t)
+	: Value()
+{
+
+}
+
+momo::Value::Value(int value)
+	: Value((long long)value)
+{
+
+}
+
+momo::Value::Value(long value)
+	: Value((long long)value)
+{
+
+}
+
+momo::Value::Value(long long value)
+	: _type(INTEGER), _integer(value), _real(0), _array()
+{
+
+}
+
+momo::Value::Value(unsigned value)
+	: Value((long long)value)
+{
+
+}
+
+momo::Value::Value(unsigned long value)
+	: Value((unsigned long long)value)
+{
+
+}
+
+momo::Value::Value(unsigned long long value)
+	: Value(value > (unsigned long long)INT64_MAX ? Value((double)value) : Value((long long)value))
+{
+
+}
+
+momo::Value::Value(double value)
+	: _type(REAL), _integer(0), _real(value), _array()
+{
+
+}
+
+momo::Value::Value(const char* value)
+	: Value(value == nullptr ? Value() : Value(std::string(value)))
+{
+
+}
+
+momo::Value::Value(std::string value)
+	: _type(TEXT), _integer(0), _real(0), _text(std::move(value)), _array()
+{
+
+}
+
+int momo::detail::findColumn(const std::vector<std::string>& columns, std::string name)
+{
+	size_t qualifier = name.rfind('.');
+	if (qualifier != std::string::npos) name = name.substr(qualifier + 1);
+	for (size_t i = 0; i < columns.size(); i++)
+	{
+		if (sqlite3_stricmp(columns[i].c_str(), name.c_str()) == 0) return (int)i;
+	}
+	return -1;
+}
+
+momo::Value momo::Value::blob(const void* data, size_t size)
+{
+	Value value(std::string(static_cast<const char*>(data), size));
+	value._type = BLOB;
+	return value;
+}
+
+momo::Value momo::Value::array(const std::int64_t* data, size_t count)
+{
+	Value value;
+	value._type = ARRAY;
+	value._array = { Array::INT64, data, count };
+	return value;
+}
+
+momo::Value momo::Value::array(const std::string* data, size_t count)
+{
+	Value value;
+	value._type = ARRAY;
+	value._array = { Array::STRING, data, count };
+	return value;
+}
+
+momo::Value momo::Value::array(const std::string_view* data, size_t count)
+{
+	Value value;
+	value._type = ARRAY;
+	value._array = { Array::STRING_VIEW, data, count };
+	return value;
+}
+
+momo::Value momo::Value::from(sqlite3_value* value)
+{
+	switch (sqlite3_value_type(value))
+	{
+	case SQLITE_INTEGER:
+		return Value(sqlite3_value_int64(value));
+	case SQLITE_FLOAT:
+		return Value(sqlite3_value_double(value));
+	case SQLITE_TEXT:
+		return Value(std::string(reinterpret_cast<const char*>(sqlite3_value_text(value)), sqlite3_value_bytes(value)));
+	case SQLITE_BLOB:
+		return blob(sqlite3_value_blob(value), sqlite3_value_bytes(value));
+	}
+	return Value();
+}
+
+momo::Value::Type momo::Value::type() const
+{
+	return _type;
+}
+
+bool momo::Value::isNull() const
+{
+	return _type == NULL_VALUE;
+}
+
+sqlite3_int64 momo::Value::asInteger() const
+{
+	return _type == REAL ? (sqlite3_int64)_real : _integer;
+}
+
+double momo::Value::asReal() const
+{
+	return _type == INTEGER ? (double)_integer : _real;
+}
+
+const std::string& momo::Value::asText() const
+{
+	return _text;
+}
+
+const momo::Value::Array& momo::Value::asArray() const
+{
+	return _array;
+}
+
+int momo::Value::compare(const Value& left, const Value& right)
+{
+	auto typeOrder = [](Type type)
+	{
+		switch (type)
+		{
+		case INTEGER:
+		case REAL:
+			return 1;
+		case TEXT:
+			return 2;
+		case BLOB:
+			return 3;
+		default:
+			return 0;
+		}
+	};
+	int leftOrder = typeOrder(left._type);
+	int rightOrder = typeOrder(right._type);
+	if (leftOrder != rightOrder) return leftOrder < rightOrder ? -1 : 1;
+
+	switch (leftOrder)
+	{
+	case 1:
+		if (left._type == INTEGER && right._type == INTEGER)
+			return left._integer < right._integer ? -1 : (left._integer > right._integer ? 1 : 0);
+		return left.asReal() < right.asReal() ? -1 : (left.asReal() > right.asReal() ? 1 : 0);
+	case 2:
+	case 3:
+	{
+		int result = std::memcmp(left._text.data(), right._text.data(), std::min(left._text.size(), right._text.size()));
+		if (result != 0) return result;
+		return left._text.size() < right._text.size() ? -1 : (left._text.size() > right._text.size() ? 1 : 0);
+	}
+	default:
+		return 0;
+	}
+}
+
+momo::CancellationToken::CancellationToken()
+	: _cancelled(false)
+{
+
+}
+
+void momo::CancellationToken::cancel()
+{
+	_cancelled.store(true, std::memory_order_release);
+}
+
+bool momo::CancellationToken::isCancelled() const
+{
+	return _cancelled.load(std::memory_order_acquire);
+}
+
+void momo::CancellationToken::reset()
+{
+	_cancelled.store(false, std::memory_order_release);
+}
+
+const char* momo::detail::QueryGuard::check() const
+{
+	if (limits.token != nullptr && limits.token->isCancelled())
+		return "query cancelled";
+	if (limits.timeout.count() != 0 && std::chrono::steady_clock::now() >= deadline)
+		return "query timeout expired";
+	if (limits.maxSteps > 0 && steps > limits.maxSteps)
+		return "query step limit exceeded";
+	return nullptr;
+}
+
+int momo::detail::QueryGuard::progress(void* guard)
+{
+	auto self = static_cast<QueryGuard*>(guard);
+	// SQLITE_STMTSTATUS_VM_STEP is updated only when statement returns, so running statement counts handler calls
+	self->steps += (std::uint64_t)self->limits.checkInterval;
+	return self->check() != nullptr;
+}
+
+momo::Statement::Statement()
+	: _statement(nullptr), _success(true), _hooks(nullptr)
+{
+
+}
+
+momo::Statement::Statement(sqlite3_stmt* statement)
+	: _statement(statement), _success(true), _hooks(nullptr)
+{
+
+}
+
+momo::Statement::Statement(sqlite3_stmt* statement, detail::HookState* hooks)
+	: _statement(statement), _success(true), _hooks(hooks)
+{
+
+}
+
+momo::Statement::Statement(Statement&& other) noexcept
+	: _statement(other._statement), _errorMessage(std::move(other._errorMessage)), _success(other._success), _guard(other._guard), _hooks(other._hooks)
+{
+	other._statement = nullptr;
+}
+
+momo::Statement& momo::Statement::operator=(Statement&& other) noexcept
+{
+	if (this != &other)
+	{
+		finalize();
+		_statement = other._statement;
+		_errorMessage = std::move(other._errorMessage);
+		_success = other._success;
+		_guard = other._guard;
+		_hooks = other._hooks;
+		other._statement = nullptr;
+	}
+	return *this;
+}
+
+bool momo::Statement::checkResult(int code)
+{
+	_success = (code == SQLITE_OK);
+	if (!_success)
+	{
+		_errorMessage = std::string(sqlite3_errmsg(sqlite3_db_handle(_statement)));
+	}
+	return _success;
+}
+
+bool momo::Statement::isPrepared() const
+{
+	return _statement != nullptr;
+}
+
+bool momo::Statement::success() const
+{
+	return _success;
+}
+
+const std::string& momo::Statement::getErrorMessage() const
+{
+	return _errorMessage;
+}
+
+bool momo::Statement::bind(int index, const Value& value)
+{
+	switch (value.type())
+	{
+	case Value::NULL_VALUE:
+		return checkResult(sqlite3_bind_null(_statement, index));
+	case Value::INTEGER:
+		return checkResult(sqlite3_bind_int64(_statement, index, value.asInteger()));
+	case Value::REAL:
+		return checkResult(sqlite3_bind_double(_statement, index, value.asReal()));
+	case Value::TEXT:
+		return checkResult(sqlite3_bind_text(_statement, index, value.asText().data(), (int)value.asText().size(), SQLITE_TRANSIENT));
+	case Value::BLOB:
+		return checkResult(sqlite3_bind_blob(_statement, index, value.asText().data(), (int)value.asText().size(), SQLITE_TRANSIENT));
+	case Value::ARRAY:
+		// descriptor is copied, as value may be a temporary destroyed before statement is stepped
+		return checkResult(sqlite3_bind_pointer(_statement, index, new Value::Array(value.asArray()), arrayPointerType, freeArray));
+	}
+	return _success;
+}
+
+bool momo::Statement::bind(const std::vector<Value>& values)
+{
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		if (!bind((int)i + 1, values[i]))
+			return _success;
+	}
+	return _success;
+}
+
+bool momo::Statement::step()
+{
+	sqlite3* database = sqlite3_db_handle(_statement);
+	if (_guard.enabled)
+	{
+		if (!_guard.started)
+		{
+			_guard.started = true;
+			_guard.deadline = std::chrono::steady_clock::now() + _guard.limits.timeout;
+			_guard.steps = 0;
+		}
+		// fail fast if query is cancelled or out of time before it starts
+		if (const char* reason = _guard.check())
+		{
+			_success = false;
+			_errorMessage = reason;
+			return false;
+		}
+		sqlite3_progress_handler(database, _guard.limits.checkInterval, &detail::QueryGuard::progress, &_guard);
+	}
+	bool hooked = _hooks != nullptr && _hooks->stepHooks.load(std::memory_order_relaxed) > 0;
+	if (hooked) notifyStep(*_hooks, _statement, false, SQLITE_OK);
+	int code = sqlite3_step(_statement);
+	if (hooked) notifyStep(*_hooks, _statement, true, code);
+	if (_guard.enabled) sqlite3_progress_handler(database, 0, nullptr, nullptr);
+
+	if (code == SQLITE_ROW)
+	{
+		_success = true;
+		return true;
+	}
+	checkResult(code == SQLITE_DONE ? SQLITE_OK : code);
+	if (code == SQLITE_INTERRUPT && _guard.enabled)
+	{
+		if (const char* reason = _guard.check()) _errorMessage = reason;
+	}
+	return false;
+}
+
+bool momo::Statement::reset()
+{
+	_guard.started = false;
+	return checkResult(sqlite3_reset(_statement));
+}
+
+void momo::Statement::setLimits(const QueryLimits& limits)
+{
+	_guard.limits = limits;
+	if (_guard.limits.checkInterval < 1) _guard.limits.checkInterval = 1;
+	_guard.enabled = true;
+	_guard.started = false;
+}
+
+void momo::Statement::clearLimits()
+{
+	_guard.enabled = false;
+}
+
+std::uint64_t momo::Statement::vmSteps() const
+{
+	return (std::uint64_t)sqlite3_stmt_status(_statement, SQLITE_STMTSTATUS_VM_STEP, 0);
+}
+
+int momo::Statement::columnCount() const
+{
+	return sqlite3_column_count(_statement);
+}
+
+const char* momo::Statement::columnName(int column) const
+{
+	return sqlite3_column_name(_statement, column);
+}
+
+const char* momo::Statement::columnText(int column) const
+{
+	return reinterpret_cast<const char*>(sqlite3_column_text(_statement, column));
+}
+
+momo::Value momo::Statement::column(int column) const
+{
+	return Value::from(sqlite3_column_value(_statement, column));
+}
+
+sqlite3_stmt* momo::Statement::handle() const
+{
+	return _statement;
+}
+
+void momo::Statement::finalize()
+{
+	sqlite3_finalize(_statement);
+	_statement = nullptr;
+}
+
+momo::Statement::~Statement()
+{
+	finalize();
+}
+
+void momo::setResult(sqlite3_context* context, std::nullptr_t)
+{
+	sqlite3_result_null(context);
+}
+
+void momo::setResult(sqlite3_context* context, int value)
+{
+	sqlite3_result_int(context, value);
+}
+
+void momo::setResult(sqlite3_context* context, long value)
+{
+	sqlite3_result_int64(context, value);
+}
+
+void momo::setResult(sqlite3_context* context, long long value)
+{
+	sqlite3_result_int64(context, value);
+}
+
+void momo::setResult(sqlite3_context* context, unsigned value)
+{
+	sqlite3_result_int64(context, value);
+}
+
+void momo::setResult(sqlite3_context* context, unsigned long value)
+{
+	setResult(context, (unsigned long long)value);
+}
+
+void momo::setResult(sqlite3_context* context, unsigned long long value)
+{
+	if (value > (unsigned long long)INT64_MAX) sqlite3_result_double(context, (double)value);
+	else sqlite3_result_int64(context, (sqlite3_int64)value);
+}
+
+void momo::setResult(sqlite3_context* context, double value)
+{
+	sqlite3_result_double(context, value);
+}
+
+void momo::setResult(sqlite3_context* context, const char* value)
+{
+	if (value == nullptr) sqlite3_result_null(context);
+	else sqlite3_result_text(context, value, -1, SQLITE_TRANSIENT);
+}
+
+void momo::setResult(sqlite3_context* context, const std::string& value)
+{
+	sqlite3_result_text(context, value.data(), (int)value.size(), SQLITE_TRANSIENT);
+}
+
+int momo::detail::compareKey(int key, sqlite3_value* value)
+{
+	return compareKey((long long)key, value);
+}
+
+int momo::detail::compareKey(long key, sqlite3_value* value)
+{
+	return compareKey((long long)key, value);
+}
+
+int momo::detail::compareKey(long long key, sqlite3_value* value)
+{
+	int type = sqlite3_value_numeric_type(value);
+	if (type == SQLITE_INTEGER) return compareNumbers<sqlite3_int64>(key, sqlite3_value_int64(value));
+	if (type == SQLITE_FLOAT) return compareNumbers((double)key, sqlite3_value_double(value));
+	return compareNumbers(typeRank(SQLITE_INTEGER), typeRank(type));
+}
+
+int momo::detail::compareKey(unsigned key, sqlite3_value* value)
+{
+	return compareKey((long long)key, value);
+}
+
+int momo::detail::compareKey(unsigned long key, sqlite3_value* value)
+{
+	return compareKey((unsigned long long)key, value);
+}
+
+int momo::detail::compareKey(unsigned long long key, sqlite3_value* value)
+{
+	if (key > (unsigned long long)INT64_MAX) return compareKey((double)key, value);
+	return compareKey((long long)key, value);
+}
+
+int momo::detail::compareKey(double key, sqlite3_value* value)
+{
+	int type = sqlite3_value_numeric_type(value);
+	if (type == SQLITE_INTEGER || type == SQLITE_FLOAT) return compareNumbers(key, sqlite3_value_double(value));
+	return compareNumbers(typeRank(SQLITE_FLOAT), typeRank(type));
+}
+
+int momo::detail::compareKey(const char* key, sqlite3_value* value)
+{
+	if (key == nullptr) return compareNumbers(typeRank(SQLITE_NULL), typeRank(sqlite3_value_type(value)));
+	return compareText(key, strlen(key), value);
+}
+
+int momo::detail::compareKey(const std::string& key, sqlite3_value* value)
+{
+	return compareText(key.data(), key.size(), value);
+}
+
+const char* momo::convertType(momo::TYPE type)
+{
+	switch (type)
+	{
+	case momo::TYPE::INT:
+		return "INT";
+	case momo::TYPE::TEXT:
+		return "TEXT";
+	case momo::TYPE::NUMERIC:
+		return "NUMERIC";
+	case momo::TYPE::REAL:
+		return "REAL";
+	case momo::TYPE::BLOB:
+		return "BLOB";
+	}
+	return "TEXT";
+}
+
+momo::SQLBuilder<momo::OPERATION::CREATE>::SQLBuilder()
+	: tableName("UNNAMED")
+{
+
+}
+
+momo::SQLBuilder<momo::OPERATION::CREATE>::SQLBuilder(std::string tableName)
+	: tableName(std::move(tableName))
+{
+
+}
+
+momo::SQLBuilder<momo::OPERATION::ALTER>& momo::SQLBuilder<momo::OPERATION::ALTER>::rename(const std::string newName)
+{
+	_newName = newName;
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::ALTER>& momo::SQLBuilder<momo::OPERATION::ALTER>::addColumn(const std::string& name, TYPE type, bool isNull)
+{
+	addColumn(name, convertType(type), isNull);
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::ALTER>& momo::SQLBuilder<momo::OPERATION::ALTER>::addColumn(const std::string& name, const std::string& type, bool isNull)
+{
+	const char* IsNULL = (isNull == NULL ? " NULL" : " NOT NULL");
+	std::string column = name + ' ' + type + IsNULL;
+	_newColumns.push_back(std::move(column));
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::ALTER>& momo::SQLBuilder<momo::OPERATION::ALTER>::renameColumn(const std::string& columnName, const std::string& newColumnName)
+{
+	_renamedColumns.push_back({ columnName, newColumnName });
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::ALTER>::SQLBuilder(std::string tableName)
+	: _tableName(std::move(tableName))
+{
+
+}
+
+momo::SQLBuilder<momo::OPERATION::CREATE>& momo::SQLBuilder<momo::OPERATION::CREATE>::addColumn(const std::string& name, TYPE type, bool isNull, bool isPrimaryKey)
+{
+	addColumn(name, convertType(type), isNull, isPrimaryKey);
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::CREATE>& momo::SQLBuilder<momo::OPERATION::CREATE>::addColumn(const std::string& name, const std::string& type, bool isNull, bool isPrimaryKey)
+{
+	const char* IsNULL = (isNull == NULL ? " NULL" : " NOT NULL");
+	const char* IsKEY = (isPrimaryKey == momo::PRIMARY_KEY ? " PRIMARY KEY" : "");
+	*this << (name + ' ' + type + IsNULL + IsKEY);
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::CREATE>& momo::SQLBuilder<momo::OPERATION::CREATE>::operator<<(std::string column)
+{
+	if(!_columns.empty()) _columns.back() += ',';
+	_columns.push_back(std::move(column));
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::CREATE>::operator std::string() const
+{
+	std::stringstream SQL;
+	SQL << "CREATE TABLE " << tableName << '(';
+	for (const auto& column : _columns)
+	{
+		SQL << column;
+	}
+	SQL << ");";
+	return SQL.str();
+}
+
+momo::SQLBuilder<momo::OPERATION::DELETE>::operator std::string() const
+{
+	std::stringstream SQL;
+	SQL << "DELETE FROM " << _tableName;
+	if (!_whereExpression.empty()) SQL << " WHERE " << _whereExpression;
+	SQL << ';';
+	return SQL.str();
+}
+
+momo::SQLite3& momo::operator<<(SQLite3& database, const SQLBuilder<OPERATION::ALTER>& sql)
+{
+	std::string alterString = "ALTER TABLE " + sql._tableName;
+	if (!sql._newName.empty())
+	{
+		if (!database.execute(alterString + " RENAME TO " + sql._newName + ';'))
+			return database;
+	}
+
+	for (const auto& column : sql._newColumns)
+	{
+		if (!database.execute(alterString + " ADD " + column + ';'))
+			return database;
+	}
+	for (const auto& columnPair : sql._renamedColumns)
+	{
+		if(!database.execute(alterString + " RENAME COLUMN " + columnPair.first + " TO " + columnPair.second + ';'))
+			return database;
+	}
+	return database;
+}
+
+momo::SQLBuilder<momo::OPERATION::INSERT>::SQLBuilder(const std::string& tableName, const std::string& values)
+	: _insertionLine("INSERT INTO " + tableName + '(' + values + ')')
+{
+
+}
+
+std::string momo::SQLBuilder<momo::OPERATION::INSERT>::render(size_t first, size_t last) const
+{
+	size_t parameter = 0;
+	std::stringstream SQL;
+	SQL << _insertionLine << "VALUES ";
+	for (size_t i = first; i < last; i++)
+	{
+		if (i > first) SQL << ", ";
+		if (_rows[i].bound == 0)
+		{
+			SQL << _rows[i].literal;
+			continue;
+		}
+		SQL << '(';
+		for (size_t j = 0; j < _rows[i].bound; j++)
+		{
+			if (j > 0) SQL << ", ";
+			SQL << '?' << ++parameter;
+		}
+		SQL << ')';
+	}
+	if (!_conflictAction.empty())
+	{
+		SQL << " ON CONFLICT";
+		if (!_conflictTarget.empty()) SQL << " (" << _conflictTarget << ')';
+		SQL << ' ' << _conflictAction;
+	}
+	SQL << ';';
+	return SQL.str();
+}
+
+std::vector<std::pair<std::string, std::vector<momo::Value>>> momo::SQLBuilder<momo::OPERATION::INSERT>::statements() const
+{
+	std::vector<std::pair<std::string, std::vector<Value>>> statements;
+	if (_parameters.empty())
+	{
+		for (size_t i = 0; i < _rows.size(); i++) statements.emplace_back(render(i, i + 1), std::vector<Value>());
+		return statements;
+	}
+
+	size_t widest = 1;
+	for (const auto& row : _rows) widest = std::max(widest, row.bound);
+	size_t rows = MAX_BOUND_ROWS;
+	while (rows > 1 && rows * widest > MAX_BOUND_VALUES) rows /= 2;
+
+	size_t first = 0, parameter = 0;
+	while (first < _rows.size())
+	{
+		// remainder is split into powers of two, so few distinct statements are cached
+		size_t count = rows;
+		while (count > _rows.size() - first) count /= 2;
+		std::vector<Value> values;
+		for (size_t i = first; i < first + count; i++)
+		{
+			values.insert(values.end(), _parameters.begin() + parameter, _parameters.begin() + parameter + _rows[i].bound);
+			parameter += _rows[i].bound;
+		}
+		statements.emplace_back(render(first, first + count), std::move(values));
+		first += count;
+	}
+	return statements;
+}
+
+momo::SQLBuilder<momo::OPERATION::INSERT>::operator std::string() const
+{
+	std::string SQL;
+	for (const auto& statement : statements()) SQL += statement.first;
+	return SQL;
+}
+
+momo::SQLBuilder<momo::OPERATION::INSERT>& momo::SQLBuilder<momo::OPERATION::INSERT>::addValues(std::string values)
+{
+	_rows.push_back({ "(" + values + ")", 0 });
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::INSERT>& momo::SQLBuilder<momo::OPERATION::INSERT>::addRow(const std::vector<Value>& values)
+{
+	_parameters.insert(_parameters.end(), values.begin(), values.end());
+	_rows.push_back({ std::string(), values.size() });
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::INSERT>& momo::SQLBuilder<momo::OPERATION::INSERT>::onConflict(const std::string& columns)
+{
+	_conflictTarget = columns;
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::INSERT>& momo::SQLBuilder<momo::OPERATION::INSERT>::doNothing()
+{
+	_conflictAction = "DO NOTHING";
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::INSERT>& momo::SQLBuilder<momo::OPERATION::INSERT>::doUpdate(const std::string& setExpression, const std::string& whereExpression)
+{
+	_conflictAction = "DO UPDATE SET " + setExpression;
+	if (!whereExpression.empty()) _conflictAction += " WHERE " + whereExpression;
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::INSERT>& momo::SQLBuilder<momo::OPERATION::INSERT>::doUpdateExcluded(const std::vector<std::string>& columns)
+{
+	std::string setExpression;
+	for (const auto& column : columns)
+	{
+		if (!setExpression.empty()) setExpression += ", ";
+		setExpression += column + " = excluded." + column;
+	}
+	return doUpdate(setExpression);
+}
+
+const std::vector<momo::Value>& momo::SQLBuilder<momo::OPERATION::INSERT>::parameters() const
+{
+	return _parameters;
+}
+
+size_t momo::SQLBuilder<momo::OPERATION::INSERT>::rowCount() const
+{
+	return _rows.size();
+}
+
+momo::SQLite3& momo::operator<<(SQLite3& database, const SQLBuilder<OPERATION::INSERT>& sql)
+{
+	if (sql.parameters().empty())
+	{
+		database.execute(sql);
+		return database;
+	}
+
+	auto statements = sql.statements();
+	if (statements.size() == 1)
+	{
+		database.executeCached(statements[0].first, statements[0].second);
+		return database;
+	}
+	if (sqlite3_get_autocommit(database.handle()) == 0)
+	{
+		// transaction of the caller is rolled back by the caller
+		for (const auto& statement : statements)
+		{
+			if (!database.executeCached(statement.first, statement.second)) break;
+		}
+		return database;
+	}
+	database.writeTransaction([&statements](Transaction& transaction)
+	{
+		for (const auto& statement : statements)
+		{
+			if (!transaction.check(transaction.database().executeCached(statement.first, statement.second))) return false;
+		}
+		return true;
+	});
+	return database;
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>::SQLBuilder(std::string tableName)
+	: _tableName(std::move(tableName)), _columns(), _limitCount(SIZE_MAX), _limitOffset(0), callback(nullptr), callbackArg(nullptr)
+{
+
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>::SQLBuilder(std::string tableName, std::string columns)
+	: _tableName(std::move(tableName)), _columns(std::move(columns)), _limitCount(SIZE_MAX), _limitOffset(0), callback(nullptr), callbackArg(nullptr)
+{
+
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::addColumn(const std::string& columnName)
+{
+	if (!_columns.empty()) _columns += ',';
+	_columns += columnName;
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::addColumn(const std::string& columnName, const std::string& alias)
+{
+	if (!_columns.empty()) _columns += ',';
+	_columns += columnName + " AS " + alias;
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::aggregate(AGGREGATE function, const std::string& column, const std::string& alias)
+{
+	static const char* names[] = { "COUNT", "SUM", "AVG", "MIN", "MAX" };
+	std::string expression = std::string(names[function]) + '(' + column + ')';
+	return alias.empty() ? addColumn(expression) : addColumn(expression, alias);
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::count(const std::string& column, const std::string& alias)
+{
+	return aggregate(AGGREGATE::COUNT, column, alias);
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::sum(const std::string& column, const std::string& alias)
+{
+	return aggregate(AGGREGATE::SUM, column, alias);
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::avg(const std::string& column, const std::string& alias)
+{
+	return aggregate(AGGREGATE::AVG, column, alias);
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::min(const std::string& column, const std::string& alias)
+{
+	return aggregate(AGGREGATE::MIN, column, alias);
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::max(const std::string& column, const std::string& alias)
+{
+	return aggregate(AGGREGATE::MAX, column, alias);
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::groupBy(const std::string& column)
+{
+	if (!_groupExpression.empty()) _groupExpression += ',';
+	_groupExpression += column;
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::having(const std::string& havingExpression)
+{
+	if (!_havingExpression.empty()) _havingExpression += " AND ";
+	_havingExpression += '(' + havingExpression + ')';
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::innerJoin(const std::string& table, const std::string& on)
+{
+	_joins.push_back({ "INNER JOIN", table, std::string(), on });
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::leftJoin(const std::string& table, const std::string& on)
+{
+	_joins.push_back({ "LEFT JOIN", table, std::string(), on });
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::crossJoin(const std::string& table, const std::string& on)
+{
+	_joins.push_back({ "CROSS JOIN", table, std::string(), on });
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::indexedBy(const std::string& index)
+{
+	(_joins.empty() ? _tableHint : _joins.back().hint) = "INDEXED BY " + index;
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::notIndexed()
+{
+	(_joins.empty() ? _tableHint : _joins.back().hint) = "NOT INDEXED";
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::where(const std::string& whereExpression)
+{
+	if (!_whereExpression.empty()) _whereExpression += " AND ";
+	_whereExpression += '(' + whereExpression + ')';
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::whereIn(const std::string& column, const std::vector<std::int64_t>& keys)
+{
+	return whereIn(column, Value::array(keys.data(), keys.size()));
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::whereIn(const std::string& column, const std::vector<std::string>& keys)
+{
+	return whereIn(column, Value::array(keys.data(), keys.size()));
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::whereIn(const std::string& column, const std::vector<std::string_view>& keys)
+{
+	return whereIn(column, Value::array(keys.data(), keys.size()));
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::whereIn(const std::string& column, const Value& keys)
+{
+	_parameters.push_back(keys);
+	return where(column + " IN momo_array(?" + std::to_string(_parameters.size()) + ')');
+}
+
+const std::vector<momo::Value>& momo::SQLBuilder<momo::OPERATION::SELECT>::parameters() const
+{
+	return _parameters;
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::orderBy(const std::string& column, momo::ORDER order)
+{
+	if (!_orderExpression.empty()) _orderExpression += ',';
+	_orderExpression += column + (order == ORDER::ASC ? " ASC" : " DESC");
+	_orderColumns.emplace_back(column, order);
+	return *this;
+}
+
+const std::vector<std::pair<std::string, momo::ORDER>>& momo::SQLBuilder<momo::OPERATION::SELECT>::orderColumns() const
+{
+	return _orderColumns;
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::limit(size_t count, size_t offset)
+{
+	_limitCount = count;
+	_limitOffset = offset;
+	return *this;
+}
+
+size_t momo::SQLBuilder<momo::OPERATION::SELECT>::limitCount() const
+{
+	return _limitCount;
+}
+
+size_t momo::SQLBuilder<momo::OPERATION::SELECT>::limitOffset() const
+{
+	return _limitOffset;
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>& momo::SQLBuilder<momo::OPERATION::SELECT>::after(const std::vector<Value>& keys)
+{
+	size_t count = std::min(keys.size(), _orderColumns.size());
+	if (count == 0) return *this;
+
+	std::vector<std::string> parameters;
+	bool uniform = true;
+	for (size_t i = 0; i < count; i++)
+	{
+		_parameters.push_back(keys[i]);
+		parameters.push_back('?' + std::to_string(_parameters.size()));
+		uniform = uniform && _orderColumns[i].second == _orderColumns[0].second;
+	}
+	auto follows = [this](size_t i) { return _orderColumns[i].second == ORDER::ASC ? " > " : " < "; };
+
+	if (count == 1) return where(_orderColumns[0].first + follows(0) + parameters[0]);
+	if (uniform)
+	{
+		// row value comparison is used by SQLite as a single index range
+		std::string columns, values;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (i > 0) columns += ", ", values += ", ";
+			columns += _orderColumns[i].first;
+			values += parameters[i];
+		}
+		return where('(' + columns + ')' + follows(0) + '(' + values + ')');
+	}
+
+	std::string expression;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (i > 0) expression += " OR ";
+		expression += '(';
+		for (size_t j = 0; j < i; j++) expression += _orderColumns[j].first + " = " + parameters[j] + " AND ";
+		expression += _orderColumns[i].first + follows(i) + parameters[i] + ')';
+	}
+	return where(expression);
+}
+
+momo::SQLBuilder<momo::OPERATION::SELECT>::operator std::string() const
+{
+	std::stringstream SQL;
+	SQL << "SELECT " << (_columns.empty() ? "*" : _columns);
+	SQL << " FROM " << _tableName;
+	if (!_tableHint.empty()) SQL << ' ' << _tableHint;
+	for (const auto& join : _joins)
+	{
+		SQL << ' ' << join.kind << ' ' << join.table;
+		if (!join.hint.empty()) SQL << ' ' << join.hint;
+		if (!join.on.empty()) SQL << " ON (" << join.on << ')';
+	}
+	if (!_whereExpression.empty()) SQL << " WHERE " << _whereExpression;
+	if (!_groupExpression.empty()) SQL << " GROUP BY " << _groupExpression;
+	if (!_havingExpression.empty()) SQL << " HAVING " << _havingExpression;
+	if (!_orderExpression.empty()) SQL << " ORDER BY " << _orderExpression;
+	if (_limitCount != SIZE_MAX)
+	{
+		SQL << " LIMIT " << _limitCount;
+		if (_limitOffset > 0) SQL << " OFFSET " << _limitOffset;
+	}
+	SQL << ';';
+	return SQL.str();
+}
+
+momo::SQLBuilder<momo::OPERATION::DROP>::SQLBuilder(std::string tableName)
+	: _tableName(std::move(tableName))
+{
+
+}
+
+momo::SQLBuilder<momo::OPERATION::DELETE>::SQLBuilder(std::string tableName)
+	: _tableName(std::move(tableName))
+{
+
+}
+
+momo::SQLBuilder<momo::OPERATION::DELETE>& momo::SQLBuilder<momo::OPERATION::DELETE>::where(const std::string& whereExpression)
+{
+	if (!_whereExpression.empty()) _whereExpression += " AND ";
+	_whereExpression += '(' + whereExpression + ')';
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::DELETE>& momo::SQLBuilder<momo::OPERATION::DELETE>::whereIn(const std::string& column, const std::vector<std::int64_t>& keys)
+{
+	return whereIn(column, Value::array(keys.data(), keys.size()));
+}
+
+momo::SQLBuilder<momo::OPERATION::DELETE>& momo::SQLBuilder<momo::OPERATION::DELETE>::whereIn(const std::string& column, const std::vector<std::string>& keys)
+{
+	return whereIn(column, Value::array(keys.data(), keys.size()));
+}
+
+momo::SQLBuilder<momo::OPERATION::DELETE>& momo::SQLBuilder<momo::OPERATION::DELETE>::whereIn(const std::string& column, const std::vector<std::string_view>& keys)
+{
+	return whereIn(column, Value::array(keys.data(), keys.size()));
+}
+
+momo::SQLBuilder<momo::OPERATION::DELETE>& momo::SQLBuilder<momo::OPERATION::DELETE>::whereIn(const std::string& column, const Value& keys)
+{
+	_parameters.push_back(keys);
+	return where(column + " IN momo_array(?" + std::to_string(_parameters.size()) + ')');
+}
+
+const std::vector<momo::Value>& momo::SQLBuilder<momo::OPERATION::DELETE>::parameters() const
+{
+	return _parameters;
+}
+
+momo::SQLBuilder<momo::OPERATION::DROP>::operator std::string() const
+{
+	std::stringstream SQL;
+	SQL << "DROP TABLE " << _tableName << ';';
+	return SQL.str();
+}
+
+momo::SQLite3& momo::operator<<(SQLite3& database, const SQLBuilder<OPERATION::SELECT>& sql)
+{
+	if (sql.parameters().empty())
+		database.execute(sql, sql.callback, sql.callbackArg);
+	else
+		database.execute(sql, sql.parameters(), sql.callback, sql.callbackArg);
+	return database;
+}
+
+std::string momo::encodeCursor(const std::vector<Value>& keys)
+{
+	std::string fields;
+	for (const auto& key : keys)
+	{
+		switch (key.type())
+		{
+		case Value::INTEGER:
+			writeCursorField(fields, 'i', std::to_string(key.asInteger()));
+			break;
+		case Value::REAL:
+		{
+			char text[32];
+			snprintf(text, sizeof(text), "%.17g", key.asReal());
+			writeCursorField(fields, 'r', text);
+			break;
+		}
+		case Value::TEXT:
+			writeCursorField(fields, 't', key.asText());
+			break;
+		case Value::BLOB:
+			writeCursorField(fields, 'b', key.asText());
+			break;
+		default:
+			writeCursorField(fields, 'n', std::string());
+			break;
+		}
+	}
+
+	// hexadecimal token can be passed in URLs and JSON as is
+	static const char digits[] = "0123456789abcdef";
+	std::string cursor;
+	cursor.reserve(fields.size() * 2);
+	for (unsigned char c : fields)
+	{
+		cursor += digits[c >> 4];
+		cursor += digits[c & 15];
+	}
+	return cursor;
+}
+
+bool momo::decodeCursor(const std::string& cursor, std::vector<Value>& keys)
+{
+	keys.clear();
+	if (cursor.size() % 2 != 0) return false;
+	std::string fields;
+	fields.reserve(cursor.size() / 2);
+	auto digit = [](char c)
+	{
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		return -1;
+	};
+	for (size_t i = 0; i < cursor.size(); i += 2)
+	{
+		int high = digit(cursor[i]), low = digit(cursor[i + 1]);
+		if (high < 0 || low < 0) return false;
+		fields += (char)(high * 16 + low);
+	}
+
+	size_t position = 0;
+	while (position < fields.size())
+	{
+		char type;
+		std::string bytes;
+		if (!readCursorField(fields, position, type, bytes)) return false;
+		char* end = nullptr;
+		switch (type)
+		{
+		case 'i':
+			keys.emplace_back((long long)std::strtoll(bytes.c_str(), &end, 10));
+			break;
+		case 'r':
+			keys.emplace_back(std::strtod(bytes.c_str(), &end));
+			break;
+		case 't':
+			keys.emplace_back(std::move(bytes));
+			break;
+		case 'b':
+			keys.push_back(Value::blob(bytes.data(), bytes.size()));
+			break;
+		case 'n':
+			keys.emplace_back();
+			break;
+		default:
+			return false;
+		}
+		if (end != nullptr && (bytes.empty() || *end != '\0')) return false;
+	}
+	return true;
+}
+
+bool momo::selectPage(SQLite3& database, SQLBuilder<OPERATION::SELECT> sql, size_t pageSize, const std::string& cursor, Page& page, std::string* errorMessage)
+{
+	auto fail = [errorMessage, &page](const std::string& message)
+	{
+		page = Page();
+		if (errorMessage != nullptr) *errorMessage = message;
+		return false;
+	};
+	if (sql.orderColumns().empty()) return fail("keyset pagination requires orderBy() columns");
+	if (pageSize == 0) pageSize = 1;
+	// LIMIT of pageSize + 1 must neither wrap nor exceed the largest integer of SQLite
+	if (pageSize > (size_t)INT64_MAX - 1) pageSize = (size_t)INT64_MAX - 1;
+
+	// cursor may refer to page.cursor, so it is decoded before page is cleared
+	if (!cursor.empty())
+	{
+		std::vector<Value> keys;
+		if (!decodeCursor(cursor, keys) || keys.size() != sql.orderColumns().size()) return fail("invalid cursor");
+		sql.after(keys);
+	}
+	page = Page();
+	// one extra row tells whether there is next page
+	sql.limit(pageSize + 1);
+
+	Statement statement;
+	if (!database.prepare(sql, statement)) return fail(database.getErrorMessage());
+	if (!statement.bind(sql.parameters())) return fail(statement.getErrorMessage());
+	int columns = statement.columnCount();
+	for (int i = 0; i < columns; i++) page.columns.push_back(statement.columnName(i));
+
+	std::vector<int> keys;
+	for (const auto& column : sql.orderColumns())
+	{
+		int key = detail::findColumn(page.columns, column.first);
+		if (key < 0) return fail("ORDER BY column " + column.first + " must be selected");
+		keys.push_back(key);
+	}
+
+	while (statement.step())
+	{
+		if (page.rows.size() == pageSize)
+		{
+			std::vector<Value> last;
+			for (int key : keys) last.push_back(page.rows.back()[key]);
+			page.cursor = encodeCursor(last);
+			return true;
+		}
+		std::vector<Value> row;
+		row.reserve(columns);
+		for (int i = 0; i < columns; i++) row.push_back(statement.column(i));
+		page.rows.push_back(std::move(row));
+	}
+	if (!statement.success()) return fail(statement.getErrorMessage());
+	return true;
+}
+
+momo::SQLite3& momo::operator<<(SQLite3& database, const SQLBuilder<OPERATION::DELETE>& sql)
+{
+	if (sql.parameters().empty())
+		database.execute(sql);
+	else
+		database.execute(sql, sql.parameters());
+	return database;
+}
+
+momo::SQLBuilder<momo::OPERATION::UPDATE>::SQLBuilder(std::string tableName)
+	: _tableName(std::move(tableName))
+{
+
+}
+
+momo::SQLBuilder<momo::OPERATION::UPDATE>& momo::SQLBuilder<momo::OPERATION::UPDATE>::set(const std::string& column, const Value& value)
+{
+	_parameters.push_back(value);
+	return setExpression(column, '?' + std::to_string(_parameters.size()));
+}
+
+momo::SQLBuilder<momo::OPERATION::UPDATE>& momo::SQLBuilder<momo::OPERATION::UPDATE>::setExpression(const std::string& column, const std::string& expression)
+{
+	if (!_setExpression.empty()) _setExpression += ", ";
+	_setExpression += column + " = " + expression;
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::UPDATE>& momo::SQLBuilder<momo::OPERATION::UPDATE>::where(const std::string& whereExpression)
+{
+	if (!_whereExpression.empty()) _whereExpression += " AND ";
+	_whereExpression += '(' + whereExpression + ')';
+	return *this;
+}
+
+momo::SQLBuilder<momo::OPERATION::UPDATE>& momo::SQLBuilder<momo::OPERATION::UPDATE>::whereEquals(const std::string& column, const Value& value)
+{
+	_parameters.push_back(value);
+	return where(column + " = ?" + std::to_string(_parameters.size()));
+}
+
+momo::SQLBuilder<momo::OPERATION::UPDATE>& momo::SQLBuilder<momo::OPERATION::UPDATE>::whereIn(const std::string& column, const std::vector<std::int64_t>& keys)
+{
+	return whereIn(column, Value::array(keys.data(), keys.size()));
+}
+
+momo::SQLBuilder<momo::OPERATION::UPDATE>& momo::SQLBuilder<momo::OPERATION::UPDATE>::whereIn(const std::string& column, const std::vector<std::string>& keys)
+{
+	return whereIn(column, Value::array(keys.data(), keys.size()));
+}
+
+momo::SQLBuilder<momo::OPERATION::UPDATE>& momo::SQLBuilder<momo::OPERATION::UPDATE>::whereIn(const std::string& column, const std::vector<std::string_view>& keys)
+{
+	return whereIn(column, Value::array(keys.data(), keys.size()));
+}
+
+momo::SQLBuilder<momo::OPERATION::UPDATE>& momo::SQLBuilder<momo::OPERATION::UPDATE>::whereIn(const std::string& column, const Value& keys)
+{
+	_parameters.push_back(keys);
+	return where(column + " IN momo_array(?" + std::to_string(_parameters.size()) + ')');
+}
+
+const std::vector<momo::Value>& momo::SQLBuilder<momo::OPERATION::UPDATE>::parameters() const
+{
+	return _parameters;
+}
+
+momo::SQLBuilder<momo::OPERATION::UPDATE>::operator std::string() const
+{
+	std::stringstream SQL;
+	SQL << "UPDATE " << _tableName << " SET " << _setExpression;
+	if (!_whereExpression.empty()) SQL << " WHERE " << _whereExpression;
+	SQL << ';';
+	return SQL.str();
+}
+
+momo::SQLite3& momo::operator<<(SQLite3& database, const SQLBuilder<OPERATION::UPDATE>& sql)
+{
+	database.executeCached(sql, sql.parameters());
+	return database;
+}
+
+bool momo::executeBatch(SQLite3& database, const std::vector<SQLBuilder<OPERATION::UPDATE>>& updates, const TransactionPolicy& policy)
+{
+	return database.writeTransaction([&updates](Transaction& tx)
+	{
+		for (const auto& update : updates)
+		{
+			if (!tx.check(tx.database().executeCached(update, update.parameters()))) return false;
+		}
+		return true;
+	}, policy);
+}
+
+bool momo::executeBatch(SQLite3& database, const std::vector<SQLBuilder<OPERATION::INSERT>>& inserts, const TransactionPolicy& policy)
+{
+	return database.writeTransaction([&inserts](Transaction& tx)
+	{
+		for (const auto& insert : inserts)
+		{
+			if (insert.parameters().empty())
+			{
+				if (!tx.check(tx.database().execute(insert))) return false;
+				continue;
+			}
+			for (const auto& statement : insert.statements())
+			{
+				if (!tx.check(tx.database().executeCached(statement.first, statement.second))) return false;
+			}
+		}
+		return true;
+	}, policy);
 }
\ No newline at end of file
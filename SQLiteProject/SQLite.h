@@ -1,447 +1,1996 @@
-#pragma once
-
-#include "sqlite3.h"
-#include <string>
-#include <vector>
-#include <sstream>
-#include <typeinfo>
-#include <ostream>
-
-namespace momo
-{
-	typedef int(*sqlite3_callback)(void*, int, char**, char**);
-	typedef void* callback_arg;
-
-	class SQLite3
-	{
-		std::string _name;
-		std::string _errorMessage;
-		bool _success;
-		sqlite3* _database;
-		bool _isOpen;
-	public:
-		/*
-		returns true if sqlite runs is threadsafe mode, false either
-		*/
-		static bool isThreadSafe();
-
-		/*
-		creating an empty object with no database
-		*/
-		SQLite3();
-
-		/*
-		creating an object using already existing database with name provided
-		*/
-		SQLite3(sqlite3* _database, const std::string& name);
-
-		/*
-		creating a new database using name provided
-		example: SQLite3 db("myDB.dblite");
-		*/
-		SQLite3(const std::string& name);
-
-		/*
-		returns true if database is opened, false either
-		*/
-		bool isOpen() const;
-
-
-		/*
-		returns true if last operation was successful (no errors), false either
-		*/
-		bool success() const;
-
-		/*
-		returns last error message accured in the database
-		*/
-		const std::string& getErrorMessage() const;
-
-		/*
-		open/create new db using name provided
-		if another db was already opened, it will be closed before
-		returns true on success, false on failure
-		*/
-		bool open(const std::string& name);
-
-		/*
-		execute an SQL command (as string)
-		if an error accurs, it can be got using getErrorMessage() method
-		returns true on success, false on failure
-		*/
-		bool execute(const std::string& SQL);
-
-		/*
-		execute an SQL command (as string) with callback function
-		if an error accurs, it can be got using getErrorMessage() method
-		returns true on success, false on failure
-		*/
-		bool execute(const std::string& SQL, sqlite3_callback function, callback_arg arg);
-
-		/*
-		execute an SQL command (as string) passed usign << operator
-		if an error accurs, it can be got using getErrorMessage() method
-		*/
-		SQLite3& operator<<(const std::string& SQL);
-
-		/*
-		closes db if it was opened. Automatically called in the destructor
-		*/
-		void close();
-
-		/*
-		automatically calling close() method at the end of object lifetime
-		*/
-		~SQLite3();
-	};
-
-	/*
-	enum of all operations which can be passes as template parameter to SQLBuilder<>
-	*/
-	enum OPERATION
-	{
-		SELECT,
-		INSERT,
-		CREATE,
-		DROP,
-		ALTER,
-		DELETE,
-	};
-
-	/*
-	enum of all types which can be passed to addColumn function in SQLBuilder<CREATE> class
-	*/
-	enum TYPE
-	{
-		INT,
-		TEXT,
-		NUMERIC,
-		REAL,
-		BLOB,
-	};
-	const char* convertType(TYPE type);
-
-	/*
-	enum of predefined Booleans which can be passed to addColumn function in SQLBuilder<CREATE> class
-	*/
-	enum Boolean
-	{
-		IS_NULL = 0,
-		NOT_NULL = 1,
-		PRIMARY_KEY = 1,
-		NOT_PRIMARY_KEY = 0,
-	};
-
-	/*
-	enum of order constants which can be passed to order() function
-	*/
-	enum ORDER
-	{
-		ASC,
-		DESC
-	};
-
-	/*
-	unspecialized template of SQLBuilder
-	*/
-	template<OPERATION op>
-	class SQLBuilder { };
-	
-	/*
-	SQLBuilder class for creating tables in the database
-	*/
-	template<>
-	class SQLBuilder<OPERATION::CREATE>
-	{
-		std::vector<std::string> _columns;
-	public:
-		/*
-		name of table in the database
-		*/
-		std::string tableName;
-
-		/*
-		creates object with _table = "UNNAMED"
-		_table can be set later by using SQLBuilder.table = "ANY NAME";
-		*/
-		SQLBuilder();
-
-		/*
-		table will be created with name passed into constructor
-		*/
-		SQLBuilder(std::string tableName);
-
-		/*
-		adds column to the table
-
-		example: 
-		addColumn("NAME", Type::TEXT, NOT_NULL, PRIMARY_KEY) produces
-				  "NAME TEXT NOT NULL PRIMARY KEY"
-		*/
-		SQLBuilder<OPERATION::CREATE>& addColumn(const std::string& name, TYPE type, bool isNull = IS_NULL, bool isPrimaryKey = NOT_PRIMARY_KEY);
-
-		/*
-		adds column to the table
-
-		example:
-		addColumn("NAME", "TEXT", NOT_NULL, PRIMARY_KEY) produces
-				  "NAME TEXT NOT NULL PRIMARY KEY"
-		*/
-		SQLBuilder<OPERATION::CREATE>& addColumn(const std::string& name, const std::string& type, bool isNull = IS_NULL, bool isPrimaryKey = NOT_PRIMARY_KEY);
-
-		/*
-		adds column to the table using default SQL
-
-		example:
-		SQLBuilder << "NAME TEXT NOT NULL PRIMARY KEY";
-		*/
-		SQLBuilder<OPERATION::CREATE>& operator<<(std::string column);
-
-		/*
-		converts SQLBuilder object to SQL 
-		can be passed to execute method of database: execute(sqlBuilder)
-		*/
-		operator std::string() const;
-	};
-
-	/*
-	SQLBuilder class for inserting values in the database
-	*/
-	template<>
-	class SQLBuilder<OPERATION::INSERT>
-	{
-		std::string _insertionLine;
-		std::vector<std::string> _values;
-	public:
-		/*
-		values will be inserted into table with name passed into constructor
-		VALUES(...) are set using `values` variable
-		
-		example:
-		SQLBuilder builer("MYTABLE", "ID, NAME, AGE");
-		will produce line: INSERT INTO MYTABLE (ID, NAME, AGE)
-		*/
-		SQLBuilder(const std::string& tableName, const std::string& values);
-
-		/*
-		adds values to the SQL INSERT request
-
-		example:
-		addValues("122, 'ALEX', 23");
-		will produce line: VALUES (122, 'ALEX', 23)
-
-		hint: use pack(args...) to create a single line from multiple parameters
-		*/
-		SQLBuilder<OPERATION::INSERT>& addValues(std::string values);
-
-		/*
-		converts SQLBuilder object to SQL
-		can be passed to execute method of database: execute(sqlBuilder)
-		*/
-		operator std::string() const;
-	};
-
-	/*
-	SQLBuilder class for selecting values from the database
-	*/
-	template<>
-	class SQLBuilder<OPERATION::SELECT>
-	{
-		std::string _columns;
-		std::string _tableName;
-		std::string _whereExpression;
-		std::string _orderExpression;
-		std::string _havingExpression;
-	public:
-		/*
-		callback function which will be called after select execution
-		*/
-		momo::sqlite3_callback callback;
-
-		/*
-		callback arg for callback function (see callback class member)
-		*/
-		momo::callback_arg callbackArg;
-
-		/*
-		initialize SQLBuilder with table name
-		by default, instance will select * from database
-		*/
-		SQLBuilder(std::string tableName);
-		/*
-		initalize SQLBuilder with table name and columns
-		to select all columns (*), use SQLBuilder(tableName) constructor
-		to set alias for columns, use addColumn(columnName, alias) method
-		*/
-		SQLBuilder(std::string tableName, std::string columns);
-
-		/*
-		adds column to select statement
-		for alias use addColumn(columnName, alias) instead
-		*/
-		SQLBuilder<OPERATION::SELECT>& addColumn(const std::string& columnName);
-
-		/*
-		adds column to select statement as alias provided
-		*/
-		SQLBuilder<OPERATION::SELECT>& addColumn(const std::string& columnName, const std::string& alias);
-
-	    /*
-		adds WHERE expression to the select statement. 
-		This method can be called multiple times and expressions will be concatenated with `AND`
-		example: sqlBuilder.where("ID < 1000").where("NAME = 'Alex'");
-		will produce: WHERE (ID < 1000) AND (NAME = 'Alex')
-		*/
-		SQLBuilder<OPERATION::SELECT>& where(const std::string& whereExpression);
-
-		/*
-		add ORDER BY expression to select statement. 
-		This method can be called multiple times to get multiple-row order
-		example: sqlBuilder.orderBy("NAME", ORDER::ASC).orderBy("AGE", ORDER::DESC);
-		will produce: ORDER BY NAME ASC, AGE DESC
-		*/
-		momo::SQLBuilder<momo::OPERATION::SELECT>& orderBy(const std::string& column, momo::ORDER order = ORDER::ASC);
-
-		/*
-		converts SQLBuilder object to SQL
-		can be passed to execute method of database: execute(sqlBuilder)
-		*/
-		operator std::string() const;
-	};
-
-	/*
-	SQLBuilder class for droping tables
-	*/
-	template<>
-	class SQLBuilder<OPERATION::DROP>
-	{
-		std::string _tableName;
-	public:
-		/*
-		initialize SQLBuilder object with table names
-		*/
-		SQLBuilder(std::string tableName);
-
-		/*
-		converts SQLBuilder object to SQL
-		can be passed to execute method of database: execute(sqlBuilder)
-		*/
-		operator std::string() const;
-	};
-
-	/*
-	SQLBuilder class for altering and tables
-	*/
-	template<>
-	class SQLBuilder<OPERATION::ALTER>
-	{
-		std::string _tableName;
-		std::string _newName;
-		std::vector<std::string> _newColumns;
-		std::vector<std::pair<std::string, std::string> > _renamedColumns;
-	public: 
-		/*
-		initialize SQLBuilder with table name
-		*/
-		SQLBuilder(std::string tableName);
-
-		/*
-		renames table using new name provided
-		*/
-		SQLBuilder<OPERATION::ALTER>& rename(const std::string newName);
-
-		/*
-		adds columns to the database. 
-		example: SQLBuilder.addColumn("NAME", TYPE::TEXT, NOT_NULL);
-		will produce: {database} ADD NAME TEXT NOT NULL;
-		*/
-		SQLBuilder<OPERATION::ALTER>& addColumn(const std::string& name, TYPE type, bool isNull = IS_NULL);
-
-		/*
-		adds columns to the database.
-		example: SQLBuilder.addColumn("NAME", "TEXT", NOT_NULL);
-		will produce: {database} ADD NAME TEXT NOT NULL;
-		*/
-		SQLBuilder<OPERATION::ALTER>& addColumn(const std::string & name, const std::string& type, bool isNull = IS_NULL);
-
-		/*
-		renames column in the database
-		example: SQLBuilder.renameColumn("NAME", "SURNAME");
-		will produce: {database} RENAME COLUMN NAME to SURNAME;
-		*/
-		SQLBuilder<OPERATION::ALTER>& renameColumn(const std::string& columnName, const std::string& newColumnName);
-
-		/*
-		executes SQLBuilder commands. 
-		SQLbuilder<ALTER> creates multiple commands to DB, so no std::string operator provided
-		*/
-		friend SQLite3& operator<<(SQLite3& database, const SQLBuilder<OPERATION::ALTER>& sql);
-	};
-
-	template<>
-	class SQLBuilder<OPERATION::DELETE>
-	{
-		std::string _tableName;
-		std::string _whereExpression;
-	public:
-		/*
-		initialize SQLBuilder object with table name
-		*/
-		SQLBuilder(std::string tableName);
-		
-		/*
-		adds WHERE expression to the delete statement.
-		This method can be called multiple times and expressions will be concatenated with `AND`
-		example: sqlBuilder.where("ID < 1000").where("NAME = 'Alex'");
-		will produce: WHERE (ID < 1000) AND (NAME = 'Alex')
-		*/
-		SQLBuilder<OPERATION::DELETE>& where(const std::string& whereExpression);
-
-		operator std::string() const;
-	};
-
-	SQLite3& operator<<(SQLite3& database, const SQLBuilder<OPERATION::SELECT>& sql);
-
-	/*
-	template specialization for 1 argument
-	for more info, see pack(args...) declaration
-	*/
-	template<typename Last>
-	std::string pack(Last arg)
-	{
-		std::stringstream out;
-		auto& type = typeid(arg);
-		if (type == typeid(const char*) || type == typeid(char*) || type == typeid(std::string))
-		{
-			out << "'" << arg << "'";
-		}
-		else
-		{
-			out << arg;
-		}
-		return out.str();
-	}
-
-	/*
-	creates a single line of values from parameters and can be passed into SQLBuilder methods
-
-	example:
-	pack(122, "ALEX", 23) will return "122, 'ALEX', 23"
-	*/
-	template<typename First, typename... Other>
-	std::string pack(First arg, Other... args)
-	{
-		std::stringstream out;
-		auto& type = typeid(arg);
-		if (type == typeid(const char*) || type == typeid(char*) || type == typeid(std::string))
-		{
-			out << "'" << arg << "', ";
-		}
-		else
-		{
-			out << arg << ", ";
-		}
-		out << pack(args...);
-		return out.str();
-	}
+#pragma once
+
+#include "sqlite3.h"
+#include <string>
+#include <vector>
+#include <sstream>
+#include <typeinfo>
+#include <ostream>
+#include <new>
+#include <exception>
+#include <type_traits>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <chrono>
+#include <atomic>
+#include <array>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+
+namespace momo
+{
+	typedef int(*sqlite3_callback)(void*, int, char**, char**);
+	typedef void* callback_arg;
+
+	namespace detail
+	{
+		struct ViewDefinition;
+
+		/*
+		returns index of result column with name provided (table qualifier is ignored, case-insensitive),
+		-1 if there is none
+		*/
+		int findColumn(const std::vector<std::string>& columns, std::string name);
+	}
+
+	template<typename T>
+	class TableView;
+
+	/*
+	SQL value which can be bound to statement parameters or read from query results
+	arrays do not own their elements: memory must stay alive while statement is executed
+	*/
+	class Value
+	{
+	public:
+		enum Type
+		{
+			NULL_VALUE,
+			INTEGER,
+			REAL,
+			TEXT,
+			BLOB,
+			ARRAY,
+		};
+
+		/*
+		reference to C++ array which is bound as a single parameter and read with momo_array() table-valued function
+		example: SELECT * FROM COMPANY WHERE ID IN momo_array(?1);
+		*/
+		struct Array
+		{
+			enum Element
+			{
+				INT64,
+				STRING,
+				STRING_VIEW,
+			};
+			Element element;
+			const void* data;
+			size_t count;
+		};
+	private:
+		Type _type;
+		sqlite3_int64 _integer;
+		double _real;
+		std::string _text;
+		Array _array;
+	public:
+		/*
+		creates NULL value
+		*/
+		Value();
+		Value(std::nullptr_t);
+		Value(int value);
+		Value(long value);
+		Value(long long value);
+		Value(unsigned value);
+		Value(unsigned long value);
+
+		/*
+		values above INT64_MAX do not fit INTEGER and are stored as REAL, as SQLite does with such literals
+		*/
+		Value(unsigned long long value);
+		Value(double value);
+		Value(const char* value);
+		Value(std::string value);
+
+		/*
+		creates BLOB value copying `size` bytes from data
+		*/
+		static Value blob(const void* data, size_t size);
+
+		/*
+		creates array value referencing `count` elements (see Value::Array)
+		elements are not copied and must outlive execution of statement the value is bound to
+		*/
+		static Value array(const std::int64_t* data, size_t count);
+		static Value array(const std::string* data, size_t count);
+		static Value array(const std::string_view* data, size_t count);
+
+		/*
+		creates value copying SQLite value provided
+		*/
+		static Value from(sqlite3_value* value);
+
+		Type type() const;
+		bool isNull() const;
+		sqlite3_int64 asInteger() const;
+		double asReal() const;
+
+		/*
+		returns text of TEXT value or bytes of BLOB value
+		*/
+		const std::string& asText() const;
+		const Array& asArray() const;
+
+		/*
+		compares values in SQLite order: NULL < INTEGER / REAL < TEXT < BLOB, TEXT with BINARY collation
+		returns negative number if left is less than right, zero if they are equal and positive number either
+		*/
+		static int compare(const Value& left, const Value& right);
+	};
+
+	/*
+	flag which cancels queries it was passed to through QueryLimits. Can be cancelled from any thread
+	*/
+	class CancellationToken
+	{
+		std::atomic<bool> _cancelled;
+	public:
+		CancellationToken();
+
+		CancellationToken(const CancellationToken&) = delete;
+		CancellationToken& operator=(const CancellationToken&) = delete;
+
+		/*
+		requests cancellation. Running queries stop at their next progress check with SQLITE_INTERRUPT
+		*/
+		void cancel();
+
+		bool isCancelled() const;
+
+		/*
+		clears cancellation, so token can be used for new queries
+		*/
+		void reset();
+	};
+
+	/*
+	limits of a single query, checked by sqlite3_progress_handler while statement runs
+	query which exceeds its limits is interrupted and fails with SQLITE_INTERRUPT
+	*/
+	struct QueryLimits
+	{
+		/*
+		maximal execution time, zero for no limit
+		for statements time is counted from the first step() after setLimits() or reset()
+		*/
+		std::chrono::milliseconds timeout = std::chrono::milliseconds(0);
+
+		/*
+		token which cancels the query, nullptr for none. Token must stay alive while query runs
+		*/
+		const CancellationToken* token = nullptr;
+
+		/*
+		maximal number of virtual machine instructions, zero for no limit
+		checked with precision of checkInterval instructions
+		*/
+		std::uint64_t maxSteps = 0;
+
+		/*
+		number of virtual machine instructions between checks of the limits
+		*/
+		int checkInterval = 1000;
+	};
+
+	namespace detail
+	{
+		struct HookState;
+
+		struct QueryGuard
+		{
+			QueryLimits limits;
+			bool enabled = false;
+			bool started = false;
+			std::chrono::steady_clock::time_point deadline;
+
+			/*
+			instructions run since start, counted by progress handler calls
+			*/
+			std::uint64_t steps = 0;
+
+			/*
+			returns error message if limits are exceeded, nullptr either
+			*/
+			const char* check() const;
+
+			/*
+			sqlite3_progress_handler callback, guard is passed as argument
+			*/
+			static int progress(void* guard);
+		};
+	}
+
+	/*
+	prepared SQL statement. Created by SQLite3::prepare() and finalized in destructor
+	statement can be executed multiple times by calling reset() and binding new parameters
+	*/
+	class Statement
+	{
+		sqlite3_stmt* _statement;
+		std::string _errorMessage;
+		bool _success;
+		detail::QueryGuard _guard;
+		detail::HookState* _hooks;
+
+		bool checkResult(int code);
+
+		/*
+		statement prepared by connection, step hooks of the connection are called around its steps
+		*/
+		Statement(sqlite3_stmt* statement, detail::HookState* hooks);
+
+		friend class SQLite3;
+	public:
+		/*
+		creating an empty statement
+		*/
+		Statement();
+
+		/*
+		taking ownership of statement prepared outside of wrapper
+		*/
+		explicit Statement(sqlite3_stmt* statement);
+
+		Statement(Statement&& other) noexcept;
+		Statement& operator=(Statement&& other) noexcept;
+		Statement(const Statement&) = delete;
+		Statement& operator=(const Statement&) = delete;
+
+		/*
+		returns true if statement was prepared, false either
+		*/
+		bool isPrepared() const;
+
+		/*
+		returns true if last operation was successful (no errors), false either
+		*/
+		bool success() const;
+
+		/*
+		returns last error message accured while executing statement
+		*/
+		const std::string& getErrorMessage() const;
+
+		/*
+		binds value to parameter with index provided (starting from 1)
+		returns true on success, false on failure
+		*/
+		bool bind(int index, const Value& value);
+
+		/*
+		binds values to parameters ?1, ?2, ... in order
+		returns true on success, false on failure
+		*/
+		bool bind(const std::vector<Value>& values);
+
+		/*
+		evaluates statement until next row is ready
+		returns true if row is available, false if statement is done or an error accured (see success())
+		*/
+		bool step();
+
+		/*
+		resets statement so it can be executed again. Bound parameters are kept
+		returns true on success, false on failure
+		*/
+		bool reset();
+
+		/*
+		sets timeout, cancellation token and step limit of the statement (cursor)
+		limits are checked during step() through progress handler of the connection, which replaces
+		any other progress handler while step() runs
+		*/
+		void setLimits(const QueryLimits& limits);
+		void clearLimits();
+
+		/*
+		returns number of virtual machine instructions run by the statement (SQLITE_STMTSTATUS_VM_STEP)
+		*/
+		std::uint64_t vmSteps() const;
+
+		int columnCount() const;
+		const char* columnName(int column) const;
+		const char* columnText(int column) const;
+		Value column(int column) const;
+
+		/*
+		returns raw sqlite3 statement handle
+		*/
+		sqlite3_stmt* handle() const;
+
+		/*
+		finalizes statement. Automatically called in the destructor
+		*/
+		void finalize();
+
+		~Statement();
+	};
+
+	/*
+	options which can be passed to SQLite3::open
+	*/
+	struct OpenOptions
+	{
+		/*
+		flags passed to sqlite3_open_v2, by default database is opened for reading and writing and created if needed
+		*/
+		int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+
+		/*
+		name of VFS used to access database files, empty for default VFS
+		example: options.vfs = URING_VFS; (see SQLiteVFS.h)
+		*/
+		std::string vfs;
+
+		/*
+		size in bytes and number of lookaside memory slots of the connection (SQLITE_DBCONFIG_LOOKASIDE)
+		small allocations of the connection are served from these slots without calling global allocator
+		zero values keep SQLite defaults
+		*/
+		int lookasideSlotSize = 0;
+		int lookasideSlotCount = 0;
+	};
+
+	/*
+	retry policy used when database is locked by another connection (SQLITE_BUSY)
+	instead of failing immediately, connection sleeps with exponential backoff and retries the lock
+	*/
+	struct BusyPolicy
+	{
+		/*
+		delay before the first retry
+		*/
+		std::chrono::microseconds initialDelay = std::chrono::microseconds(100);
+
+		/*
+		upper bound of a single delay
+		*/
+		std::chrono::microseconds maxDelay = std::chrono::milliseconds(50);
+
+		/*
+		factor applied to the delay after each retry
+		*/
+		double multiplier = 2.0;
+
+		/*
+		part of each delay which is randomized (0 - no jitter, 1 - delay is chosen from [0, delay])
+		jitter prevents waiting connections from retrying at the same moment
+		*/
+		double jitter = 0.5;
+
+		/*
+		total time spent waiting for a single lock before SQLITE_BUSY is returned
+		*/
+		std::chrono::milliseconds maxWait = std::chrono::seconds(5);
+	};
+
+	/*
+	counters of busy handler collected since setBusyPolicy() or last reset
+	*/
+	struct BusyStatistics
+	{
+		/*
+		number of times connection found database locked
+		*/
+		std::uint64_t busyEvents;
+
+		/*
+		number of sleeps before retrying the lock
+		*/
+		std::uint64_t retries;
+
+		/*
+		number of busy events which ended with SQLITE_BUSY after maxWait
+		*/
+		std::uint64_t timeouts;
+
+		std::chrono::microseconds totalWait;
+	};
+
+	/*
+	retry settings of SQLite3::writeTransaction()
+	*/
+	struct TransactionPolicy
+	{
+		/*
+		maximal number of times transaction is started, including the first one
+		0 - attempts are not limited, transaction is retried until backoff.maxWait is spent
+		*/
+		int maxAttempts = 0;
+
+		/*
+		delays between attempts. maxWait limits total time spent in backoff delays
+		*/
+		BusyPolicy backoff;
+	};
+
+	/*
+	counters of SQLite3::writeTransaction() collected since connection was created or last reset
+	*/
+	struct TransactionStatistics
+	{
+		/*
+		upper bounds (in microseconds) of lock wait histogram buckets, last bucket counts longer waits
+		*/
+		static constexpr std::array<long long, 5> LOCK_WAIT_BOUNDS = { 100, 1000, 10000, 100000, 1000000 };
+
+		std::uint64_t committed;
+
+		/*
+		transactions which were rolled back because of an error, abort or exhausted attempts
+		*/
+		std::uint64_t failed;
+
+		/*
+		number of times transaction was started, and number of starts after SQLITE_BUSY / SQLITE_LOCKED
+		*/
+		std::uint64_t attempts;
+		std::uint64_t retries;
+
+		/*
+		time from the first attempt until write lock was acquired (BEGIN IMMEDIATE succeeded), by buckets
+		*/
+		std::array<std::uint64_t, LOCK_WAIT_BOUNDS.size() + 1> lockWait;
+	};
+
+	namespace detail
+	{
+		struct TransactionState
+		{
+			std::atomic<std::uint64_t> committed{ 0 };
+			std::atomic<std::uint64_t> failed{ 0 };
+			std::atomic<std::uint64_t> attempts{ 0 };
+			std::atomic<std::uint64_t> retries{ 0 };
+			std::array<std::atomic<std::uint64_t>, TransactionStatistics::LOCK_WAIT_BOUNDS.size() + 1> lockWait{};
+		};
+
+		struct BusyState
+		{
+			BusyPolicy policy;
+			bool installed = false;
+			std::chrono::steady_clock::time_point eventStart;
+			std::uint64_t random = 0;
+			std::atomic<std::uint64_t> busyEvents{ 0 };
+			std::atomic<std::uint64_t> retries{ 0 };
+			std::atomic<std::uint64_t> timeouts{ 0 };
+			std::atomic<std::uint64_t> waitMicroseconds{ 0 };
+		};
+	}
+
+	/*
+	called for each row changed by the connection: operation is SQLITE_INSERT, SQLITE_UPDATE or SQLITE_DELETE
+	*/
+	typedef std::function<void(int operation, const char* database, const char* table, sqlite3_int64 rowid)> UpdateHook;
+
+	/*
+	called when transaction of the connection is about to be committed / was rolled back
+	*/
+	typedef std::function<void()> CommitHook;
+	typedef std::function<void()> RollbackHook;
+
+	/*
+	called after transaction was committed to WAL database with number of pages in the log (sqlite3_wal_hook)
+	*/
+	typedef std::function<void(const char* database, int pages)> WalHook;
+
+	/*
+	called while statements are prepared with arguments of sqlite3_set_authorizer callback
+	returns SQLITE_OK, SQLITE_IGNORE or SQLITE_DENY
+	*/
+	typedef std::function<int(int action, const char* first, const char* second, const char* database, const char* trigger)> Authorizer;
+
+	/*
+	called before each step of statement executed through wrapper (finished is false) and after it with result of the step
+	(SQLITE_ROW, SQLITE_DONE or error code). Steps of different statements may be nested, e.g. by user-defined functions
+	*/
+	typedef std::function<void(sqlite3_stmt* statement, bool finished, int result)> StepHook;
+
+	namespace detail
+	{
+		/*
+		hooks of a connection. SQLite supports one hook of each kind, so wrapper dispatches it to all added hooks
+		*/
+		struct HookState
+		{
+			mutable std::mutex mutex;
+			int nextId = 1;
+			std::vector<std::pair<int, UpdateHook>> update;
+			std::vector<std::pair<int, CommitHook>> commit;
+			std::vector<std::pair<int, RollbackHook>> rollback;
+			std::vector<std::pair<int, WalHook>> wal;
+			std::vector<std::pair<int, Authorizer>> authorizers;
+			std::vector<std::pair<int, StepHook>> step;
+
+			/*
+			number of step hooks, checked by Statement::step() without locking
+			*/
+			std::atomic<size_t> stepHooks{ 0 };
+
+			/*
+			WAL hook replaces automatic checkpoints of SQLite, so dispatcher runs them with this threshold
+			*/
+			int autoCheckpoint = 1000;
+
+			/*
+			sqlite3_set_authorizer expires prepared statements and sqlite3_wal_hook resets automatic checkpoints,
+			so they are called only when dispatchers are installed or removed
+			*/
+			bool walInstalled = false;
+			bool authorizerInstalled = false;
+		};
+
+		/*
+		prepared statements of a connection keyed by SQL, least recently used statements are finalized first
+		*/
+		struct StatementCache
+		{
+			std::list<std::pair<std::string, Statement>> entries;
+			std::unordered_map<std::string, std::list<std::pair<std::string, Statement>>::iterator> index;
+			size_t capacity = 64;
+			std::uint64_t hits = 0;
+			std::uint64_t misses = 0;
+
+			/*
+			returns cached statement moving it to the front, nullptr if SQL is not cached
+			*/
+			Statement* find(const std::string& SQL);
+			Statement* insert(const std::string& SQL, Statement statement);
+			void clear();
+		};
+	}
+
+	/*
+	counters of statement cache used by SQLite3::executeCached()
+	*/
+	struct StatementCacheStatistics
+	{
+		std::uint64_t hits;
+		std::uint64_t misses;
+		size_t entries;
+	};
+
+	class SQLite3;
+
+	/*
+	write transaction passed to the closure of SQLite3::writeTransaction()
+	commands should be executed through the transaction, so it can tell lock errors from other errors
+	*/
+	class Transaction
+	{
+		SQLite3& _database;
+		int _attempt;
+		bool _busy;
+		bool _failed;
+		bool _aborted;
+	public:
+		Transaction(SQLite3& database, int attempt);
+
+		Transaction(const Transaction&) = delete;
+		Transaction& operator=(const Transaction&) = delete;
+
+		/*
+		returns connection transaction runs on
+		*/
+		SQLite3& database();
+
+		/*
+		returns number of current attempt, starting from 1
+		*/
+		int attempt() const;
+
+		/*
+		execute an SQL command inside transaction
+		returns true on success, false on failure
+		*/
+		bool execute(const std::string& SQL);
+
+		/*
+		execute an SQL command with parameters ?1, ?2, ... inside transaction
+		returns true on success, false on failure
+		*/
+		bool execute(const std::string& SQL, const std::vector<Value>& parameters);
+
+		/*
+		execute an SQL command inside transaction passed usign << operator
+		*/
+		Transaction& operator<<(const std::string& SQL);
+
+		/*
+		records result of a call made directly on database() (statements, builders)
+		returns result passed
+		*/
+		bool check(bool result);
+
+		/*
+		rolls transaction back after the closure returns, without retrying
+		*/
+		void abort();
+
+		/*
+		returns true if a command failed because database was locked, false either
+		*/
+		bool isBusy() const;
+
+		/*
+		returns true if a command failed or transaction was aborted, false either
+		*/
+		bool isFailed() const;
+	};
+	typedef Transaction Tx;
+
+	class SQLite3
+	{
+		std::string _name;
+		OpenOptions _options;
+		std::string _errorMessage;
+		bool _success;
+		sqlite3* _database;
+		bool _isOpen;
+		detail::BusyState _busy;
+		detail::TransactionState _transactions;
+		std::uint64_t _lastVMSteps;
+		detail::HookState _hooks;
+		detail::StatementCache _statements;
+
+		/*
+		installs sqlite3 hooks which dispatch to hooks added to the connection
+		*/
+		void installHooks();
+
+		/*
+		sqlite3_busy_handler callback, sleeps according to BusyPolicy of the connection
+		*/
+		static int busyHandler(void* database, int count);
+
+		/*
+		runs body in BEGIN IMMEDIATE transaction, retrying it while database is locked
+		*/
+		bool runWriteTransaction(const std::function<bool(Transaction&)>& body, const TransactionPolicy& policy);
+
+		/*
+		stores result of sqlite3 API call and copies error message from the database on failure
+		returns true if code is SQLITE_OK, false either
+		*/
+		bool checkResult(int code);
+
+		/*
+		registers eponymous virtual table module which reads rows described by definition
+		*/
+		bool createTableView(const std::string& name, const detail::ViewDefinition& definition);
+	public:
+		/*
+		returns true if sqlite runs is threadsafe mode, false either
+		*/
+		static bool isThreadSafe();
+
+		/*
+		creating an empty object with no database
+		*/
+		SQLite3();
+
+		/*
+		creating an object using already existing database with name provided
+		*/
+		SQLite3(sqlite3* _database, const std::string& name);
+
+		/*
+		creating a new database using name provided
+		example: SQLite3 db("myDB.dblite");
+		*/
+		SQLite3(const std::string& name);
+
+		SQLite3(const SQLite3&) = delete;
+		SQLite3& operator=(const SQLite3&) = delete;
+
+		/*
+		returns true if database is opened, false either
+		*/
+		bool isOpen() const;
+
+		/*
+		returns raw sqlite3 database handle, nullptr if database is not opened
+		*/
+		sqlite3* handle() const;
+
+		/*
+		returns name of database passed to open() or constructor
+		*/
+		const std::string& getName() const;
+
+
+		/*
+		returns true if last operation was successful (no errors), false either
+		*/
+		bool success() const;
+
+		/*
+		returns last error message accured in the database
+		*/
+		const std::string& getErrorMessage() const;
+
+		/*
+		open/create new db using name provided
+		if another db was already opened, it will be closed before
+		returns true on success, false on failure
+		*/
+		bool open(const std::string& name);
+
+		/*
+		open/create new db using name and options provided
+		if another db was already opened, it will be closed before
+		returns true on success, false on failure
+		*/
+		bool open(const std::string& name, const OpenOptions& options);
+
+		/*
+		returns options passed to the last open(), so other connections to the database can be opened the same way
+		*/
+		const OpenOptions& getOpenOptions() const;
+
+		/*
+		execute an SQL command (as string)
+		if an error accurs, it can be got using getErrorMessage() method
+		returns true on success, false on failure
+		*/
+		bool execute(const std::string& SQL);
+
+		/*
+		execute an SQL command (as string) with callback function
+		if an error accurs, it can be got using getErrorMessage() method
+		returns true on success, false on failure
+		*/
+		bool execute(const std::string& SQL, sqlite3_callback function, callback_arg arg);
+
+		/*
+		execute an SQL command (as string) with parameters ?1, ?2, ... bound to values provided
+		if SQL has multiple commands, parameters are bound to the first one, and commands after it must have none
+		callback function is called for each row as in sqlite3_exec
+		if an error accurs, it can be got using getErrorMessage() method
+		returns true on success, false on failure
+		*/
+		bool execute(const std::string& SQL, const std::vector<Value>& parameters, sqlite3_callback function = nullptr, callback_arg arg = nullptr);
+
+		/*
+		execute an SQL command with parameters and limits provided. Timeout is shared by all commands of SQL
+		if limits are exceeded, execution is interrupted and error message tells the reason
+		example:
+		QueryLimits limits; limits.timeout = std::chrono::milliseconds(200);
+		db.execute(SQLBuilder<SELECT>("COMPANY"), {}, limits, callback, nullptr);
+		returns true on success, false on failure
+		*/
+		bool execute(const std::string& SQL, const std::vector<Value>& parameters, const QueryLimits& limits, sqlite3_callback function = nullptr, callback_arg arg = nullptr);
+
+		/*
+		returns number of virtual machine instructions run by the last execute() with parameters or limits
+		*/
+		std::uint64_t getLastVMSteps() const;
+
+		/*
+		interrupts all queries running on the connection. Can be called from any thread
+		*/
+		void interrupt();
+
+		/*
+		adds hook called for each row changed by the connection (sqlite3_update_hook)
+		hooks are called in the thread executing statement and must not use the connection
+		returns id of the hook which can be passed to removeHook()
+		*/
+		int addUpdateHook(UpdateHook hook);
+
+		/*
+		adds hook called before transaction is committed (sqlite3_commit_hook)
+		returns id of the hook which can be passed to removeHook()
+		*/
+		int addCommitHook(CommitHook hook);
+
+		/*
+		adds hook called after transaction is rolled back (sqlite3_rollback_hook)
+		returns id of the hook which can be passed to removeHook()
+		*/
+		int addRollbackHook(RollbackHook hook);
+
+		/*
+		adds hook called after transaction is committed to WAL database (sqlite3_wal_hook)
+		automatic checkpoints keep working, see setAutoCheckpoint()
+		returns id of the hook which can be passed to removeHook()
+		*/
+		int addWalHook(WalHook hook);
+
+		/*
+		adds authorizer called while statements are prepared (sqlite3_set_authorizer). Action is allowed only if all
+		authorizers allow it, SQLITE_DENY of any authorizer wins over SQLITE_IGNORE. Authorizers must be added
+		through this method, sqlite3_set_authorizer called directly replaces all of them
+		returns id of the hook which can be passed to removeHook()
+		*/
+		int addAuthorizer(Authorizer authorizer);
+
+		/*
+		adds hook called around steps of statements executed through the connection: execute(), executeCached()
+		and statements created by prepare(). Statements run by sqlite3 API directly are not reported
+		returns id of the hook which can be passed to removeHook()
+		*/
+		int addStepHook(StepHook hook);
+
+		/*
+		sets number of WAL pages after which commit runs passive checkpoint, zero disables automatic checkpoints
+		same as sqlite3_wal_autocheckpoint, which must not be used directly while WAL hooks are added
+		applies to the opened database, default of 1000 pages is restored when it is closed
+		*/
+		void setAutoCheckpoint(int pages);
+
+		/*
+		returns number of WAL pages set by setAutoCheckpoint()
+		*/
+		int getAutoCheckpoint() const;
+
+		/*
+		removes hook with id returned by one of add*Hook() methods
+		*/
+		void removeHook(int id);
+
+		/*
+		execute a single SQL command with parameters ?1, ?2, ... bound to values provided through cache of prepared
+		statements, so SQL executed repeatedly is compiled once. Values should be passed as parameters rather than
+		written into SQL, so different values reuse the same statement
+		if an error accurs, it can be got using getErrorMessage() method
+		*/
+		bool executeCached(const std::string& SQL, const std::vector<Value>& parameters = std::vector<Value>(), sqlite3_callback function = nullptr, callback_arg arg = nullptr);
+
+		/*
+		sets number of statements kept by executeCached(), zero disables the cache
+		cached statements are finalized when they are evicted and when connection is closed
+		*/
+		void setStatementCacheSize(size_t size);
+
+		StatementCacheStatistics getStatementCacheStatistics() const;
+
+		/*
+		compiles a single SQL command into statement, which can be executed multiple times
+		returns true on success, false on failure
+		*/
+		bool prepare(const std::string& SQL, Statement& statement);
+
+		/*
+		installs busy handler which retries locked database with jittered exponential backoff
+		policy applies to all statements of the connection (execute, prepare, << operators)
+		and is kept when another database is opened
+		example:
+		BusyPolicy policy; policy.maxWait = std::chrono::seconds(1);
+		db.setBusyPolicy(policy);
+		returns true on success, false on failure
+		*/
+		bool setBusyPolicy(const BusyPolicy& policy);
+
+		/*
+		removes busy handler, so locked database fails immediately with SQLITE_BUSY
+		*/
+		void clearBusyPolicy();
+
+		/*
+		returns busy handler counters of the connection. Can be called from any thread
+		*/
+		BusyStatistics getBusyStatistics() const;
+
+		/*
+		sets all busy handler counters to zero
+		*/
+		void resetBusyStatistics();
+
+		/*
+		returns result code of the last sqlite3 API call on the connection (sqlite3_errcode)
+		*/
+		int getErrorCode() const;
+
+		/*
+		runs closure in a write transaction started with BEGIN IMMEDIATE, so write lock is taken before any work is done.
+		If the lock cannot be acquired or a command fails with SQLITE_BUSY / SQLITE_LOCKED, transaction is rolled back
+		and closure is replayed after backoff delay. Transaction is committed once, after closure succeeds.
+		closure is called as f(Transaction&) and may return bool, false rolls transaction back without retrying
+		exception thrown by closure rolls transaction back and is rethrown
+		must not be called inside another transaction
+		example:
+		db.writeTransaction([&](Tx& tx) { tx << "UPDATE ACCOUNTS SET BALANCE = BALANCE - 10 WHERE ID = 1"; });
+		returns true if transaction was committed, false either
+		*/
+		template<typename Function>
+		bool writeTransaction(Function function, const TransactionPolicy& policy = TransactionPolicy());
+
+		/*
+		returns writeTransaction() counters of the connection. Can be called from any thread
+		*/
+		TransactionStatistics getTransactionStatistics() const;
+
+		/*
+		sets all writeTransaction() counters to zero
+		*/
+		void resetTransactionStatistics();
+
+		/*
+		execute an SQL command (as string) passed usign << operator
+		if an error accurs, it can be got using getErrorMessage() method
+		*/
+		SQLite3& operator<<(const std::string& SQL);
+
+		/*
+		registers an aggregate function with per-group state of type State
+		state lives in place inside sqlite3_aggregate_context(), so no heap allocation is done per group.
+		It is constructed before the first step and destroyed after final
+		step is called as step(State&, int argc, sqlite3_value** argv)
+		final is called as final(State&) and its return value is passed to setResult()
+		example:
+		db.createAggregate<WeightedAverage>("WAVG", step, final, 2);
+		returns true on success, false on failure
+		*/
+		template<typename State, typename Step, typename Final>
+		bool createAggregate(const std::string& name, Step step, Final final, int argumentCount = -1);
+
+		/*
+		registers an aggregate window function with per-group state of type State
+		step and inverse are called as f(State&, int argc, sqlite3_value** argv) when rows enter or leave the frame
+		value and final are called as f(State&) and return the current / final result of the window
+		returns true on success, false on failure
+		*/
+		template<typename State, typename Step, typename Inverse, typename Current, typename Final>
+		bool createWindowFunction(const std::string& name, Step step, Inverse inverse, Current value, Final final, int argumentCount = -1);
+
+		/*
+		exposes rows of TableView as read-only SQL table with name provided, without copying them
+		memory viewed must stay alive and unchanged while the connection is open
+		example:
+		db.createTableView("EMPLOYEES", TableView<Employee>(employees).addKeyColumn("ID", &Employee::id));
+		db << "SELECT * FROM EMPLOYEES JOIN COMPANY ON EMPLOYEES.ID = COMPANY.ID";
+		returns true on success, false on failure
+		*/
+		template<typename T>
+		bool createTableView(const std::string& name, const TableView<T>& view);
+
+		/*
+		closes db if it was opened. Automatically called in the destructor
+		*/
+		void close();
+
+		/*
+		automatically calling close() method at the end of object lifetime
+		*/
+		~SQLite3();
+	};
+
+	/*
+	enum of all operations which can be passes as template parameter to SQLBuilder<>
+	*/
+	enum OPERATION
+	{
+		SELECT,
+		INSERT,
+		CREATE,
+		DROP,
+		ALTER,
+		DELETE,
+		UPDATE,
+	};
+
+	/*
+	enum of all types which can be passed to addColumn function in SQLBuilder<CREATE> class
+	*/
+	enum TYPE
+	{
+		INT,
+		TEXT,
+		NUMERIC,
+		REAL,
+		BLOB,
+	};
+	const char* convertType(TYPE type);
+
+	/*
+	enum of predefined Booleans which can be passed to addColumn function in SQLBuilder<CREATE> class
+	*/
+	enum Boolean
+	{
+		IS_NULL = 0,
+		NOT_NULL = 1,
+		PRIMARY_KEY = 1,
+		NOT_PRIMARY_KEY = 0,
+	};
+
+	/*
+	enum of order constants which can be passed to order() function
+	*/
+	enum ORDER
+	{
+		ASC,
+		DESC
+	};
+
+	/*
+	enum of aggregate functions which can be passed to aggregate() function of SQLBuilder<SELECT>
+	*/
+	enum AGGREGATE
+	{
+		COUNT,
+		SUM,
+		AVG,
+		MIN,
+		MAX,
+	};
+
+	/*
+	unspecialized template of SQLBuilder
+	*/
+	template<OPERATION op>
+	class SQLBuilder { };
+	
+	/*
+	SQLBuilder class for creating tables in the database
+	*/
+	template<>
+	class SQLBuilder<OPERATION::CREATE>
+	{
+		std::vector<std::string> _columns;
+	public:
+		/*
+		name of table in the database
+		*/
+		std::string tableName;
+
+		/*
+		creates object with _table = "UNNAMED"
+		_table can be set later by using SQLBuilder.table = "ANY NAME";
+		*/
+		SQLBuilder();
+
+		/*
+		table will be created with name passed into constructor
+		*/
+		SQLBuilder(std::string tableName);
+
+		/*
+		adds column to the table
+
+		example: 
+		addColumn("NAME", Type::TEXT, NOT_NULL, PRIMARY_KEY) produces
+				  "NAME TEXT NOT NULL PRIMARY KEY"
+		*/
+		SQLBuilder<OPERATION::CREATE>& addColumn(const std::string& name, TYPE type, bool isNull = IS_NULL, bool isPrimaryKey = NOT_PRIMARY_KEY);
+
+		/*
+		adds column to the table
+
+		example:
+		addColumn("NAME", "TEXT", NOT_NULL, PRIMARY_KEY) produces
+				  "NAME TEXT NOT NULL PRIMARY KEY"
+		*/
+		SQLBuilder<OPERATION::CREATE>& addColumn(const std::string& name, const std::string& type, bool isNull = IS_NULL, bool isPrimaryKey = NOT_PRIMARY_KEY);
+
+		/*
+		adds column to the table using default SQL
+
+		example:
+		SQLBuilder << "NAME TEXT NOT NULL PRIMARY KEY";
+		*/
+		SQLBuilder<OPERATION::CREATE>& operator<<(std::string column);
+
+		/*
+		converts SQLBuilder object to SQL 
+		can be passed to execute method of database: execute(sqlBuilder)
+		*/
+		operator std::string() const;
+	};
+
+	/*
+	SQLBuilder class for inserting values in the database
+	*/
+	template<>
+	class SQLBuilder<OPERATION::INSERT>
+	{
+		/*
+		row of VALUES: text of addValues() row, or number of addRow() values taken from _parameters
+		*/
+		struct Row
+		{
+			std::string literal;
+			size_t bound;
+		};
+
+		std::string _insertionLine;
+		std::vector<Row> _rows;
+		std::vector<Value> _parameters;
+		std::string _conflictTarget;
+		std::string _conflictAction;
+
+		/*
+		renders one statement inserting rows [first, last), parameters are numbered from ?1
+		*/
+		std::string render(size_t first, size_t last) const;
+	public:
+		/*
+		bound rows are inserted by statements of at most MAX_BOUND_ROWS rows and MAX_BOUND_VALUES parameters
+		(SQLITE_MAX_VARIABLE_NUMBER of SQLite before 3.32)
+		*/
+		static constexpr size_t MAX_BOUND_ROWS = 64;
+		static constexpr size_t MAX_BOUND_VALUES = 999;
+
+		/*
+		values will be inserted into table with name passed into constructor
+		VALUES(...) are set using `values` variable
+		
+		example:
+		SQLBuilder builer("MYTABLE", "ID, NAME, AGE");
+		will produce line: INSERT INTO MYTABLE (ID, NAME, AGE)
+		*/
+		SQLBuilder(const std::string& tableName, const std::string& values);
+
+		/*
+		adds values to the SQL INSERT request
+
+		example:
+		addValues("122, 'ALEX', 23");
+		will produce line: VALUES (122, 'ALEX', 23)
+
+		hint: use pack(args...) to create a single line from multiple parameters
+		*/
+		SQLBuilder<OPERATION::INSERT>& addValues(std::string values);
+
+		/*
+		adds row of values bound as parameters ?1, ?2, ...
+		example: addRow({ 122, "ALEX", 23 });
+		will produce line: VALUES (?1, ?2, ?3)
+		once a row is bound, rows are inserted by multi-row statements: VALUES (...), (...), ...
+		each of a power-of-two number of rows up to MAX_BOUND_ROWS (fewer if they would exceed MAX_BOUND_VALUES),
+		so any number of rows is inserted by a few distinct statements of SQLite3::executeCached()
+		bound rows must be inserted by operator<<, executeBatch() or WriteQueue::submit(), which run statements()
+		*/
+		SQLBuilder<OPERATION::INSERT>& addRow(const std::vector<Value>& values);
+
+		/*
+		sets conflict target of UPSERT, followed by doNothing() or doUpdate()
+		columns must match PRIMARY KEY or UNIQUE index of the table, can be empty for doNothing()
+		example: onConflict("ID").doUpdate("AGE = excluded.AGE");
+		will produce line: ON CONFLICT (ID) DO UPDATE SET AGE = excluded.AGE
+		*/
+		SQLBuilder<OPERATION::INSERT>& onConflict(const std::string& columns);
+
+		/*
+		skips rows conflicting with existing ones: ON CONFLICT ... DO NOTHING
+		*/
+		SQLBuilder<OPERATION::INSERT>& doNothing();
+
+		/*
+		updates existing row instead of inserting conflicting one: ON CONFLICT ... DO UPDATE SET {setExpression} WHERE {whereExpression}
+		inserted values are referred as excluded.{column}
+		*/
+		SQLBuilder<OPERATION::INSERT>& doUpdate(const std::string& setExpression, const std::string& whereExpression = "");
+
+		/*
+		updates listed columns of existing row with inserted values
+		example: doUpdateExcluded({ "NAME", "AGE" });
+		will produce line: DO UPDATE SET NAME = excluded.NAME, AGE = excluded.AGE
+		*/
+		SQLBuilder<OPERATION::INSERT>& doUpdateExcluded(const std::vector<std::string>& columns);
+
+		/*
+		returns values bound to parameters of all statements
+		*/
+		const std::vector<Value>& parameters() const;
+
+		/*
+		returns number of rows added by addValues() and addRow()
+		*/
+		size_t rowCount() const;
+
+		/*
+		returns statements inserting the rows with values bound to their parameters, in order
+		*/
+		std::vector<std::pair<std::string, std::vector<Value>>> statements() const;
+
+		/*
+		converts SQLBuilder object to SQL
+		can be passed to execute method of database: execute(sqlBuilder)
+		with bound rows SQL has all statements(), which cannot be executed with parameters() in one call
+		*/
+		operator std::string() const;
+	};
+
+	/*
+	executes insert with its bound parameters, through statement cache of the database if any row is bound
+	statements() of a builder with bound rows are executed in a write transaction, so either all rows are inserted or none.
+	Inside a transaction of the caller they are executed until one fails, and the caller should roll back on failure
+	*/
+	SQLite3& operator<<(SQLite3& database, const SQLBuilder<OPERATION::INSERT>& sql);
+
+	/*
+	SQLBuilder class for selecting values from the database
+	*/
+	template<>
+	class SQLBuilder<OPERATION::SELECT>
+	{
+		/*
+		table joined to the select, hint is INDEXED BY / NOT INDEXED clause
+		*/
+		struct Join
+		{
+			std::string kind;
+			std::string table;
+			std::string hint;
+			std::string on;
+		};
+
+		std::string _columns;
+		std::string _tableName;
+		std::string _tableHint;
+		std::vector<Join> _joins;
+		std::string _whereExpression;
+		std::string _orderExpression;
+		std::string _groupExpression;
+		std::string _havingExpression;
+		std::vector<Value> _parameters;
+		std::vector<std::pair<std::string, ORDER>> _orderColumns;
+
+		/*
+		arguments of limit(), count is SIZE_MAX without limit
+		*/
+		size_t _limitCount;
+		size_t _limitOffset;
+	public:
+		/*
+		callback function which will be called after select execution
+		*/
+		momo::sqlite3_callback callback;
+
+		/*
+		callback arg for callback function (see callback class member)
+		*/
+		momo::callback_arg callbackArg;
+
+		/*
+		initialize SQLBuilder with table name
+		by default, instance will select * from database
+		*/
+		SQLBuilder(std::string tableName);
+		/*
+		initalize SQLBuilder with table name and columns
+		to select all columns (*), use SQLBuilder(tableName) constructor
+		to set alias for columns, use addColumn(columnName, alias) method
+		*/
+		SQLBuilder(std::string tableName, std::string columns);
+
+		/*
+		adds column to select statement
+		for alias use addColumn(columnName, alias) instead
+		*/
+		SQLBuilder<OPERATION::SELECT>& addColumn(const std::string& columnName);
+
+		/*
+		adds column to select statement as alias provided
+		*/
+		SQLBuilder<OPERATION::SELECT>& addColumn(const std::string& columnName, const std::string& alias);
+
+		/*
+		adds aggregate of column (or expression) to select statement, as alias provided if it is not empty
+		example: sqlBuilder.aggregate(AGGREGATE::SUM, "TOTAL", "REVENUE");
+		will produce: SELECT SUM(TOTAL) AS REVENUE
+		count(), sum(), avg(), min() and max() are shortcuts for the functions
+		*/
+		SQLBuilder<OPERATION::SELECT>& aggregate(AGGREGATE function, const std::string& column, const std::string& alias = "");
+		SQLBuilder<OPERATION::SELECT>& count(const std::string& column = "*", const std::string& alias = "");
+		SQLBuilder<OPERATION::SELECT>& sum(const std::string& column, const std::string& alias = "");
+		SQLBuilder<OPERATION::SELECT>& avg(const std::string& column, const std::string& alias = "");
+		SQLBuilder<OPERATION::SELECT>& min(const std::string& column, const std::string& alias = "");
+		SQLBuilder<OPERATION::SELECT>& max(const std::string& column, const std::string& alias = "");
+
+		/*
+		adds GROUP BY column (or expression) to select statement, so aggregates are computed for each group
+		This method can be called multiple times to group by several columns
+		example: SQLBuilder<SELECT>("ORDERS", "COMPANY").sum("TOTAL", "REVENUE").groupBy("COMPANY");
+		will produce: SELECT COMPANY,SUM(TOTAL) AS REVENUE FROM ORDERS GROUP BY COMPANY
+		*/
+		SQLBuilder<OPERATION::SELECT>& groupBy(const std::string& column);
+
+		/*
+		adds HAVING expression filtering groups by their aggregates, should be used with groupBy()
+		This method can be called multiple times and expressions will be concatenated with `AND`
+		example: sqlBuilder.having("SUM(TOTAL) > 1000");
+		will produce: HAVING (SUM(TOTAL) > 1000)
+		*/
+		SQLBuilder<OPERATION::SELECT>& having(const std::string& havingExpression);
+
+		/*
+		joins table (with optional alias) to the select on expression provided
+		example: SQLBuilder<SELECT>("ORDERS O", "O.ID, C.NAME").innerJoin("COMPANY C", "C.ID = O.COMPANY");
+		will produce: SELECT O.ID, C.NAME FROM ORDERS O INNER JOIN COMPANY C ON (C.ID = O.COMPANY)
+		leftJoin() keeps rows without matching row of the joined table, filling its columns with NULL
+		*/
+		SQLBuilder<OPERATION::SELECT>& innerJoin(const std::string& table, const std::string& on);
+		SQLBuilder<OPERATION::SELECT>& leftJoin(const std::string& table, const std::string& on);
+
+		/*
+		joins table with CROSS JOIN: SQLite query planner keeps tables in the order they are written,
+		so the table before it is always the outer loop. Empty `on` produces cartesian product
+		*/
+		SQLBuilder<OPERATION::SELECT>& crossJoin(const std::string& table, const std::string& on = "");
+
+		/*
+		forces the last added table (FROM table if nothing is joined yet) to be read with index provided
+		(INDEXED BY), or without any index (NOT INDEXED). Statement fails to prepare if index can not be used
+		example: sqlBuilder.innerJoin("COMPANY C", "C.ID = O.COMPANY").indexedBy("COMPANY_ID");
+		will produce: INNER JOIN COMPANY C INDEXED BY COMPANY_ID ON (C.ID = O.COMPANY)
+		*/
+		SQLBuilder<OPERATION::SELECT>& indexedBy(const std::string& index);
+		SQLBuilder<OPERATION::SELECT>& notIndexed();
+
+	    /*
+		adds WHERE expression to the select statement. 
+		This method can be called multiple times and expressions will be concatenated with `AND`
+		example: sqlBuilder.where("ID < 1000").where("NAME = 'Alex'");
+		will produce: WHERE (ID < 1000) AND (NAME = 'Alex')
+		*/
+		SQLBuilder<OPERATION::SELECT>& where(const std::string& whereExpression);
+
+		/*
+		adds `column IN momo_array(?N)` expression to WHERE, binding keys as a single parameter
+		SQL does not depend on number of keys, so the same statement serves key lists of any size
+		keys are not copied and must stay alive until the builder is executed
+		example: sqlBuilder.whereIn("ID", ids);
+		will produce: WHERE (ID IN momo_array(?1))
+		*/
+		SQLBuilder<OPERATION::SELECT>& whereIn(const std::string& column, const std::vector<std::int64_t>& keys);
+		SQLBuilder<OPERATION::SELECT>& whereIn(const std::string& column, const std::vector<std::string>& keys);
+		SQLBuilder<OPERATION::SELECT>& whereIn(const std::string& column, const std::vector<std::string_view>& keys);
+		SQLBuilder<OPERATION::SELECT>& whereIn(const std::string& column, const Value& keys);
+
+		/*
+		returns values bound to parameters of the statement
+		*/
+		const std::vector<Value>& parameters() const;
+
+		/*
+		add ORDER BY expression to select statement. 
+		This method can be called multiple times to get multiple-row order
+		example: sqlBuilder.orderBy("NAME", ORDER::ASC).orderBy("AGE", ORDER::DESC);
+		will produce: ORDER BY NAME ASC, AGE DESC
+		*/
+		momo::SQLBuilder<momo::OPERATION::SELECT>& orderBy(const std::string& column, momo::ORDER order = ORDER::ASC);
+
+		/*
+		returns columns passed to orderBy() with their order
+		*/
+		const std::vector<std::pair<std::string, ORDER>>& orderColumns() const;
+
+		/*
+		limits number of returned rows, skipping `offset` rows first
+		example: sqlBuilder.limit(20, 40);
+		will produce: LIMIT 20 OFFSET 40
+		skipped rows are still read, so prefer after() for deep pages
+		*/
+		SQLBuilder<OPERATION::SELECT>& limit(size_t count, size_t offset = 0);
+
+		/*
+		returns arguments of the last limit() call, count is SIZE_MAX if limit() was not called
+		*/
+		size_t limitCount() const;
+		size_t limitOffset() const;
+
+		/*
+		adds keyset continuation predicate: rows which follow row with orderBy() column values provided.
+		Must be called after orderBy(), keys are bound as parameters
+		example: sqlBuilder.orderBy("NAME").orderBy("ID").after({ "Alex", 5 });
+		will produce: WHERE ((NAME, ID) > (?1, ?2))
+		columns with different orders produce: WHERE ((A > ?1) OR (A = ?1 AND B < ?2))
+		orderBy() columns must be NOT NULL and identify a row together (e.g. end with primary key),
+		with index on them page is found by one index seek however far it is
+		*/
+		SQLBuilder<OPERATION::SELECT>& after(const std::vector<Value>& keys);
+
+		/*
+		converts SQLBuilder object to SQL
+		can be passed to execute method of database: execute(sqlBuilder)
+		*/
+		operator std::string() const;
+	};
+
+	/*
+	SQLBuilder class for droping tables
+	*/
+	template<>
+	class SQLBuilder<OPERATION::DROP>
+	{
+		std::string _tableName;
+	public:
+		/*
+		initialize SQLBuilder object with table names
+		*/
+		SQLBuilder(std::string tableName);
+
+		/*
+		converts SQLBuilder object to SQL
+		can be passed to execute method of database: execute(sqlBuilder)
+		*/
+		operator std::string() const;
+	};
+
+	/*
+	SQLBuilder class for altering and tables
+	*/
+	template<>
+	class SQLBuilder<OPERATION::ALTER>
+	{
+		std::string _tableName;
+		std::string _newName;
+		std::vector<std::string> _newColumns;
+		std::vector<std::pair<std::string, std::string> > _renamedColumns;
+	public: 
+		/*
+		initialize SQLBuilder with table name
+		*/
+		SQLBuilder(std::string tableName);
+
+		/*
+		renames table using new name provided
+		*/
+		SQLBuilder<OPERATION::ALTER>& rename(const std::string newName);
+
+		/*
+		adds columns to the database. 
+		example: SQLBuilder.addColumn("NAME", TYPE::TEXT, NOT_NULL);
+		will produce: {database} ADD NAME TEXT NOT NULL;
+		*/
+		SQLBuilder<OPERATION::ALTER>& addColumn(const std::string& name, TYPE type, bool isNull = IS_NULL);
+
+		/*
+		adds columns to the database.
+		example: SQLBuilder.addColumn("NAME", "TEXT", NOT_NULL);
+		will produce: {database} ADD NAME TEXT NOT NULL;
+		*/
+		SQLBuilder<OPERATION::ALTER>& addColumn(const std::string & name, const std::string& type, bool isNull = IS_NULL);
+
+		/*
+		renames column in the database
+		example: SQLBuilder.renameColumn("NAME", "SURNAME");
+		will produce: {database} RENAME COLUMN NAME to SURNAME;
+		*/
+		SQLBuilder<OPERATION::ALTER>& renameColumn(const std::string& columnName, const std::string& newColumnName);
+
+		/*
+		executes SQLBuilder commands. 
+		SQLbuilder<ALTER> creates multiple commands to DB, so no std::string operator provided
+		*/
+		friend SQLite3& operator<<(SQLite3& database, const SQLBuilder<OPERATION::ALTER>& sql);
+	};
+
+	template<>
+	class SQLBuilder<OPERATION::DELETE>
+	{
+		std::string _tableName;
+		std::string _whereExpression;
+		std::vector<Value> _parameters;
+	public:
+		/*
+		initialize SQLBuilder object with table name
+		*/
+		SQLBuilder(std::string tableName);
+		
+		/*
+		adds WHERE expression to the delete statement.
+		This method can be called multiple times and expressions will be concatenated with `AND`
+		example: sqlBuilder.where("ID < 1000").where("NAME = 'Alex'");
+		will produce: WHERE (ID < 1000) AND (NAME = 'Alex')
+		*/
+		SQLBuilder<OPERATION::DELETE>& where(const std::string& whereExpression);
+
+		/*
+		adds `column IN momo_array(?N)` expression to WHERE, binding keys as a single parameter
+		keys are not copied and must stay alive until the builder is executed
+		see SQLBuilder<SELECT>::whereIn
+		*/
+		SQLBuilder<OPERATION::DELETE>& whereIn(const std::string& column, const std::vector<std::int64_t>& keys);
+		SQLBuilder<OPERATION::DELETE>& whereIn(const std::string& column, const std::vector<std::string>& keys);
+		SQLBuilder<OPERATION::DELETE>& whereIn(const std::string& column, const std::vector<std::string_view>& keys);
+		SQLBuilder<OPERATION::DELETE>& whereIn(const std::string& column, const Value& keys);
+
+		/*
+		returns values bound to parameters of the statement
+		*/
+		const std::vector<Value>& parameters() const;
+
+		operator std::string() const;
+	};
+
+	SQLite3& operator<<(SQLite3& database, const SQLBuilder<OPERATION::SELECT>& sql);
+
+	/*
+	page of rows returned by selectPage()
+	*/
+	struct Page
+	{
+		std::vector<std::string> columns;
+		std::vector<std::vector<Value>> rows;
+
+		/*
+		token passed to selectPage() to read the next page, empty if this page is the last one
+		*/
+		std::string cursor;
+	};
+
+	/*
+	encodes orderBy() column values of a row into opaque cursor token and back
+	decodeCursor() returns false if token is damaged
+	*/
+	std::string encodeCursor(const std::vector<Value>& keys);
+	bool decodeCursor(const std::string& cursor, std::vector<Value>& keys);
+
+	/*
+	reads up to pageSize rows of select which follow cursor (keyset pagination, see SQLBuilder<SELECT>::after),
+	empty cursor reads the first page. orderBy() columns must be among selected columns (matched by name),
+	cursor of the page is built from them, so every page costs the same as the first one
+	returns true on success, false on failure with error stored to errorMessage
+
+	example:
+	Page page;
+	do
+	{
+		selectPage(database, SQLBuilder<SELECT>("COMPANY", "ID, NAME").orderBy("ID"), 100, page.cursor, page);
+		...
+	} while (!page.cursor.empty());
+	*/
+	bool selectPage(SQLite3& database, SQLBuilder<OPERATION::SELECT> sql, size_t pageSize, const std::string& cursor, Page& page, std::string* errorMessage = nullptr);
+
+	SQLite3& operator<<(SQLite3& database, const SQLBuilder<OPERATION::DELETE>& sql);
+
+	/*
+	SQLBuilder class for updating rows of a table
+	values are bound as parameters ?1, ?2, ... numbered in order of calls, so updates built by the same calls
+	produce the same SQL and share one statement of SQLite3::executeCached()
+	*/
+	template<>
+	class SQLBuilder<OPERATION::UPDATE>
+	{
+		std::string _tableName;
+		std::string _setExpression;
+		std::string _whereExpression;
+		std::vector<Value> _parameters;
+	public:
+		/*
+		initialize SQLBuilder object with table name
+		*/
+		SQLBuilder(std::string tableName);
+
+		/*
+		sets column to value provided
+		example: sqlBuilder.set("NAME", "Alex").set("AGE", 32);
+		will produce: UPDATE {table} SET NAME = ?1, AGE = ?2
+		*/
+		SQLBuilder<OPERATION::UPDATE>& set(const std::string& column, const Value& value);
+
+		/*
+		sets column to SQL expression
+		example: sqlBuilder.setExpression("SALARY", "SALARY * 1.1");
+		will produce: UPDATE {table} SET SALARY = SALARY * 1.1
+		*/
+		SQLBuilder<OPERATION::UPDATE>& setExpression(const std::string& column, const std::string& expression);
+
+		/*
+		adds WHERE expression to the update statement.
+		This method can be called multiple times and expressions will be concatenated with `AND`
+		example: sqlBuilder.where("AGE > 30");
+		will produce: WHERE (AGE > 30)
+		*/
+		SQLBuilder<OPERATION::UPDATE>& where(const std::string& whereExpression);
+
+		/*
+		adds `column = ?N` expression to WHERE, binding value as parameter
+		example: sqlBuilder.whereEquals("ID", 5);
+		will produce: WHERE (ID = ?1)
+		*/
+		SQLBuilder<OPERATION::UPDATE>& whereEquals(const std::string& column, const Value& value);
+
+		/*
+		adds `column IN momo_array(?N)` expression to WHERE, binding keys as a single parameter
+		keys are not copied and must stay alive until the builder is executed
+		see SQLBuilder<SELECT>::whereIn
+		*/
+		SQLBuilder<OPERATION::UPDATE>& whereIn(const std::string& column, const std::vector<std::int64_t>& keys);
+		SQLBuilder<OPERATION::UPDATE>& whereIn(const std::string& column, const std::vector<std::string>& keys);
+		SQLBuilder<OPERATION::UPDATE>& whereIn(const std::string& column, const std::vector<std::string_view>& keys);
+		SQLBuilder<OPERATION::UPDATE>& whereIn(const std::string& column, const Value& keys);
+
+		/*
+		returns values bound to parameters of the statement
+		*/
+		const std::vector<Value>& parameters() const;
+
+		operator std::string() const;
+	};
+
+	/*
+	executes update through statement cache of the database (see SQLite3::executeCached)
+	*/
+	SQLite3& operator<<(SQLite3& database, const SQLBuilder<OPERATION::UPDATE>& sql);
+
+	/*
+	executes all updates in one write transaction through statement cache of the database, retrying it while
+	database is locked (see SQLite3::writeTransaction). Either all updates are committed or none
+	returns true on success, false on failure
+	*/
+	bool executeBatch(SQLite3& database, const std::vector<SQLBuilder<OPERATION::UPDATE>>& updates, const TransactionPolicy& policy = TransactionPolicy());
+
+	/*
+	executes all inserts in one write transaction, see executeBatch of updates
+	*/
+	bool executeBatch(SQLite3& database, const std::vector<SQLBuilder<OPERATION::INSERT>>& inserts, const TransactionPolicy& policy = TransactionPolicy());
+
+	/*
+	set of functions which pass value returned from user-defined functions to SQLite
+	unsigned values above INT64_MAX are passed as REAL
+	*/
+	void setResult(sqlite3_context* context, std::nullptr_t);
+	void setResult(sqlite3_context* context, int value);
+	void setResult(sqlite3_context* context, long value);
+	void setResult(sqlite3_context* context, long long value);
+	void setResult(sqlite3_context* context, unsigned value);
+	void setResult(sqlite3_context* context, unsigned long value);
+	void setResult(sqlite3_context* context, unsigned long long value);
+	void setResult(sqlite3_context* context, double value);
+	void setResult(sqlite3_context* context, const char* value);
+	void setResult(sqlite3_context* context, const std::string& value);
+
+	namespace detail
+	{
+		/*
+		layout of memory returned by sqlite3_aggregate_context()
+		SQLite zeroes the memory on allocation, so `constructed` is false until first step
+		*/
+		template<typename State>
+		struct AggregateSlot
+		{
+			typename std::aligned_storage<sizeof(State), alignof(State)>::type storage;
+			bool constructed;
+		};
+
+		/*
+		returns state of the current group, constructing it if needed
+		returns nullptr if no rows were stepped and create is false, or if allocation failed
+		*/
+		template<typename State>
+		State* aggregateState(sqlite3_context* context, bool create)
+		{
+			static_assert(alignof(State) <= 8, "sqlite3_aggregate_context() memory is only 8-byte aligned");
+			int size = create ? (int)sizeof(AggregateSlot<State>) : 0;
+			auto slot = static_cast<AggregateSlot<State>*>(sqlite3_aggregate_context(context, size));
+			if (slot == nullptr)
+			{
+				if (create) sqlite3_result_error_nomem(context);
+				return nullptr;
+			}
+			if (!slot->constructed)
+			{
+				new (&slot->storage) State();
+				slot->constructed = true;
+			}
+			return reinterpret_cast<State*>(&slot->storage);
+		}
+
+		template<typename State>
+		void destroyAggregateState(State* state)
+		{
+			if (state != nullptr) state->~State();
+		}
+
+		template<typename State, typename Step, typename Final>
+		struct AggregateFunctions
+		{
+			Step step;
+			Final final;
+		};
+
+		template<typename State, typename Step, typename Inverse, typename Current, typename Final>
+		struct WindowFunctions
+		{
+			Step step;
+			Inverse inverse;
+			Current value;
+			Final final;
+		};
+
+		template<typename Functions>
+		void destroyFunctions(void* functions)
+		{
+			delete static_cast<Functions*>(functions);
+		}
+
+		/*
+		calls step-like callback (step or inverse) of the function
+		*/
+		template<typename State, typename Functions, typename Callback>
+		void callStep(sqlite3_context* context, int argc, sqlite3_value** argv, Callback Functions::* callback)
+		{
+			State* state = aggregateState<State>(context, true);
+			if (state == nullptr) return;
+			auto functions = static_cast<Functions*>(sqlite3_user_data(context));
+			try
+			{
+				(functions->*callback)(*state, argc, argv);
+			}
+			catch (const std::exception& e)
+			{
+				sqlite3_result_error(context, e.what(), -1);
+			}
+		}
+
+		/*
+		calls result-like callback (value or final) of the function
+		if no rows were stepped, callback receives default-constructed state
+		*/
+		template<typename State, typename Functions, typename Callback>
+		void callResult(sqlite3_context* context, Callback Functions::* callback, bool destroy)
+		{
+			State* state = aggregateState<State>(context, !destroy);
+			auto functions = static_cast<Functions*>(sqlite3_user_data(context));
+			try
+			{
+				if (state != nullptr)
+				{
+					setResult(context, (functions->*callback)(*state));
+				}
+				else
+				{
+					State empty;
+					setResult(context, (functions->*callback)(empty));
+				}
+			}
+			catch (const std::exception& e)
+			{
+				sqlite3_result_error(context, e.what(), -1);
+			}
+			if (destroy) destroyAggregateState(state);
+		}
+	}
+
+	namespace detail
+	{
+		/*
+		column of TableView with type-erased accessors
+		compare is set only for the key column and returns <0, 0 or >0 like strcmp
+		*/
+		struct ViewColumn
+		{
+			std::string name;
+			const char* type;
+			std::function<void(const void* row, sqlite3_context* context)> result;
+			std::function<int(const void* row, sqlite3_value* value)> compare;
+		};
+
+		/*
+		type-erased description of TableView which is owned by virtual table module
+		*/
+		struct ViewDefinition
+		{
+			const char* data;
+			size_t rowSize;
+			size_t rowCount;
+			std::vector<ViewColumn> columns;
+			int keyColumn;
+		};
+
+		/*
+		set of functions which compare key column value with SQL value using SQLite ordering rules
+		unsigned keys above INT64_MAX are compared as REAL, as setResult() passes them
+		*/
+		int compareKey(int key, sqlite3_value* value);
+		int compareKey(long key, sqlite3_value* value);
+		int compareKey(long long key, sqlite3_value* value);
+		int compareKey(unsigned key, sqlite3_value* value);
+		int compareKey(unsigned long key, sqlite3_value* value);
+		int compareKey(unsigned long long key, sqlite3_value* value);
+		int compareKey(double key, sqlite3_value* value);
+		int compareKey(const char* key, sqlite3_value* value);
+		int compareKey(const std::string& key, sqlite3_value* value);
+
+		template<typename M>
+		const char* declaredType()
+		{
+			if (std::is_integral<M>::value) return "INTEGER";
+			if (std::is_floating_point<M>::value) return "REAL";
+			return "TEXT";
+		}
+	}
+
+	/*
+	description of C++ array of structs which can be exposed as a read-only SQL table
+	rows are read in place, so no data is copied into SQLite
+	example:
+	TableView<Employee> view(employees);
+	view.addKeyColumn("ID", &Employee::id).addColumn("NAME", &Employee::name);
+	*/
+	template<typename T>
+	class TableView
+	{
+		detail::ViewDefinition _definition;
+	public:
+		/*
+		view rows of the vector provided. Vector must not be reallocated while viewed
+		*/
+		TableView(const std::vector<T>& rows)
+			: TableView(rows.data(), rows.size())
+		{
+
+		}
+
+		/*
+		view `count` rows starting from `rows` pointer
+		*/
+		TableView(const T* rows, size_t count)
+			: _definition{ reinterpret_cast<const char*>(rows), sizeof(T), count, {}, -1 }
+		{
+
+		}
+
+		/*
+		adds column which reads member of struct
+		supported member types: integers, floating point, std::string and const char*
+		*/
+		template<typename M>
+		TableView<T>& addColumn(const std::string& name, M T::* member)
+		{
+			detail::ViewColumn column;
+			column.name = name;
+			column.type = detail::declaredType<M>();
+			column.result = [member](const void* row, sqlite3_context* context)
+			{
+				setResult(context, static_cast<const T*>(row)->*member);
+			};
+			_definition.columns.push_back(std::move(column));
+			return *this;
+		}
+
+		/*
+		adds column which rows are sorted by (ascending, in SQLite order)
+		constraints (=, <, <=, >, >=, IN) on this column are resolved with binary search instead of full scan
+		only one key column can be set, next call replaces previous key
+		*/
+		template<typename M>
+		TableView<T>& addKeyColumn(const std::string& name, M T::* member)
+		{
+			addColumn(name, member);
+			_definition.columns.back().compare = [member](const void* row, sqlite3_value* value)
+			{
+				return detail::compareKey(static_cast<const T*>(row)->*member, value);
+			};
+			_definition.keyColumn = (int)_definition.columns.size() - 1;
+			return *this;
+		}
+
+		/*
+		returns type-erased definition of the view
+		*/
+		const detail::ViewDefinition& definition() const
+		{
+			return _definition;
+		}
+	};
+
+	template<typename T>
+	bool SQLite3::createTableView(const std::string& name, const TableView<T>& view)
+	{
+		return createTableView(name, view.definition());
+	}
+
+	template<typename Function>
+	bool SQLite3::writeTransaction(Function function, const TransactionPolicy& policy)
+	{
+		return runWriteTransaction([&function](Transaction& transaction)
+		{
+			if constexpr (std::is_void_v<std::invoke_result_t<Function&, Transaction&>>)
+			{
+				function(transaction);
+				return true;
+			}
+			else
+			{
+				return (bool)function(transaction);
+			}
+		}, policy);
+	}
+
+	template<typename State, typename Step, typename Final>
+	bool SQLite3::createAggregate(const std::string& name, Step step, Final final, int argumentCount)
+	{
+		typedef detail::AggregateFunctions<State, Step, Final> Functions;
+		auto functions = new Functions{ std::move(step), std::move(final) };
+		int code = sqlite3_create_function_v2(_database, name.c_str(), argumentCount, SQLITE_UTF8, functions, nullptr,
+			[](sqlite3_context* context, int argc, sqlite3_value** argv)
+			{
+				detail::callStep<State>(context, argc, argv, &Functions::step);
+			},
+			[](sqlite3_context* context)
+			{
+				detail::callResult<State>(context, &Functions::final, true);
+			},
+			&detail::destroyFunctions<Functions>);
+		return checkResult(code);
+	}
+
+	template<typename State, typename Step, typename Inverse, typename Current, typename Final>
+	bool SQLite3::createWindowFunction(const std::string& name, Step step, Inverse inverse, Current value, Final final, int argumentCount)
+	{
+		typedef detail::WindowFunctions<State, Step, Inverse, Current, Final> Functions;
+		auto functions = new Functions{ std::move(step), std::move(inverse), std::move(value), std::move(final) };
+		int code = sqlite3_create_window_function(_database, name.c_str(), argumentCount, SQLITE_UTF8, functions,
+			[](sqlite3_context* context, int argc, sqlite3_value** argv)
+			{
+				detail::callStep<State>(context, argc, argv, &Functions::step);
+			},
+			[](sqlite3_context* context)
+			{
+				detail::callResult<State>(context, &Functions::final, true);
+			},
+			[](sqlite3_context* context)
+			{
+				detail::callResult<State>(context, &Functions::value, false);
+			},
+			[](sqlite3_context* context, int argc, sqlite3_value** argv)
+			{
+				detail::callStep<State>(context, argc, argv, &Functions::inverse);
+			},
+			&detail::destroyFunctions<Functions>);
+		return checkResult(code);
+	}
+
+	/*
+	template specialization for 1 argument
+	for more info, see pack(args...) declaration
+	*/
+	template<typename Last>
+	std::string pack(Last arg)
+	{
+		std::stringstream out;
+		auto& type = typeid(arg);
+		if (type == typeid(const char*) || type == typeid(char*) || type == typeid(std::string))
+		{
+			out << "'" << arg << "'";
+		}
+		else
+		{
+			out << arg;
+		}
+		return out.str();
+	}
+
+	/*
+	creates a single line of values from parameters and can be passed into SQLBuilder methods
+
+	example:
+	pack(122, "ALEX", 23) will return "122, 'ALEX', 23"
+	*/
+	template<typename First, typename... Other>
+	std::string pack(First arg, Other... args)
+	{
+		std::stringstream out;
+		auto& type = typeid(arg);
+		if (type == typeid(const char*) || type == typeid(char*) || type == typeid(std::string))
+		{
+			out << "'" << arg << "', ";
+		}
+		else
+		{
+			out << arg << ", ";
+		}
+		out << pack(args...);
+		return out.str();
+	}
 }
\ No newline at end of file
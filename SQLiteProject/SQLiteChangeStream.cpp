@@ -0,0 +1,286 @@
+#include "SQLiteChangeStream.h"
+#include <cctype>
+
+namespace
+{
+	/*
+	reads next keyword or name of SQL, unquoting it. Returns empty string at the end of SQL
+	*/
+	std::string nextWord(const char*& SQL)
+	{
+		while (std::isspace((unsigned char)*SQL)) SQL++;
+		std::string word;
+		char quote = *SQL == '"' || *SQL == '`' || *SQL == '\'' ? *SQL : *SQL == '[' ? ']' : '\0';
+		if (quote != '\0')
+		{
+			SQL++;
+			while (*SQL != '\0' && *SQL != quote) word += *SQL++;
+			if (*SQL == quote) SQL++;
+			return word;
+		}
+		while (*SQL != '\0' && !std::isspace((unsigned char)*SQL) && *SQL != ';') word += *SQL++;
+		return word;
+	}
+}
+
+namespace momo
+{
+	ChangeStream::ChangeStream(SQLite3& database, const ChangeStreamConfig& config)
+		: _database(database), _config(config), _mask(0), _published(0), _transactions(0),
+		_running(false), _preupdate(false), _discarded(0), _waiters(0)
+	{
+		size_t capacity = 1;
+		while (capacity < _config.capacity) capacity <<= 1;
+		_slots.resize(capacity);
+		_mask = capacity - 1;
+	}
+
+	void ChangeStream::add(Change change)
+	{
+		_pending.push_back(std::move(change));
+	}
+
+	void ChangeStream::publish()
+	{
+		if (_pending.empty()) return;
+
+		std::uint64_t sequence = _published.load(std::memory_order_relaxed);
+		for (Change& change : _pending)
+		{
+			change.sequence = sequence;
+			change.transaction = _transactions.load(std::memory_order_relaxed);
+			std::atomic_store_explicit(&_slots[sequence & _mask].change,
+				std::shared_ptr<const Change>(std::make_shared<Change>(std::move(change))), std::memory_order_release);
+			sequence++;
+		}
+		_pending.clear();
+		_savepoints.clear();
+		for (size_t& mark : _steps) mark = 0;
+		_transactions.fetch_add(1, std::memory_order_relaxed);
+		_published.store(sequence, std::memory_order_seq_cst);
+
+		if (_waiters.load(std::memory_order_seq_cst) > 0)
+		{
+			std::lock_guard<std::mutex> lock(_waitMutex);
+			_wakeup.notify_all();
+		}
+	}
+
+	void ChangeStream::discard()
+	{
+		_discarded.fetch_add(_pending.size(), std::memory_order_relaxed);
+		_pending.clear();
+	}
+
+	void ChangeStream::truncate(size_t mark)
+	{
+		if (mark >= _pending.size()) return;
+		_discarded.fetch_add(_pending.size() - mark, std::memory_order_relaxed);
+		_pending.resize(mark);
+	}
+
+	void ChangeStream::savepoint(sqlite3_stmt* statement)
+	{
+		const char* SQL = sqlite3_sql(statement);
+		if (SQL == nullptr) return;
+		std::string command = nextWord(SQL);
+		if (sqlite3_stricmp(command.c_str(), "SAVEPOINT") == 0)
+		{
+			_savepoints.emplace_back(nextWord(SQL), _pending.size());
+			return;
+		}
+
+		// RELEASE [SAVEPOINT] name, ROLLBACK [TRANSACTION] TO [SAVEPOINT] name
+		bool release = sqlite3_stricmp(command.c_str(), "RELEASE") == 0;
+		if (!release && sqlite3_stricmp(command.c_str(), "ROLLBACK") != 0) return;
+		std::string word = nextWord(SQL);
+		if (!release)
+		{
+			if (sqlite3_stricmp(word.c_str(), "TRANSACTION") == 0) word = nextWord(SQL);
+			if (sqlite3_stricmp(word.c_str(), "TO") != 0) return;
+			word = nextWord(SQL);
+		}
+		if (sqlite3_stricmp(word.c_str(), "SAVEPOINT") == 0) word = nextWord(SQL);
+
+		for (size_t i = _savepoints.size(); i-- > 0;)
+		{
+			if (sqlite3_stricmp(_savepoints[i].first.c_str(), word.c_str()) != 0) continue;
+			if (!release) truncate(_savepoints[i].second);
+			// rolled back savepoint stays open, released one is removed together with newer ones
+			_savepoints.resize(release ? i : i + 1);
+			return;
+		}
+	}
+
+	void ChangeStream::step(sqlite3_stmt* statement, bool finished, int result)
+	{
+		if (!finished)
+		{
+			_steps.push_back(_pending.size());
+			return;
+		}
+		if (_steps.empty()) return;
+		size_t mark = _steps.back();
+		_steps.pop_back();
+		if (result != SQLITE_ROW && result != SQLITE_DONE)
+		{
+			// failed statement is undone by SQLite, or the whole transaction is rolled back
+			truncate(mark);
+		}
+		else if (result == SQLITE_DONE)
+		{
+			savepoint(statement);
+		}
+	}
+
+#if defined(SQLITE_ENABLE_PREUPDATE_HOOK)
+	void ChangeStream::preupdate(void* stream, sqlite3* database, int operation, const char* schema, const char* table, sqlite3_int64 oldRowid, sqlite3_int64 rowid)
+	{
+		Change change;
+		change.operation = operation;
+		change.database = schema;
+		change.table = table;
+		change.rowid = operation == SQLITE_DELETE ? oldRowid : rowid;
+		change.oldRowid = oldRowid;
+
+		int columns = sqlite3_preupdate_count(database);
+		if (operation != SQLITE_INSERT) change.oldValues.reserve(columns);
+		if (operation != SQLITE_DELETE) change.newValues.reserve(columns);
+		for (int i = 0; i < columns; i++)
+		{
+			sqlite3_value* value = nullptr;
+			if (operation != SQLITE_INSERT && sqlite3_preupdate_old(database, i, &value) == SQLITE_OK)
+				change.oldValues.push_back(Value::from(value));
+			if (operation != SQLITE_DELETE && sqlite3_preupdate_new(database, i, &value) == SQLITE_OK)
+				change.newValues.push_back(Value::from(value));
+		}
+		static_cast<ChangeStream*>(stream)->add(std::move(change));
+	}
+#endif
+
+	bool ChangeStream::start()
+	{
+		if (_running) return true;
+		if (_database.handle() == nullptr) return false;
+
+#if defined(SQLITE_ENABLE_PREUPDATE_HOOK)
+		_preupdate = _config.captureValues;
+		if (_preupdate) sqlite3_preupdate_hook(_database.handle(), &ChangeStream::preupdate, this);
+#endif
+		if (!_preupdate)
+		{
+			_hooks.push_back(_database.addUpdateHook([this](int operation, const char* database, const char* table, sqlite3_int64 rowid)
+			{
+				add(Change{ operation, database, table, rowid, rowid, {}, {}, 0, 0 });
+			}));
+		}
+		_hooks.push_back(_database.addCommitHook([this]() { publish(); }));
+		_hooks.push_back(_database.addRollbackHook([this]()
+		{
+			discard();
+			_savepoints.clear();
+			for (size_t& mark : _steps) mark = 0;
+		}));
+		_hooks.push_back(_database.addStepHook([this](sqlite3_stmt* statement, bool finished, int result) { step(statement, finished, result); }));
+		_running = true;
+		return true;
+	}
+
+	void ChangeStream::stop()
+	{
+		if (!_running) return;
+
+#if defined(SQLITE_ENABLE_PREUPDATE_HOOK)
+		if (_preupdate && _database.handle() != nullptr) sqlite3_preupdate_hook(_database.handle(), nullptr, nullptr);
+#endif
+		for (int id : _hooks) _database.removeHook(id);
+		_hooks.clear();
+		_preupdate = false;
+		discard();
+		_savepoints.clear();
+		_steps.clear();
+		_running = false;
+	}
+
+	ChangeStream::Cursor ChangeStream::subscribe(bool fromOldest)
+	{
+		std::uint64_t published = _published.load(std::memory_order_acquire);
+		std::uint64_t position = published;
+		if (fromOldest) position = published > _slots.size() ? published - _slots.size() : 0;
+		return Cursor(*this, position);
+	}
+
+	ChangeStreamStatistics ChangeStream::getStatistics() const
+	{
+		ChangeStreamStatistics statistics;
+		statistics.published = _published.load(std::memory_order_acquire);
+		statistics.transactions = _transactions.load(std::memory_order_relaxed);
+		statistics.discarded = _discarded.load(std::memory_order_relaxed);
+		return statistics;
+	}
+
+	ChangeStream::~ChangeStream()
+	{
+		stop();
+	}
+
+	ChangeStream::Cursor::Cursor(ChangeStream& stream, std::uint64_t position)
+		: _stream(&stream), _position(position), _lost(0)
+	{
+	}
+
+	bool ChangeStream::Cursor::next(Change& change)
+	{
+		const std::vector<Slot>& slots = _stream->_slots;
+		while (true)
+		{
+			std::uint64_t published = _stream->_published.load(std::memory_order_acquire);
+			if (_position >= published) return false;
+
+			/*
+			cursor was lapped by the writer, skip to the oldest change which is still kept
+			*/
+			if (published - _position > slots.size())
+			{
+				_lost += published - slots.size() - _position;
+				_position = published - slots.size();
+			}
+
+			std::shared_ptr<const Change> slot = std::atomic_load_explicit(&slots[_position & _stream->_mask].change, std::memory_order_acquire);
+			if (slot == nullptr || slot->sequence != _position) continue; // overwritten after published was read
+			change = *slot;
+			_position++;
+			return true;
+		}
+	}
+
+	bool ChangeStream::Cursor::wait(Change& change, std::chrono::milliseconds timeout)
+	{
+		if (next(change)) return true;
+
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		std::unique_lock<std::mutex> lock(_stream->_waitMutex);
+		_stream->_waiters.fetch_add(1, std::memory_order_seq_cst);
+		bool found = false;
+		while (!(found = next(change)))
+		{
+			if (_stream->_wakeup.wait_until(lock, deadline) == std::cv_status::timeout)
+			{
+				found = next(change);
+				break;
+			}
+		}
+		_stream->_waiters.fetch_sub(1, std::memory_order_relaxed);
+		return found;
+	}
+
+	std::uint64_t ChangeStream::Cursor::position() const
+	{
+		return _position;
+	}
+
+	std::uint64_t ChangeStream::Cursor::lost() const
+	{
+		return _lost;
+	}
+}
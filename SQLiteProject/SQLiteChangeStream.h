@@ -0,0 +1,208 @@
+#pragma once
+
+#include "SQLite.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace momo
+{
+	/*
+	single row change captured by ChangeStream
+	*/
+	struct Change
+	{
+		/*
+		SQLITE_INSERT, SQLITE_UPDATE or SQLITE_DELETE
+		*/
+		int operation;
+
+		std::string database;
+		std::string table;
+
+		/*
+		rowid of the row after the change (before the change for DELETE)
+		oldRowid differs from rowid only if UPDATE changed rowid
+		*/
+		sqlite3_int64 rowid;
+		sqlite3_int64 oldRowid;
+
+		/*
+		column values before and after the change
+		available only if wrapper is compiled with SQLITE_ENABLE_PREUPDATE_HOOK (as SQLite itself must be),
+		oldValues are empty for INSERT, newValues are empty for DELETE
+		*/
+		std::vector<Value> oldValues;
+		std::vector<Value> newValues;
+
+		/*
+		position of change in the stream and number of transaction which committed it, both start from 0
+		*/
+		std::uint64_t sequence;
+		std::uint64_t transaction;
+	};
+
+	/*
+	configuration of ChangeStream
+	*/
+	struct ChangeStreamConfig
+	{
+		/*
+		number of committed changes kept for subscribers, rounded up to power of two
+		subscriber which falls behind by more changes loses the oldest ones (see Cursor::lost())
+		*/
+		size_t capacity = 64 * 1024;
+
+		/*
+		capture old / new column values when preupdate hook is available
+		*/
+		bool captureValues = true;
+	};
+
+	/*
+	counters of ChangeStream collected since it was created
+	*/
+	struct ChangeStreamStatistics
+	{
+		std::uint64_t published;
+		std::uint64_t transactions;
+
+		/*
+		changes dropped because their transaction was rolled back
+		*/
+		std::uint64_t discarded;
+	};
+
+	/*
+	change data capture of a connection. Row changes reported by sqlite3_update_hook
+	(or sqlite3_preupdate_hook with column values when SQLITE_ENABLE_PREUPDATE_HOOK is defined) are buffered
+	until the transaction ends: they are published to a ring buffer on commit and discarded on rollback.
+	Changes of a statement which fails are discarded when the statement is undone, as are changes undone by ROLLBACK TO,
+	so statements must be executed through the wrapper (see SQLite3::addStepHook). A statement failing with ON CONFLICT FAIL
+	keeps its earlier row changes in the database, but the stream discards them.
+	Any number of threads can read published changes through their own cursors. Publishing never waits for readers,
+	slots are exchanged with std::atomic_load / atomic_store of shared_ptr, which standard library implements
+	with a small pool of locks, so the ring is not lock-free.
+	Changes are published from commit hook, before the commit is finished: a COMMIT which then fails and is rolled back
+	has its changes published anyway. Changes of other connections are not seen.
+	Preupdate hook is not shared, so stream with values can not be used together with session extension on one connection
+
+	example:
+	ChangeStream changes(database);
+	changes.start();
+	auto cursor = changes.subscribe();
+	Change change;
+	while (cursor.wait(change, std::chrono::seconds(1))) { ... }
+	*/
+	class ChangeStream
+	{
+		struct Slot
+		{
+			std::shared_ptr<const Change> change;
+		};
+
+		SQLite3& _database;
+		ChangeStreamConfig _config;
+		std::vector<Slot> _slots;
+		size_t _mask;
+		std::atomic<std::uint64_t> _published;
+		std::atomic<std::uint64_t> _transactions;
+		std::vector<Change> _pending;
+
+		/*
+		sizes of _pending when running steps started, innermost last
+		*/
+		std::vector<size_t> _steps;
+
+		/*
+		savepoints of current transaction with sizes of _pending when they were created
+		*/
+		std::vector<std::pair<std::string, size_t>> _savepoints;
+		std::vector<int> _hooks;
+		bool _running;
+		bool _preupdate;
+		std::atomic<std::uint64_t> _discarded;
+		std::atomic<int> _waiters;
+		std::mutex _waitMutex;
+		std::condition_variable _wakeup;
+
+		void add(Change change);
+		void publish();
+		void discard();
+
+		/*
+		discards pending changes added after mark
+		*/
+		void truncate(size_t mark);
+
+		/*
+		updates savepoints after SAVEPOINT, RELEASE or ROLLBACK TO statement succeeded
+		*/
+		void savepoint(sqlite3_stmt* statement);
+		void step(sqlite3_stmt* statement, bool finished, int result);
+#if defined(SQLITE_ENABLE_PREUPDATE_HOOK)
+		static void preupdate(void* stream, sqlite3* database, int operation, const char* schema, const char* table, sqlite3_int64 oldRowid, sqlite3_int64 rowid);
+#endif
+	public:
+		/*
+		reading position of one subscriber. Cursor must not outlive its stream and must be used by one thread at a time
+		*/
+		class Cursor
+		{
+			ChangeStream* _stream;
+			std::uint64_t _position;
+			std::uint64_t _lost;
+		public:
+			Cursor(ChangeStream& stream, std::uint64_t position);
+
+			/*
+			reads next change if there is one, returns true if change was read, false either
+			*/
+			bool next(Change& change);
+
+			/*
+			waits up to timeout for next change, returns true if change was read, false either
+			*/
+			bool wait(Change& change, std::chrono::milliseconds timeout);
+
+			/*
+			returns sequence number of the next change to be read
+			*/
+			std::uint64_t position() const;
+
+			/*
+			returns number of changes overwritten before this cursor read them
+			*/
+			std::uint64_t lost() const;
+		};
+
+		ChangeStream(SQLite3& database, const ChangeStreamConfig& config = ChangeStreamConfig());
+
+		ChangeStream(const ChangeStream&) = delete;
+		ChangeStream& operator=(const ChangeStream&) = delete;
+
+		/*
+		installs hooks on the connection
+		returns true on success, false either
+		*/
+		bool start();
+
+		/*
+		removes hooks of the connection, changes of current transaction are discarded
+		automatically called in the destructor
+		*/
+		void stop();
+
+		/*
+		returns cursor positioned after the last published change, or at the oldest change still kept
+		*/
+		Cursor subscribe(bool fromOldest = false);
+
+		ChangeStreamStatistics getStatistics() const;
+
+		~ChangeStream();
+	};
+}
@@ -0,0 +1,159 @@
+#include "SQLiteCheckpoint.h"
+
+momo::CheckpointManager::CheckpointManager(SQLite3& database, const CheckpointConfig& config)
+	: _database(database), _config(config), _running(false), _requested(false), _walPages(0), _statistics(), _walHook(0), _autoCheckpoint(1000)
+{
+
+}
+
+void momo::CheckpointManager::onWal(int pages)
+{
+	_walPages = pages;
+	if (pages >= _config.passivePages)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_requested = true;
+		_wakeup.notify_one();
+	}
+}
+
+bool momo::CheckpointManager::start()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (_running) return true;
+
+	const char* filename = sqlite3_db_filename(_database.handle(), "main");
+	if (filename == nullptr || *filename == '\0')
+	{
+		_errorMessage = "checkpoints require file database";
+		return false;
+	}
+	// same VFS and flags as the main connection, so both see the same locks and files
+	if (!_connection.open(filename, _database.getOpenOptions()))
+	{
+		_errorMessage = _connection.getErrorMessage();
+		return false;
+	}
+	sqlite3_busy_timeout(_connection.handle(), (int)_config.busyTimeout.count());
+	// connection opens WAL only after first read, before that checkpoints do nothing
+	if (!_connection.execute("PRAGMA schema_version;"))
+	{
+		_errorMessage = _connection.getErrorMessage();
+		_connection.close();
+		return false;
+	}
+
+	_running = true;
+	_requested = false;
+	_lastRestart = std::chrono::steady_clock::now();
+	_thread = std::thread(&CheckpointManager::run, this);
+	lock.unlock();
+
+	// WAL hook locks _mutex while database mutex is held, so database is configured without holding _mutex
+	// checkpoints of the database are run by manager instead of committing connection
+	_autoCheckpoint = _database.getAutoCheckpoint();
+	_database.setAutoCheckpoint(0);
+	_walHook = _database.addWalHook([this](const char*, int pages) { onWal(pages); });
+	return true;
+}
+
+void momo::CheckpointManager::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_running) return;
+		_running = false;
+		_wakeup.notify_one();
+	}
+	_thread.join();
+	_database.removeHook(_walHook);
+	_database.setAutoCheckpoint(_autoCheckpoint);
+	_connection.close();
+}
+
+void momo::CheckpointManager::requestCheckpoint()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_requested = true;
+	_wakeup.notify_one();
+}
+
+void momo::CheckpointManager::run()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (_running)
+	{
+		_wakeup.wait_for(lock, _config.pollInterval, [this] { return _requested || !_running; });
+		if (!_running) break;
+
+		int pages = _walPages;
+		bool aged = std::chrono::steady_clock::now() - _lastRestart >= _config.maxAge && pages > 0;
+		if (!_requested && !aged) continue;
+		_requested = false;
+
+		int mode = SQLITE_CHECKPOINT_PASSIVE;
+		if (pages >= _config.truncatePages) mode = SQLITE_CHECKPOINT_TRUNCATE;
+		else if (pages >= _config.restartPages || aged) mode = SQLITE_CHECKPOINT_RESTART;
+
+		lock.unlock();
+		checkpoint(mode);
+		lock.lock();
+	}
+}
+
+void momo::CheckpointManager::checkpoint(int mode)
+{
+	int logPages = 0;
+	int checkpointedPages = 0;
+	auto begin = std::chrono::steady_clock::now();
+	int code = sqlite3_wal_checkpoint_v2(_connection.handle(), nullptr, mode, &logPages, &checkpointedPages);
+	auto end = std::chrono::steady_clock::now();
+	auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_statistics.lastDuration = duration;
+	_statistics.totalDuration += duration;
+	if (duration > _statistics.maxDuration) _statistics.maxDuration = duration;
+	if (code != SQLITE_OK)
+	{
+		_statistics.failed++;
+		_errorMessage = sqlite3_errmsg(_connection.handle());
+		return;
+	}
+
+	switch (mode)
+	{
+	case SQLITE_CHECKPOINT_PASSIVE:
+		_statistics.passive++;
+		break;
+	case SQLITE_CHECKPOINT_RESTART:
+		_statistics.restart++;
+		_lastRestart = end;
+		break;
+	case SQLITE_CHECKPOINT_TRUNCATE:
+		_statistics.truncate++;
+		_lastRestart = end;
+		break;
+	}
+	// after RESTART / TRUNCATE next writer starts WAL from the beginning
+	if (mode != SQLITE_CHECKPOINT_PASSIVE) _walPages = 0;
+}
+
+momo::CheckpointStatistics momo::CheckpointManager::getStatistics() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	CheckpointStatistics statistics = _statistics;
+	statistics.walPages = _walPages;
+	return statistics;
+}
+
+std::string momo::CheckpointManager::getErrorMessage() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _errorMessage;
+}
+
+momo::CheckpointManager::~CheckpointManager()
+{
+	stop();
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "SQLite.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace momo
+{
+	/*
+	thresholds of background WAL checkpoints
+	*/
+	struct CheckpointConfig
+	{
+		/*
+		WAL size (in pages) after which PASSIVE checkpoint is started. PASSIVE never blocks readers or writers
+		*/
+		int passivePages = 1000;
+
+		/*
+		WAL size (in pages) after which RESTART checkpoint is used, so writers start WAL from the beginning
+		*/
+		int restartPages = 10000;
+
+		/*
+		WAL size (in pages) after which TRUNCATE checkpoint is used, truncating WAL file to zero bytes
+		*/
+		int truncatePages = 50000;
+
+		/*
+		if WAL was not restarted for this time, next checkpoint uses RESTART mode
+		*/
+		std::chrono::milliseconds maxAge = std::chrono::seconds(60);
+
+		/*
+		time background thread waits for commits before checking WAL age
+		*/
+		std::chrono::milliseconds pollInterval = std::chrono::seconds(1);
+
+		/*
+		time RESTART and TRUNCATE checkpoints wait for readers and writers before giving up
+		*/
+		std::chrono::milliseconds busyTimeout = std::chrono::milliseconds(100);
+	};
+
+	/*
+	counters of checkpoints run by CheckpointManager
+	*/
+	struct CheckpointStatistics
+	{
+		std::uint64_t passive;
+		std::uint64_t restart;
+		std::uint64_t truncate;
+
+		/*
+		checkpoints which returned an error or could not finish because of readers / writers (SQLITE_BUSY)
+		*/
+		std::uint64_t failed;
+
+		std::chrono::microseconds lastDuration;
+		std::chrono::microseconds maxDuration;
+		std::chrono::microseconds totalDuration;
+
+		/*
+		WAL size (in pages) reported by the last commit
+		*/
+		int walPages;
+	};
+
+	/*
+	moves WAL checkpoints out of writer commits.
+	Manager disables automatic checkpoints of the database, tracks WAL size with WAL hook (SQLite3::addWalHook) and runs
+	checkpoints on its own connection in a background thread: PASSIVE when WAL grows over passivePages,
+	RESTART / TRUNCATE when WAL grows over larger thresholds or was not restarted for maxAge.
+	RESTART / TRUNCATE hold writer lock while waiting for readers, so database should have busy timeout set.
+
+	example:
+	CheckpointManager checkpoints(database);
+	checkpoints.start();
+	*/
+	class CheckpointManager
+	{
+		SQLite3& _database;
+		CheckpointConfig _config;
+		SQLite3 _connection;
+		std::thread _thread;
+		mutable std::mutex _mutex;
+		std::condition_variable _wakeup;
+		bool _running;
+		bool _requested;
+		std::atomic<int> _walPages;
+		std::chrono::steady_clock::time_point _lastRestart;
+		CheckpointStatistics _statistics;
+		std::string _errorMessage;
+		int _walHook;
+
+		/*
+		automatic checkpoint threshold of the database before start(), restored by stop()
+		*/
+		int _autoCheckpoint;
+
+		void onWal(int pages);
+		void run();
+		void checkpoint(int mode);
+	public:
+		/*
+		creates manager for database provided. Database must stay opened while manager is running
+		*/
+		CheckpointManager(SQLite3& database, const CheckpointConfig& config = CheckpointConfig());
+
+		CheckpointManager(const CheckpointManager&) = delete;
+		CheckpointManager& operator=(const CheckpointManager&) = delete;
+
+		/*
+		opens background connection with open options of the database (see SQLite3::getOpenOptions), installs WAL hook
+		and starts background thread
+		returns true on success, false on failure (see getErrorMessage())
+		*/
+		bool start();
+
+		/*
+		stops background thread and restores automatic checkpoints of the database
+		automatically called in the destructor
+		*/
+		void stop();
+
+		/*
+		requests checkpoint without waiting for WAL to grow
+		*/
+		void requestCheckpoint();
+
+		CheckpointStatistics getStatistics() const;
+
+		/*
+		returns last error message of background connection
+		*/
+		std::string getErrorMessage() const;
+
+		~CheckpointManager();
+	};
+}
@@ -0,0 +1,353 @@
+#include "SQLiteMemory.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	/*
+	every block starts with 8-byte header: size class index for pooled blocks,
+	or LARGE_BLOCK flag combined with block size for blocks allocated by system malloc
+	*/
+	typedef std::uint64_t Header;
+	const Header LARGE_BLOCK = 1ull << 63;
+	const size_t HEADER_SIZE = sizeof(Header);
+	const size_t GRANULARITY = 16;
+
+	momo::MemoryConfig memoryConfig;
+
+	std::atomic<std::uint64_t> bytesReserved(0);
+	std::atomic<std::uint64_t> threadCacheHits(0);
+	std::atomic<std::uint64_t> poolRefills(0);
+	std::atomic<std::uint64_t> poolReturns(0);
+	std::atomic<std::uint64_t> largeAllocations(0);
+
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	/*
+	size classes grow by quarter of power of two: 16, 32, 48, 64, 80, 96, 112, 128, 160, 192, ...
+	*/
+	std::vector<size_t> classSizes;
+
+	/*
+	maps (size + header) / GRANULARITY to size class index
+	*/
+	std::vector<std::uint16_t> classIndex;
+
+	void buildClasses()
+	{
+		classSizes.clear();
+		size_t limit = memoryConfig.maxPooledSize + HEADER_SIZE;
+		for (size_t size = GRANULARITY; ; )
+		{
+			classSizes.push_back(size);
+			if (size >= limit) break;
+			size_t power = GRANULARITY;
+			while (power * 2 <= size) power *= 2;
+			size_t step = power / 4 < GRANULARITY ? GRANULARITY : power / 4;
+			size += step;
+		}
+
+		classIndex.assign(classSizes.back() / GRANULARITY + 1, 0);
+		size_t current = 0;
+		for (size_t i = 0; i < classIndex.size(); i++)
+		{
+			while (classSizes[current] < i * GRANULARITY) current++;
+			classIndex[i] = (std::uint16_t)current;
+		}
+	}
+
+	/*
+	returns size class of allocation with header, or -1 if it is too large for pools
+	*/
+	int findClass(size_t size)
+	{
+		size_t total = size + HEADER_SIZE;
+		if (size > memoryConfig.maxPooledSize) return -1;
+		return classIndex[(total + GRANULARITY - 1) / GRANULARITY];
+	}
+
+	/*
+	pool of free blocks shared by all threads, one locked list per size class
+	*/
+	class SharedPool
+	{
+		struct Bin
+		{
+			std::mutex mutex;
+			FreeBlock* head = nullptr;
+		};
+		std::vector<Bin> _bins;
+	public:
+		explicit SharedPool(size_t classes)
+			: _bins(classes)
+		{
+
+		}
+
+		/*
+		moves up to count blocks of size class into list, allocating new chunk if pool is empty
+		returns number of blocks moved
+		*/
+		size_t take(int sizeClass, size_t count, FreeBlock*& list)
+		{
+			Bin& bin = _bins[sizeClass];
+			std::lock_guard<std::mutex> lock(bin.mutex);
+			if (bin.head == nullptr && !refill(sizeClass, bin)) return 0;
+
+			size_t taken = 0;
+			while (taken < count && bin.head != nullptr)
+			{
+				FreeBlock* block = bin.head;
+				bin.head = block->next;
+				block->next = list;
+				list = block;
+				taken++;
+			}
+			poolRefills.fetch_add(1, std::memory_order_relaxed);
+			return taken;
+		}
+
+		void give(int sizeClass, FreeBlock* first, FreeBlock* last)
+		{
+			Bin& bin = _bins[sizeClass];
+			std::lock_guard<std::mutex> lock(bin.mutex);
+			last->next = bin.head;
+			bin.head = first;
+			poolReturns.fetch_add(1, std::memory_order_relaxed);
+		}
+	private:
+		bool refill(int sizeClass, Bin& bin)
+		{
+			size_t blockSize = classSizes[sizeClass];
+			size_t chunkSize = memoryConfig.chunkSize;
+			if (chunkSize < blockSize * 4) chunkSize = blockSize * 4;
+			char* chunk = static_cast<char*>(malloc(chunkSize));
+			if (chunk == nullptr) return false;
+			bytesReserved.fetch_add(chunkSize, std::memory_order_relaxed);
+			for (size_t offset = 0; offset + blockSize <= chunkSize; offset += blockSize)
+			{
+				auto block = reinterpret_cast<FreeBlock*>(chunk + offset);
+				block->next = bin.head;
+				bin.head = block;
+			}
+			return true;
+		}
+	};
+
+	SharedPool* sharedPool = nullptr;
+
+	/*
+	free lists owned by a single thread. Returned to shared pool when thread exits
+	*/
+	struct ThreadCache
+	{
+		std::vector<FreeBlock*> lists;
+		std::vector<size_t> counts;
+		std::uint64_t hits = 0;
+
+		FreeBlock* pop(int sizeClass)
+		{
+			if (lists.empty())
+			{
+				lists.assign(classSizes.size(), nullptr);
+				counts.assign(classSizes.size(), 0);
+			}
+			if (lists[sizeClass] == nullptr)
+			{
+				size_t batch = memoryConfig.threadCacheBlocks / 2 + 1;
+				counts[sizeClass] += sharedPool->take(sizeClass, batch, lists[sizeClass]);
+				if (lists[sizeClass] == nullptr) return nullptr;
+			}
+			else if (++hits == 1024)
+			{
+				threadCacheHits.fetch_add(hits, std::memory_order_relaxed);
+				hits = 0;
+			}
+			FreeBlock* block = lists[sizeClass];
+			lists[sizeClass] = block->next;
+			counts[sizeClass]--;
+			return block;
+		}
+
+		void push(int sizeClass, FreeBlock* block)
+		{
+			if (lists.empty())
+			{
+				lists.assign(classSizes.size(), nullptr);
+				counts.assign(classSizes.size(), 0);
+			}
+			block->next = lists[sizeClass];
+			lists[sizeClass] = block;
+			if (++counts[sizeClass] > memoryConfig.threadCacheBlocks)
+				release(sizeClass, counts[sizeClass] / 2);
+		}
+
+		/*
+		moves up to count blocks of size class to shared pool
+		*/
+		void release(int sizeClass, size_t count)
+		{
+			if (count == 0 || lists[sizeClass] == nullptr) return;
+			FreeBlock* first = lists[sizeClass];
+			FreeBlock* last = first;
+			size_t moved = 1;
+			while (moved < count && last->next != nullptr)
+			{
+				last = last->next;
+				moved++;
+			}
+			lists[sizeClass] = last->next;
+			counts[sizeClass] -= moved;
+			sharedPool->give(sizeClass, first, last);
+		}
+
+		~ThreadCache();
+	};
+
+	/*
+	set when thread cache of exiting thread is destroyed, so later calls go to shared pool directly
+	*/
+	thread_local bool threadCacheDestroyed = false;
+
+	ThreadCache::~ThreadCache()
+	{
+		threadCacheHits.fetch_add(hits, std::memory_order_relaxed);
+		for (size_t i = 0; i < lists.size(); i++) release((int)i, counts[i]);
+		threadCacheDestroyed = true;
+	}
+
+	/*
+	returns cache of current thread, or nullptr if thread is exiting
+	*/
+	ThreadCache* threadCache()
+	{
+		if (threadCacheDestroyed) return nullptr;
+		thread_local ThreadCache cache;
+		return &cache;
+	}
+
+	void* poolMalloc(int size)
+	{
+		if (size <= 0) return nullptr;
+		int sizeClass = findClass((size_t)size);
+		if (sizeClass < 0)
+		{
+			auto header = static_cast<Header*>(malloc(HEADER_SIZE + (size_t)size));
+			if (header == nullptr) return nullptr;
+			*header = LARGE_BLOCK | (Header)size;
+			largeAllocations.fetch_add(1, std::memory_order_relaxed);
+			return header + 1;
+		}
+		ThreadCache* cache = threadCache();
+		FreeBlock* block = nullptr;
+		if (cache != nullptr) block = cache->pop(sizeClass);
+		else sharedPool->take(sizeClass, 1, block);
+		if (block == nullptr) return nullptr;
+		auto header = reinterpret_cast<Header*>(block);
+		*header = (Header)sizeClass;
+		return header + 1;
+	}
+
+	void poolFree(void* memory)
+	{
+		if (memory == nullptr) return;
+		Header* header = static_cast<Header*>(memory) - 1;
+		if (*header & LARGE_BLOCK)
+		{
+			free(header);
+			return;
+		}
+		auto block = reinterpret_cast<FreeBlock*>(header);
+		ThreadCache* cache = threadCache();
+		if (cache != nullptr) cache->push((int)*header, block);
+		else sharedPool->give((int)*header, block, block);
+	}
+
+	int poolSize(void* memory)
+	{
+		if (memory == nullptr) return 0;
+		Header header = *(static_cast<Header*>(memory) - 1);
+		if (header & LARGE_BLOCK) return (int)(header & ~LARGE_BLOCK);
+		return (int)(classSizes[(size_t)header] - HEADER_SIZE);
+	}
+
+	void* poolRealloc(void* memory, int size)
+	{
+		int oldSize = poolSize(memory);
+		Header header = *(static_cast<Header*>(memory) - 1);
+		// block of size class already has room for new size
+		if (!(header & LARGE_BLOCK) && size <= oldSize && findClass((size_t)size) == (int)header)
+			return memory;
+
+		void* resized = poolMalloc(size);
+		if (resized == nullptr) return nullptr;
+		memcpy(resized, memory, (size_t)(oldSize < size ? oldSize : size));
+		poolFree(memory);
+		return resized;
+	}
+
+	int poolRoundup(int size)
+	{
+		int sizeClass = findClass((size_t)size);
+		if (sizeClass < 0) return (size + 7) & ~7;
+		return (int)(classSizes[sizeClass] - HEADER_SIZE);
+	}
+
+	int poolInit(void*)
+	{
+		return SQLITE_OK;
+	}
+
+	void poolShutdown(void*)
+	{
+
+	}
+}
+
+bool momo::configure(const MemoryConfig& config)
+{
+	// pools are shared with thread caches which may outlive configuration, so allocator can be installed only once
+	if (sharedPool != nullptr) return false;
+
+	memoryConfig = config;
+	if (memoryConfig.maxPooledSize < GRANULARITY) memoryConfig.maxPooledSize = GRANULARITY;
+	if (memoryConfig.threadCacheBlocks < 2) memoryConfig.threadCacheBlocks = 2;
+	buildClasses();
+
+	sqlite3_mem_methods methods = {
+		poolMalloc,
+		poolFree,
+		poolRealloc,
+		poolSize,
+		poolRoundup,
+		poolInit,
+		poolShutdown,
+		nullptr,
+	};
+	sharedPool = new SharedPool(classSizes.size());
+	if (sqlite3_config(SQLITE_CONFIG_MALLOC, &methods) != SQLITE_OK)
+	{
+		delete sharedPool;
+		sharedPool = nullptr;
+		return false;
+	}
+	return true;
+}
+
+momo::AllocatorStatistics momo::getAllocatorStatistics()
+{
+	AllocatorStatistics statistics;
+	statistics.bytesUsed = sqlite3_memory_used();
+	statistics.bytesReserved = bytesReserved;
+	statistics.threadCacheHits = threadCacheHits;
+	statistics.poolRefills = poolRefills;
+	statistics.poolReturns = poolReturns;
+	statistics.largeAllocations = largeAllocations;
+	return statistics;
+}
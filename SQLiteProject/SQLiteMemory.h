@@ -0,0 +1,75 @@
+#pragma once
+
+#include "sqlite3.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace momo
+{
+	/*
+	configuration of pooled memory allocator
+	*/
+	struct MemoryConfig
+	{
+		/*
+		allocations larger than this size (in bytes) are passed to system malloc
+		*/
+		size_t maxPooledSize = 16 * 1024;
+
+		/*
+		number of free blocks of each size class kept by every thread
+		blocks are moved between thread cache and shared pool in batches of half of this number
+		*/
+		size_t threadCacheBlocks = 32;
+
+		/*
+		minimal size of memory block requested from the system to refill shared pool
+		*/
+		size_t chunkSize = 64 * 1024;
+	};
+
+	/*
+	allocator counters collected since configure()
+	*/
+	struct AllocatorStatistics
+	{
+		/*
+		bytes currently allocated by SQLite (sqlite3_memory_used)
+		*/
+		sqlite3_int64 bytesUsed;
+
+		/*
+		bytes requested from the system for pools. Pool memory is reused, but not returned to the system
+		*/
+		std::uint64_t bytesReserved;
+
+		/*
+		allocations served from thread cache without any locking
+		*/
+		std::uint64_t threadCacheHits;
+
+		/*
+		number of batches moved from shared pool to thread caches and back
+		*/
+		std::uint64_t poolRefills;
+		std::uint64_t poolReturns;
+
+		/*
+		allocations larger than MemoryConfig::maxPooledSize
+		*/
+		std::uint64_t largeAllocations;
+	};
+
+	/*
+	installs SQLITE_CONFIG_MALLOC allocator which serves small allocations from size-class pools
+	with per-thread caches, so threads do not contend on the system allocator lock.
+	Must be called before any database is opened (SQLite must not be initialized yet)
+	returns true on success, false on failure
+	*/
+	bool configure(const MemoryConfig& config);
+
+	/*
+	returns allocator counters. Thread cache hits are published in batches, so the value may lag slightly
+	*/
+	AllocatorStatistics getAllocatorStatistics();
+}
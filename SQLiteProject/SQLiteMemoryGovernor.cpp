@@ -0,0 +1,237 @@
+#include "SQLiteMemoryGovernor.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	bool readFile(const std::string& path, std::string& content)
+	{
+		std::ifstream file(path);
+		if (!file) return false;
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		content = buffer.str();
+		return true;
+	}
+
+	bool fileExists(const std::string& path)
+	{
+		return std::ifstream(path).good();
+	}
+
+	/*
+	reads "some avg10=..." value of PSI file, returns negative value if it is not available
+	*/
+	double readPressure(const std::string& path)
+	{
+		std::string content;
+		if (path.empty() || !readFile(path, content)) return -1.0;
+		size_t position = content.find("some avg10=");
+		if (position == std::string::npos) return -1.0;
+		return std::strtod(content.c_str() + position + 11, nullptr);
+	}
+
+	/*
+	reads number of bytes from cgroup file, returns 0 if file is missing or value is unlimited
+	*/
+	std::uint64_t readBytes(const std::string& path)
+	{
+		std::string content;
+		if (path.empty() || !readFile(path, content) || content.compare(0, 3, "max") == 0) return 0;
+		std::uint64_t value = std::strtoull(content.c_str(), nullptr, 10);
+		// cgroup v1 reports missing limit as a huge page-aligned number
+		return value >= (1ull << 60) ? 0 : value;
+	}
+}
+
+momo::MemoryGovernor::MemoryGovernor(const MemoryGovernorConfig& config)
+	: _config(config), _running(false), _previousHeapLimit(0), _heapLimit(0), _statistics()
+{
+
+}
+
+void momo::MemoryGovernor::findCgroupFiles()
+{
+	_pressureFile = _config.pressureFile;
+	_usageFile.clear();
+	_limitFile.clear();
+
+	std::ifstream cgroups("/proc/self/cgroup");
+	std::string line;
+	while (std::getline(cgroups, line))
+	{
+		size_t first = line.find(':');
+		size_t second = line.find(':', first + 1);
+		if (first == std::string::npos || second == std::string::npos) continue;
+		std::string controllers = line.substr(first + 1, second - first - 1);
+		std::string path = line.substr(second + 1);
+
+		if (controllers.empty())
+		{
+			// cgroup v2 unified hierarchy
+			std::string directory = "/sys/fs/cgroup" + path;
+			if (_usageFile.empty() && fileExists(directory + "/memory.current"))
+			{
+				_usageFile = directory + "/memory.current";
+				_limitFile = directory + "/memory.max";
+			}
+			if (_pressureFile.empty() && fileExists(directory + "/memory.pressure"))
+				_pressureFile = directory + "/memory.pressure";
+		}
+		else if (controllers == "memory" && _usageFile.empty())
+		{
+			// cgroup v1, path may be hidden by cgroup namespace of the container
+			std::string directory = "/sys/fs/cgroup/memory" + path;
+			if (!fileExists(directory + "/memory.usage_in_bytes")) directory = "/sys/fs/cgroup/memory";
+			if (fileExists(directory + "/memory.usage_in_bytes"))
+			{
+				_usageFile = directory + "/memory.usage_in_bytes";
+				_limitFile = directory + "/memory.limit_in_bytes";
+			}
+		}
+	}
+	if (_pressureFile.empty() && fileExists("/proc/pressure/memory"))
+		_pressureFile = "/proc/pressure/memory";
+}
+
+void momo::MemoryGovernor::attach(SQLite3& database)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (std::find(_connections.begin(), _connections.end(), &database) != _connections.end()) return;
+	_connections.push_back(&database);
+}
+
+void momo::MemoryGovernor::detach(SQLite3& database)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_connections.erase(std::remove(_connections.begin(), _connections.end(), &database), _connections.end());
+}
+
+bool momo::MemoryGovernor::start()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_running) return true;
+	findCgroupFiles();
+
+	sqlite3_int64 limit = _config.softHeapLimit;
+	std::uint64_t cgroupLimit = readBytes(_limitFile);
+	if (limit <= 0 && cgroupLimit > 0) limit = (sqlite3_int64)((double)cgroupLimit * _config.cgroupLimitRatio);
+	_previousHeapLimit = sqlite3_soft_heap_limit64(-1);
+	if (limit > 0) sqlite3_soft_heap_limit64(limit);
+
+	_heapLimit = sqlite3_soft_heap_limit64(-1);
+	_statistics = MemoryGovernorStatistics();
+	_statistics.softHeapLimit = _heapLimit;
+	_running = true;
+	_thread = std::thread(&MemoryGovernor::run, this);
+	return true;
+}
+
+void momo::MemoryGovernor::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_running) return;
+		_running = false;
+		_wakeup.notify_one();
+	}
+	_thread.join();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_statistics.underPressure = false;
+	sqlite3_soft_heap_limit64(_previousHeapLimit);
+}
+
+bool momo::MemoryGovernor::checkPressure()
+{
+	_statistics.pressure = readPressure(_pressureFile);
+	std::uint64_t limit = readBytes(_limitFile);
+	std::uint64_t usage = readBytes(_usageFile);
+	_statistics.cgroupUsage = limit > 0 ? (double)usage / (double)limit : 0.0;
+	return _statistics.pressure > _config.pressureThreshold || _statistics.cgroupUsage > _config.cgroupUsageRatio;
+}
+
+void momo::MemoryGovernor::run()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (_running)
+	{
+		_wakeup.wait_for(lock, _config.pollInterval, [this] { return !_running; });
+		if (!_running) break;
+
+		auto now = std::chrono::steady_clock::now();
+		if (checkPressure())
+		{
+			_lastPressure = now;
+			if (!_statistics.underPressure)
+			{
+				_statistics.underPressure = true;
+				_statistics.pressureEvents++;
+			}
+			release();
+		}
+		else if (_statistics.underPressure && now - _lastPressure >= _config.recoveryDelay)
+		{
+			restore();
+			_statistics.underPressure = false;
+			_statistics.recoveries++;
+		}
+	}
+}
+
+void momo::MemoryGovernor::release()
+{
+	// limit is lowered once per pressure event, so it does not ratchet down while pressure lasts
+	if (_statistics.softHeapLimit == _heapLimit)
+	{
+		sqlite3_int64 base = _heapLimit > 0 ? _heapLimit : sqlite3_memory_used();
+		sqlite3_int64 limit = (sqlite3_int64)((double)base * _config.pressureLimitRatio);
+		if (limit > 0) sqlite3_soft_heap_limit64(limit);
+		_statistics.softHeapLimit = sqlite3_soft_heap_limit64(-1);
+	}
+
+	sqlite3_int64 used = sqlite3_memory_used();
+	// connection mutex is taken by SQLite, statements of the connection are not touched
+	for (SQLite3* connection : _connections) sqlite3_db_release_memory(connection->handle());
+	sqlite3_int64 released = used - sqlite3_memory_used();
+	if (released > 0) _statistics.releasedBytes += (std::uint64_t)released;
+}
+
+void momo::MemoryGovernor::restore()
+{
+	sqlite3_soft_heap_limit64(_heapLimit);
+	_statistics.softHeapLimit = sqlite3_soft_heap_limit64(-1);
+}
+
+void momo::MemoryGovernor::releaseNow()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_running)
+	{
+		// without monitoring thread nobody restores the limit later, so it is lowered only while memory is released
+		_heapLimit = _statistics.softHeapLimit = sqlite3_soft_heap_limit64(-1);
+		release();
+		restore();
+		return;
+	}
+	release();
+	if (!_statistics.underPressure)
+	{
+		_statistics.underPressure = true;
+		_statistics.pressureEvents++;
+	}
+	_lastPressure = std::chrono::steady_clock::now();
+}
+
+momo::MemoryGovernorStatistics momo::MemoryGovernor::getStatistics() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _statistics;
+}
+
+momo::MemoryGovernor::~MemoryGovernor()
+{
+	stop();
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "SQLite.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace momo
+{
+	/*
+	configuration of MemoryGovernor
+	*/
+	struct MemoryGovernorConfig
+	{
+		/*
+		soft heap limit of SQLite in bytes (sqlite3_soft_heap_limit64)
+		zero sets limit to cgroupLimitRatio of container memory limit, or keeps current limit if there is no such limit
+		*/
+		sqlite3_int64 softHeapLimit = 0;
+		double cgroupLimitRatio = 0.25;
+
+		/*
+		memory is under pressure when "some avg10" value of PSI (percent of time tasks waited for memory) is above
+		pressureThreshold, or when memory used by container is above cgroupUsageRatio of its limit
+		*/
+		double pressureThreshold = 10.0;
+		double cgroupUsageRatio = 0.9;
+
+		/*
+		soft heap limit set under pressure relative to softHeapLimit (or to memory used by SQLite when there is no limit)
+		SQLite recycles cached pages of all connections to stay under the limit
+		*/
+		double pressureLimitRatio = 0.5;
+
+		/*
+		time between pressure checks
+		*/
+		std::chrono::milliseconds pollInterval = std::chrono::seconds(1);
+
+		/*
+		time without pressure after which soft heap limit is restored
+		*/
+		std::chrono::milliseconds recoveryDelay = std::chrono::seconds(10);
+
+		/*
+		file with PSI values, empty to use memory.pressure of current cgroup or /proc/pressure/memory
+		*/
+		std::string pressureFile;
+	};
+
+	/*
+	counters of MemoryGovernor collected since start()
+	*/
+	struct MemoryGovernorStatistics
+	{
+		/*
+		number of times memory pressure started and ended
+		*/
+		std::uint64_t pressureEvents;
+		std::uint64_t recoveries;
+
+		/*
+		bytes freed by sqlite3_db_release_memory
+		*/
+		std::uint64_t releasedBytes;
+
+		bool underPressure;
+
+		/*
+		last PSI "some avg10" value and memory used by container relative to its limit (0 if unknown)
+		*/
+		double pressure;
+		double cgroupUsage;
+
+		/*
+		current soft heap limit, lowered while under pressure
+		*/
+		sqlite3_int64 softHeapLimit;
+	};
+
+	/*
+	keeps SQLite memory within a budget inside memory-limited containers.
+	Governor sets soft heap limit and watches Linux memory pressure (PSI and cgroup v1 / v2 memory usage)
+	in a background thread. Under pressure it lowers soft heap limit and releases memory of attached connections,
+	and restores the limit when pressure is absent for recoveryDelay.
+	Governor thread only calls sqlite3_db_release_memory on attached connections: it does not run statements on them,
+	so their error codes are not changed. SQLite must run in serialized mode (see SQLite3::isThreadSafe())
+
+	example:
+	MemoryGovernor governor;
+	governor.attach(database);
+	governor.start();
+	*/
+	class MemoryGovernor
+	{
+		MemoryGovernorConfig _config;
+		std::vector<SQLite3*> _connections;
+		std::thread _thread;
+		mutable std::mutex _mutex;
+		std::condition_variable _wakeup;
+		bool _running;
+		sqlite3_int64 _previousHeapLimit;
+		sqlite3_int64 _heapLimit;
+		std::string _pressureFile;
+		std::string _usageFile;
+		std::string _limitFile;
+		std::chrono::steady_clock::time_point _lastPressure;
+		MemoryGovernorStatistics _statistics;
+
+		void findCgroupFiles();
+		void run();
+		bool checkPressure();
+
+		/*
+		lowers soft heap limit and releases memory of all connections, mutex must be locked
+		*/
+		void release();
+		void restore();
+	public:
+		MemoryGovernor(const MemoryGovernorConfig& config = MemoryGovernorConfig());
+
+		MemoryGovernor(const MemoryGovernor&) = delete;
+		MemoryGovernor& operator=(const MemoryGovernor&) = delete;
+
+		/*
+		adds connection to the governor. Connection must stay opened until it is detached or governor is stopped
+		*/
+		void attach(SQLite3& database);
+
+		/*
+		removes connection from the governor
+		*/
+		void detach(SQLite3& database);
+
+		/*
+		sets soft heap limit and starts pressure monitoring thread
+		returns true on success, false either
+		*/
+		bool start();
+
+		/*
+		stops monitoring and restores previous soft heap limit
+		automatically called in the destructor
+		*/
+		void stop();
+
+		/*
+		releases memory as if pressure was detected, without waiting for the next check
+		if governor is not running, soft heap limit is restored immediately
+		*/
+		void releaseNow();
+
+		MemoryGovernorStatistics getStatistics() const;
+
+		~MemoryGovernor();
+	};
+}
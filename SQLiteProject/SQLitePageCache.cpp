@@ -0,0 +1,494 @@
+#include "SQLitePageCache.h"
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	momo::PageCacheConfig pageCacheConfig;
+
+	std::atomic<std::uint64_t> hits(0);
+	std::atomic<std::uint64_t> misses(0);
+	std::atomic<std::uint64_t> evictions(0);
+	std::atomic<std::uint64_t> promotions(0);
+
+	enum Queue
+	{
+		NO_QUEUE,
+		FIRST_ACCESS,
+		MAIN,
+	};
+
+	struct Slab;
+
+	/*
+	header of cached page. Stored in slab right after page buffer and extra space
+	*/
+	struct Page
+	{
+		sqlite3_pcache_page page;
+		unsigned key;
+		Queue queue;
+		bool pinned;
+		bool free;
+		Page* previous;
+		Page* next;
+		Slab* slab;
+	};
+
+	/*
+	block of memory holding pagesPerSlab page slots
+	*/
+	struct Slab
+	{
+		char* memory;
+		int used;
+	};
+
+	/*
+	intrusive doubly-linked list of unpinned pages, head is the oldest page
+	*/
+	class PageList
+	{
+		Page* _head;
+		Page* _tail;
+		size_t _size;
+	public:
+		PageList()
+			: _head(nullptr), _tail(nullptr), _size(0)
+		{
+
+		}
+
+		void pushBack(Page* page)
+		{
+			page->previous = _tail;
+			page->next = nullptr;
+			if (_tail != nullptr) _tail->next = page;
+			else _head = page;
+			_tail = page;
+			_size++;
+		}
+
+		void remove(Page* page)
+		{
+			if (page->previous != nullptr) page->previous->next = page->next;
+			else _head = page->next;
+			if (page->next != nullptr) page->next->previous = page->previous;
+			else _tail = page->previous;
+			page->previous = page->next = nullptr;
+			_size--;
+		}
+
+		Page* front() const
+		{
+			return _head;
+		}
+
+		size_t size() const
+		{
+			return _size;
+		}
+	};
+
+	/*
+	2Q page cache of a single connection
+	unpinned pages seen once live in first-access queue, pages seen again (while cached or shortly after eviction) live in main LRU queue
+	*/
+	class PageCache
+	{
+		int _pageSize;
+		int _extraSize;
+		size_t _slotSize;
+		bool _purgeable;
+		size_t _capacity;
+		std::unordered_map<unsigned, Page*> _pages;
+		PageList _firstAccess;
+		PageList _main;
+		std::list<unsigned> _ghosts;
+		std::unordered_map<unsigned, std::list<unsigned>::iterator> _ghostIndex;
+		std::vector<Slab*> _slabs;
+		Page* _free;
+
+		Page* slot(const Slab* slab, int index) const
+		{
+			return reinterpret_cast<Page*>(slab->memory + _slotSize * index + _slotSize - sizeof(Page));
+		}
+
+		static int slabPages()
+		{
+			return pageCacheConfig.pagesPerSlab > 0 ? pageCacheConfig.pagesPerSlab : 1;
+		}
+
+		PageList& list(Queue queue)
+		{
+			return queue == MAIN ? _main : _firstAccess;
+		}
+
+		bool allocateSlab()
+		{
+			int count = slabPages();
+			char* memory = static_cast<char*>(sqlite3_malloc64(_slotSize * count));
+			if (memory == nullptr) return false;
+			Slab* slab = new (std::nothrow) Slab{ memory, 0 };
+			if (slab == nullptr)
+			{
+				sqlite3_free(memory);
+				return false;
+			}
+			_slabs.push_back(slab);
+			for (int i = 0; i < count; i++)
+			{
+				Page* page = slot(slab, i);
+				char* buffer = memory + _slotSize * i;
+				page->page.pBuf = buffer;
+				page->page.pExtra = buffer + _pageSize;
+				page->slab = slab;
+				page->free = true;
+				page->next = _free;
+				_free = page;
+			}
+			return true;
+		}
+
+		Page* takeFreeSlot()
+		{
+			if (_free == nullptr && !allocateSlab()) return nullptr;
+			Page* page = _free;
+			_free = page->next;
+			page->slab->used++;
+			page->free = false;
+			return page;
+		}
+
+		void releaseSlot(Page* page)
+		{
+			page->slab->used--;
+			page->free = true;
+			page->queue = NO_QUEUE;
+			page->next = _free;
+			_free = page;
+		}
+
+		void remember(unsigned key)
+		{
+			size_t limit = (size_t)(_capacity * pageCacheConfig.ghostRatio);
+			if (limit == 0) return;
+			_ghosts.push_back(key);
+			_ghostIndex[key] = std::prev(_ghosts.end());
+			while (_ghosts.size() > limit)
+			{
+				_ghostIndex.erase(_ghosts.front());
+				_ghosts.pop_front();
+			}
+		}
+
+		bool forget(unsigned key)
+		{
+			auto it = _ghostIndex.find(key);
+			if (it == _ghostIndex.end()) return false;
+			_ghosts.erase(it->second);
+			_ghostIndex.erase(it);
+			return true;
+		}
+
+		/*
+		returns unpinned page which should leave the cache next, or nullptr if all pages are pinned
+		*/
+		Page* victim()
+		{
+			size_t firstAccessLimit = (size_t)(_capacity * pageCacheConfig.firstAccessRatio);
+			if (_firstAccess.size() > firstAccessLimit || _main.size() == 0)
+				return _firstAccess.front();
+			return _main.front();
+		}
+
+		/*
+		removes unpinned page from the cache and returns its slot, which is not released
+		*/
+		Page* evict()
+		{
+			Page* page = victim();
+			if (page == nullptr) return nullptr;
+			list(page->queue).remove(page);
+			if (page->queue == FIRST_ACCESS) remember(page->key);
+			_pages.erase(page->key);
+			evictions++;
+			return page;
+		}
+
+		void enforceCapacity()
+		{
+			if (!_purgeable) return;
+			while (_pages.size() > _capacity)
+			{
+				Page* page = evict();
+				if (page == nullptr) break;
+				releaseSlot(page);
+			}
+		}
+
+		void discard(Page* page)
+		{
+			if (!page->pinned) list(page->queue).remove(page);
+			_pages.erase(page->key);
+			releaseSlot(page);
+		}
+	public:
+		PageCache(int pageSize, int extraSize, bool purgeable)
+			: _pageSize(pageSize), _extraSize(extraSize), _purgeable(purgeable), _capacity(100), _free(nullptr)
+		{
+			size_t data = (size_t)pageSize + (size_t)extraSize;
+			data = (data + alignof(Page) - 1) / alignof(Page) * alignof(Page);
+			_slotSize = data + sizeof(Page);
+		}
+
+		PageCache(const PageCache&) = delete;
+		PageCache& operator=(const PageCache&) = delete;
+
+		void setCapacity(size_t capacity)
+		{
+			_capacity = capacity;
+			enforceCapacity();
+		}
+
+		int pageCount() const
+		{
+			return (int)_pages.size();
+		}
+
+		sqlite3_pcache_page* fetch(unsigned key, int createFlag)
+		{
+			auto it = _pages.find(key);
+			if (it != _pages.end())
+			{
+				Page* page = it->second;
+				if (!page->pinned)
+				{
+					list(page->queue).remove(page);
+					page->pinned = true;
+					// second access of unpinned page: page is reused, not just scanned
+					if (page->queue == FIRST_ACCESS)
+					{
+						page->queue = MAIN;
+						promotions++;
+					}
+				}
+				hits++;
+				return &page->page;
+			}
+			misses++;
+			if (createFlag == 0) return nullptr;
+
+			Page* page = nullptr;
+			if (_purgeable && _pages.size() >= _capacity)
+			{
+				page = evict();
+				// createFlag == 1 means new page is needed only if it is cheap to get
+				if (page == nullptr && createFlag == 1) return nullptr;
+			}
+			if (page == nullptr)
+			{
+				page = takeFreeSlot();
+				if (page == nullptr) return nullptr;
+			}
+
+			page->key = key;
+			page->pinned = true;
+			page->previous = page->next = nullptr;
+			if (forget(key))
+			{
+				page->queue = MAIN;
+				promotions++;
+			}
+			else
+			{
+				page->queue = FIRST_ACCESS;
+			}
+			// SQLite checks first pointer of extra space to find out if page is new
+			*static_cast<void**>(page->page.pExtra) = nullptr;
+			_pages[key] = page;
+			return &page->page;
+		}
+
+		void unpin(sqlite3_pcache_page* cachePage, bool discardPage)
+		{
+			Page* page = reinterpret_cast<Page*>(cachePage);
+			if (discardPage)
+			{
+				discard(page);
+				return;
+			}
+			page->pinned = false;
+			list(page->queue).pushBack(page);
+			enforceCapacity();
+		}
+
+		void rekey(sqlite3_pcache_page* cachePage, unsigned oldKey, unsigned newKey)
+		{
+			Page* page = reinterpret_cast<Page*>(cachePage);
+			auto it = _pages.find(newKey);
+			if (it != _pages.end() && it->second != page) discard(it->second);
+			_pages.erase(oldKey);
+			page->key = newKey;
+			_pages[newKey] = page;
+		}
+
+		void truncate(unsigned limit)
+		{
+			std::vector<Page*> removed;
+			for (const auto& entry : _pages)
+			{
+				if (entry.first >= limit) removed.push_back(entry.second);
+			}
+			for (Page* page : removed) discard(page);
+		}
+
+		void shrink()
+		{
+			if (_purgeable)
+			{
+				for (Page* page = evict(); page != nullptr; page = evict()) releaseSlot(page);
+			}
+
+			// free slabs without used pages and rebuild free list from the rest
+			std::vector<Slab*> slabs;
+			for (Slab* slab : _slabs)
+			{
+				if (slab->used != 0)
+				{
+					slabs.push_back(slab);
+					continue;
+				}
+				sqlite3_free(slab->memory);
+				delete slab;
+			}
+			_slabs.swap(slabs);
+			_free = nullptr;
+			for (Slab* slab : _slabs)
+			{
+				for (int i = 0; i < slabPages(); i++)
+				{
+					Page* page = slot(slab, i);
+					if (!page->free) continue;
+					page->next = _free;
+					_free = page;
+				}
+			}
+		}
+
+		~PageCache()
+		{
+			for (Slab* slab : _slabs)
+			{
+				sqlite3_free(slab->memory);
+				delete slab;
+			}
+		}
+	};
+
+	int cacheInit(void*)
+	{
+		return SQLITE_OK;
+	}
+
+	void cacheShutdown(void*)
+	{
+
+	}
+
+	sqlite3_pcache* cacheCreate(int pageSize, int extraSize, int purgeable)
+	{
+		return reinterpret_cast<sqlite3_pcache*>(new (std::nothrow) PageCache(pageSize, extraSize, purgeable != 0));
+	}
+
+	void cacheCachesize(sqlite3_pcache* cache, int capacity)
+	{
+		reinterpret_cast<PageCache*>(cache)->setCapacity(capacity > 0 ? (size_t)capacity : 0);
+	}
+
+	int cachePagecount(sqlite3_pcache* cache)
+	{
+		return reinterpret_cast<PageCache*>(cache)->pageCount();
+	}
+
+	sqlite3_pcache_page* cacheFetch(sqlite3_pcache* cache, unsigned key, int createFlag)
+	{
+		return reinterpret_cast<PageCache*>(cache)->fetch(key, createFlag);
+	}
+
+	void cacheUnpin(sqlite3_pcache* cache, sqlite3_pcache_page* page, int discard)
+	{
+		reinterpret_cast<PageCache*>(cache)->unpin(page, discard != 0);
+	}
+
+	void cacheRekey(sqlite3_pcache* cache, sqlite3_pcache_page* page, unsigned oldKey, unsigned newKey)
+	{
+		reinterpret_cast<PageCache*>(cache)->rekey(page, oldKey, newKey);
+	}
+
+	void cacheTruncate(sqlite3_pcache* cache, unsigned limit)
+	{
+		reinterpret_cast<PageCache*>(cache)->truncate(limit);
+	}
+
+	void cacheDestroy(sqlite3_pcache* cache)
+	{
+		delete reinterpret_cast<PageCache*>(cache);
+	}
+
+	void cacheShrink(sqlite3_pcache* cache)
+	{
+		reinterpret_cast<PageCache*>(cache)->shrink();
+	}
+}
+
+double momo::PageCacheStatistics::hitRatio() const
+{
+	std::uint64_t total = hits + misses;
+	return total == 0 ? 0.0 : (double)hits / (double)total;
+}
+
+bool momo::configure(const PageCacheConfig& config)
+{
+	pageCacheConfig = config;
+	resetPageCacheStatistics();
+	sqlite3_pcache_methods2 methods = {
+		1,
+		nullptr,
+		cacheInit,
+		cacheShutdown,
+		cacheCreate,
+		cacheCachesize,
+		cachePagecount,
+		cacheFetch,
+		cacheUnpin,
+		cacheRekey,
+		cacheTruncate,
+		cacheDestroy,
+		cacheShrink,
+	};
+	return sqlite3_config(SQLITE_CONFIG_PCACHE2, &methods) == SQLITE_OK;
+}
+
+momo::PageCacheStatistics momo::getPageCacheStatistics()
+{
+	PageCacheStatistics statistics;
+	statistics.hits = hits;
+	statistics.misses = misses;
+	statistics.evictions = evictions;
+	statistics.promotions = promotions;
+	return statistics;
+}
+
+void momo::resetPageCacheStatistics()
+{
+	hits = 0;
+	misses = 0;
+	evictions = 0;
+	promotions = 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "sqlite3.h"
+#include <cstdint>
+
+namespace momo
+{
+	/*
+	configuration of scan-resistant page cache
+	*/
+	struct PageCacheConfig
+	{
+		/*
+		part of cache capacity given to pages which were accessed once (first-access queue of 2Q)
+		pages which are accessed again are moved to the main LRU queue,
+		so a single full-table scan can only evict pages from this part of the cache
+		*/
+		double firstAccessRatio = 0.25;
+
+		/*
+		number of evicted page numbers remembered to detect second access, relative to cache capacity
+		*/
+		double ghostRatio = 0.5;
+
+		/*
+		number of page buffers allocated at once
+		*/
+		int pagesPerSlab = 64;
+	};
+
+	/*
+	page cache counters collected over all connections since configure() or last reset
+	*/
+	struct PageCacheStatistics
+	{
+		std::uint64_t hits;
+		std::uint64_t misses;
+		std::uint64_t evictions;
+
+		/*
+		number of pages moved from first-access queue to the main queue
+		*/
+		std::uint64_t promotions;
+
+		/*
+		returns hits / (hits + misses), or 0 if there were no fetches
+		*/
+		double hitRatio() const;
+	};
+
+	/*
+	installs 2Q page cache (sqlite3_pcache_methods2) for all connections of the process.
+	Page buffers are allocated from slabs of PageCacheConfig::pagesPerSlab pages.
+	Must be called before any database is opened (SQLite must not be initialized yet)
+	returns true on success, false on failure
+	*/
+	bool configure(const PageCacheConfig& config);
+
+	/*
+	returns page cache counters. Counters are collected only if cache was installed with configure()
+	*/
+	PageCacheStatistics getPageCacheStatistics();
+
+	/*
+	sets all page cache counters to zero
+	*/
+	void resetPageCacheStatistics();
+}
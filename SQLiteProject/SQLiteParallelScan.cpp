@@ -0,0 +1,204 @@
+#include "SQLiteParallelScan.h"
+#include "SQLiteSnapshot.h"
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	/*
+	state shared by scan threads
+	*/
+	struct Scan
+	{
+		std::string filename;
+		std::string SQL;
+		const momo::BatchVisitor* visitor;
+		const momo::ParallelScanConfig* config;
+		sqlite3_int64 minRowid;
+		sqlite3_int64 maxRowid;
+		std::uint64_t span;
+		size_t ranges;
+		momo::Snapshot snapshot;
+
+		std::atomic<size_t> nextRange{ 0 };
+		std::atomic<bool> stop{ false };
+		std::atomic<bool> consistent{ true };
+		std::atomic<std::uint64_t> rows{ 0 };
+		std::atomic<std::uint64_t> batches{ 0 };
+
+		std::mutex mutex;
+		std::string errorMessage;
+		std::exception_ptr exception;
+
+		void fail(const std::string& message, std::exception_ptr thrown = nullptr)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (errorMessage.empty())
+			{
+				errorMessage = message;
+				exception = thrown;
+			}
+			stop = true;
+		}
+	};
+
+	bool visit(Scan& scan, size_t worker, std::vector<std::vector<momo::Value>>& batch)
+	{
+		if (batch.empty()) return true;
+		scan.rows += batch.size();
+		scan.batches++;
+		bool proceed = (*scan.visitor)(worker, batch);
+		batch.clear();
+		if (!proceed) scan.stop = true;
+		return proceed;
+	}
+
+	void scanRanges(Scan& scan, size_t worker)
+	{
+		momo::SQLite3 connection;
+		if (!connection.open(scan.filename, scan.config->open))
+		{
+			scan.fail(connection.getErrorMessage());
+			return;
+		}
+		if (!scan.snapshot.isValid() || !scan.snapshot.open(connection))
+		{
+			scan.consistent = false;
+			if (!connection.execute("BEGIN;"))
+			{
+				scan.fail(connection.getErrorMessage());
+				return;
+			}
+		}
+		momo::Statement statement;
+		if (!connection.prepare(scan.SQL, statement))
+		{
+			scan.fail(connection.getErrorMessage());
+			return;
+		}
+
+		std::vector<std::vector<momo::Value>> batch;
+		int columns = statement.columnCount();
+		while (!scan.stop)
+		{
+			size_t range = scan.nextRange++;
+			if (range >= scan.ranges) break;
+			sqlite3_int64 low = (sqlite3_int64)((std::uint64_t)scan.minRowid + range * scan.span);
+			sqlite3_int64 high = range + 1 == scan.ranges ? scan.maxRowid : (sqlite3_int64)((std::uint64_t)low + scan.span - 1);
+
+			statement.reset();
+			if (!statement.bind({ low, high }))
+			{
+				scan.fail(statement.getErrorMessage());
+				break;
+			}
+			while (!scan.stop && statement.step())
+			{
+				std::vector<momo::Value> row;
+				row.reserve(columns);
+				for (int i = 0; i < columns; i++) row.push_back(statement.column(i));
+				batch.push_back(std::move(row));
+				if (batch.size() >= scan.config->batchRows && !visit(scan, worker, batch)) break;
+			}
+			if (!statement.success())
+			{
+				scan.fail(statement.getErrorMessage());
+				break;
+			}
+		}
+		if (!scan.stop) visit(scan, worker, batch);
+		statement.finalize();
+		connection.execute("COMMIT;");
+	}
+
+	/*
+	runs scanRanges() in a scan thread, exception thrown by visitor fails the scan and is rethrown after threads are joined
+	*/
+	void scanWorker(Scan& scan, size_t worker)
+	{
+		try
+		{
+			scanRanges(scan, worker);
+		}
+		catch (const std::exception& e)
+		{
+			scan.fail(std::string("exception in scan thread: ") + e.what(), std::current_exception());
+		}
+		catch (...)
+		{
+			scan.fail("exception in scan thread", std::current_exception());
+		}
+	}
+}
+
+bool momo::parallelScan(SQLite3& database, const std::string& table, const std::string& columns, const std::string& predicate,
+	size_t threads, const BatchVisitor& visitor, const ParallelScanConfig& config, std::string* errorMessage, ParallelScanStatistics* statistics)
+{
+	ParallelScanStatistics result = ParallelScanStatistics();
+	auto finish = [&](bool success, const std::string& message)
+	{
+		if (errorMessage != nullptr) *errorMessage = message;
+		if (statistics != nullptr) *statistics = result;
+		return success;
+	};
+	if (threads == 0) threads = 1;
+
+	const char* filename = database.handle() != nullptr ? sqlite3_db_filename(database.handle(), "main") : nullptr;
+	if (filename == nullptr || *filename == '\0') return finish(false, "parallel scan requires file database");
+
+	// read transaction of the database pins the snapshot threads read
+	bool transaction = sqlite3_get_autocommit(database.handle()) != 0;
+	if (transaction && !database.execute("BEGIN;")) return finish(false, database.getErrorMessage());
+	auto end = [&](bool success, const std::string& message)
+	{
+		if (transaction) database.execute("COMMIT;");
+		return finish(success, message);
+	};
+
+	Statement bounds;
+	if (!database.prepare("SELECT min(rowid), max(rowid) FROM " + table + ";", bounds)) return end(false, database.getErrorMessage());
+	if (!bounds.step()) return end(false, bounds.getErrorMessage());
+	if (bounds.column(0).isNull()) return end(true, std::string());
+
+	Scan scan;
+	scan.filename = filename;
+	scan.SQL = "SELECT " + (columns.empty() ? std::string("*") : columns) + " FROM " + table + " WHERE rowid BETWEEN ?1 AND ?2";
+	if (!predicate.empty()) scan.SQL += " AND (" + predicate + ")";
+	scan.SQL += ';';
+	scan.visitor = &visitor;
+	scan.config = &config;
+	scan.minRowid = bounds.column(0).asInteger();
+	scan.maxRowid = bounds.column(1).asInteger();
+	bounds.finalize();
+
+	// equal rowid ranges, number of ranges is limited by number of rowids
+	std::uint64_t width = (std::uint64_t)scan.maxRowid - (std::uint64_t)scan.minRowid;
+	std::uint64_t ranges = (std::uint64_t)threads * (config.rangesPerThread == 0 ? 1 : config.rangesPerThread);
+	if (width < ranges) ranges = width + 1;
+	scan.span = width / ranges + 1;
+	scan.ranges = (size_t)(width / scan.span + 1);
+
+	result.minRowid = scan.minRowid;
+	result.maxRowid = scan.maxRowid;
+	result.ranges = scan.ranges;
+	result.consistent = false;
+	scan.snapshot.take(database);
+
+	std::vector<std::thread> workers;
+	if (threads > scan.ranges) threads = scan.ranges;
+	for (size_t i = 0; i < threads; i++) workers.emplace_back(scanWorker, std::ref(scan), i);
+	for (auto& worker : workers) worker.join();
+
+	scan.snapshot.release();
+	result.rows = scan.rows;
+	result.batches = scan.batches;
+	result.consistent = scan.consistent;
+	if (scan.exception)
+	{
+		end(false, scan.errorMessage);
+		std::rethrow_exception(scan.exception);
+	}
+	return end(scan.errorMessage.empty(), scan.errorMessage);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "SQLite.h"
+#include <cstdint>
+
+namespace momo
+{
+	/*
+	function called by scan threads with batches of rows, returns false to stop the scan
+	called concurrently from several threads, worker is index of the calling thread
+	*/
+	using BatchVisitor = std::function<bool(size_t worker, const std::vector<std::vector<Value>>& rows)>;
+
+	/*
+	configuration of parallelScan
+	*/
+	struct ParallelScanConfig
+	{
+		/*
+		number of rows passed to visitor at once
+		*/
+		size_t batchRows = 1024;
+
+		/*
+		number of rowid ranges per thread. Threads take ranges one by one, so more ranges balance
+		threads better when rowids have gaps or predicate filters rows unevenly
+		*/
+		size_t rangesPerThread = 8;
+
+		/*
+		options of connections opened by scan threads
+		*/
+		OpenOptions open;
+	};
+
+	/*
+	statistics of one parallelScan call
+	*/
+	struct ParallelScanStatistics
+	{
+		sqlite3_int64 minRowid;
+		sqlite3_int64 maxRowid;
+		size_t ranges;
+		std::uint64_t rows;
+		std::uint64_t batches;
+
+		/*
+		true if all threads read the same snapshot of WAL database (see parallelScan)
+		*/
+		bool consistent;
+	};
+
+	/*
+	scans rowid table in parallel: rowid range of the table is split into threads * rangesPerThread ranges
+	which threads read with `rowid BETWEEN` queries on their own connections, taking ranges from a shared counter.
+	columns and predicate are SQL expressions: SELECT {columns} FROM {table} WHERE rowid BETWEEN ? AND ? AND ({predicate}),
+	empty predicate reads all rows. Order of rows and batches is not defined.
+	If SQLite and wrapper are compiled with SQLITE_ENABLE_SNAPSHOT and database is in WAL mode, all threads read
+	the snapshot of the database seen by connection provided (see Snapshot), otherwise each thread reads the latest data
+	at the moment its read transaction starts.
+	database must be a file database, it is not used by scan threads
+	returns true on success (also if visitor stopped the scan), false on failure with error stored to errorMessage
+	exception thrown by visitor stops all threads and is rethrown by parallelScan once they are joined
+
+	example:
+	parallelScan(database, "ORDERS", "ID, TOTAL", "TOTAL > 100", 4, [](size_t, const std::vector<std::vector<Value>>& rows)
+	{
+		...
+		return true;
+	});
+	*/
+	bool parallelScan(SQLite3& database, const std::string& table, const std::string& columns, const std::string& predicate,
+		size_t threads, const BatchVisitor& visitor, const ParallelScanConfig& config = ParallelScanConfig(),
+		std::string* errorMessage = nullptr, ParallelScanStatistics* statistics = nullptr);
+}
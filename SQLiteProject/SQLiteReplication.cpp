@@ -0,0 +1,371 @@
+#include "SQLiteReplication.h"
+
+namespace
+{
+	/*
+	RAII lock of connection mutex, so no transaction can start while changes are taken from the session
+	*/
+	class ConnectionLock
+	{
+		sqlite3_mutex* _mutex;
+	public:
+		ConnectionLock(sqlite3* database) : _mutex(sqlite3_db_mutex(database)) { sqlite3_mutex_enter(_mutex); }
+		ConnectionLock(const ConnectionLock&) = delete;
+		ConnectionLock& operator=(const ConnectionLock&) = delete;
+		~ConnectionLock() { sqlite3_mutex_leave(_mutex); }
+	};
+}
+
+momo::Replicator::Replicator(SQLite3& database, const ReplicationConfig& config)
+	: _database(database), _config(config), _session(nullptr), _running(false), _pendingCommits(0), _backlog(false), _statistics()
+{
+	if (_config.maxBatchCommits == 0) _config.maxBatchCommits = 1;
+}
+
+void momo::Replicator::setError(const std::string& message)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_errorMessage = message;
+}
+
+bool momo::Replicator::addReplica(const std::string& name)
+{
+	std::lock_guard<std::mutex> sync(_syncMutex);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_running)
+		{
+			_errorMessage = "replicas can not be added while replicator is running";
+			return false;
+		}
+	}
+	_replicas.emplace_back();
+	Replica& replica = _replicas.back();
+	replica.name = name;
+	replica.connection.setBusyPolicy(_config.busy);
+	if (!replica.connection.open(name, _config.open))
+	{
+		setError(replica.connection.getErrorMessage());
+		_replicas.pop_back();
+		return false;
+	}
+	return true;
+}
+
+#if defined(SQLITE_ENABLE_SESSION)
+
+namespace
+{
+	bool isLockError(int result)
+	{
+		result &= 0xFF;
+		return result == SQLITE_BUSY || result == SQLITE_LOCKED;
+	}
+
+	struct ConflictContext
+	{
+		momo::CONFLICT_POLICY policy;
+		std::uint64_t conflicts;
+	};
+
+	int onConflict(void* context, int type, sqlite3_changeset_iter*)
+	{
+		auto conflict = static_cast<ConflictContext*>(context);
+		conflict->conflicts++;
+		switch (conflict->policy)
+		{
+		case momo::PRIMARY_WINS:
+			// REPLACE is allowed only for rows which exist with other values
+			return type == SQLITE_CHANGESET_DATA || type == SQLITE_CHANGESET_CONFLICT ? SQLITE_CHANGESET_REPLACE : SQLITE_CHANGESET_OMIT;
+		case momo::REPLICA_WINS:
+			return SQLITE_CHANGESET_OMIT;
+		default:
+			return SQLITE_CHANGESET_ABORT;
+		}
+	}
+}
+
+bool momo::Replicator::createSession()
+{
+	sqlite3_session* session = nullptr;
+	int result = sqlite3session_create(_database.handle(), "main", &session);
+	if (result == SQLITE_OK)
+	{
+		if (_config.tables.empty())
+		{
+			result = sqlite3session_attach(session, nullptr);
+		}
+		for (const std::string& table : _config.tables)
+		{
+			result = sqlite3session_attach(session, table.c_str());
+			if (result != SQLITE_OK) break;
+		}
+	}
+	if (result != SQLITE_OK)
+	{
+		if (session != nullptr) sqlite3session_delete(session);
+		setError(std::string("failed to create session: ") + sqlite3_errstr(result));
+		return false;
+	}
+	_session = session;
+	return true;
+}
+
+void momo::Replicator::deleteSession()
+{
+	if (_session == nullptr) return;
+	sqlite3session_delete(_session);
+	_session = nullptr;
+}
+
+bool momo::Replicator::apply(Replica& replica, std::string& changeset)
+{
+	ConflictContext context{ _config.conflictPolicy, 0 };
+	int result = sqlite3changeset_apply(replica.connection.handle(), (int)changeset.size(), &changeset[0], nullptr, onConflict, &context);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_statistics.conflicts += context.conflicts;
+	if (result == SQLITE_OK)
+	{
+		_statistics.applied++;
+		return true;
+	}
+	_statistics.failed++;
+	_errorMessage = replica.name + ": " + (result == SQLITE_ABORT ? "changeset aborted on conflict" : sqlite3_errmsg(replica.connection.handle()));
+	if (!isLockError(result)) replica.failed = true;
+	return false;
+}
+
+bool momo::Replicator::replicate()
+{
+	std::string changeset;
+	std::chrono::steady_clock::time_point firstCommit;
+	size_t commits = 0;
+	{
+		ConnectionLock connection(_database.handle());
+		if (!sqlite3_get_autocommit(_database.handle()))
+		{
+			setError("primary connection is inside transaction");
+			return false;
+		}
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			commits = _pendingCommits;
+			firstCommit = _firstCommit;
+			_pendingCommits = 0;
+		}
+
+		int size = 0;
+		void* data = nullptr;
+		int result = sqlite3session_changeset(_session, &size, &data);
+		if (result == SQLITE_OK) changeset.assign(static_cast<const char*>(data), size);
+		sqlite3_free(data);
+
+		// session accumulates all changes since it was created, so it is replaced after every changeset
+		deleteSession();
+		bool created = createSession();
+		if (result != SQLITE_OK || !created)
+		{
+			// replicas can not be brought up to date without lost changes
+			for (Replica& replica : _replicas) replica.failed = true;
+			if (result != SQLITE_OK) setError(std::string("failed to get changeset: ") + sqlite3_errstr(result));
+			return false;
+		}
+	}
+
+	if (!changeset.empty())
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_statistics.changesets++;
+		_statistics.changesetBytes += changeset.size();
+	}
+
+	bool synchronized = true;
+	bool backlog = false;
+	for (Replica& replica : _replicas)
+	{
+		if (!changeset.empty() && !replica.failed) replica.backlog.push_back(changeset);
+		size_t applied = 0;
+		while (applied < replica.backlog.size() && !replica.failed && apply(replica, replica.backlog[applied])) applied++;
+		replica.backlog.erase(replica.backlog.begin(), replica.backlog.begin() + applied);
+		if (replica.failed) replica.backlog.clear();
+		synchronized = synchronized && !replica.failed && replica.backlog.empty();
+		backlog = backlog || !replica.backlog.empty();
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (synchronized && (commits != 0 || _backlog))
+	{
+		// lag of changes kept in backlog is counted from their commit
+		auto lag = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - (_backlog ? _backlogCommit : firstCommit));
+		_statistics.lastLag = lag;
+		if (lag > _statistics.maxLag) _statistics.maxLag = lag;
+	}
+	else if (commits != 0 && !_backlog)
+	{
+		_backlogCommit = firstCommit;
+	}
+	_backlog = backlog;
+	return synchronized;
+}
+
+#else
+
+bool momo::Replicator::createSession()
+{
+	setError("session extension is not available, SQLITE_ENABLE_SESSION and SQLITE_ENABLE_PREUPDATE_HOOK must be defined");
+	return false;
+}
+
+void momo::Replicator::deleteSession()
+{
+
+}
+
+bool momo::Replicator::apply(Replica&, std::string&)
+{
+	return false;
+}
+
+bool momo::Replicator::replicate()
+{
+	return false;
+}
+
+#endif
+
+void momo::Replicator::onCommit()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_statistics.commits++;
+	if (_pendingCommits++ == 0)
+	{
+		_firstCommit = std::chrono::steady_clock::now();
+		_wakeup.notify_one();
+	}
+	else if (_pendingCommits >= _config.maxBatchCommits)
+	{
+		_wakeup.notify_one();
+	}
+}
+
+bool momo::Replicator::start()
+{
+	std::lock_guard<std::mutex> sync(_syncMutex);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_running) return true;
+	}
+	if (_database.handle() == nullptr)
+	{
+		setError("primary database is not opened");
+		return false;
+	}
+	if (sqlite3_db_mutex(_database.handle()) == nullptr)
+	{
+		setError("replication requires SQLite in serialized mode");
+		return false;
+	}
+	{
+		// changes made before session is created can not be replicated
+		ConnectionLock connection(_database.handle());
+		if (!sqlite3_get_autocommit(_database.handle()))
+		{
+			setError("primary connection is inside transaction");
+			return false;
+		}
+		if (!createSession()) return false;
+		_hooks.push_back(_database.addCommitHook([this]() { onCommit(); }));
+	}
+	for (Replica& replica : _replicas)
+	{
+		replica.failed = false;
+		replica.backlog.clear();
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_statistics = ReplicationStatistics();
+	_pendingCommits = 0;
+	_backlog = false;
+	_running = true;
+	_thread = std::thread(&Replicator::run, this);
+	return true;
+}
+
+void momo::Replicator::run()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (_running)
+	{
+		if (_pendingCommits == 0 && !_backlog)
+		{
+			_wakeup.wait(lock);
+			continue;
+		}
+		auto deadline = _firstCommit + _config.batchDelay;
+		if (_pendingCommits != 0 && _pendingCommits < _config.maxBatchCommits && std::chrono::steady_clock::now() < deadline)
+		{
+			_wakeup.wait_until(lock, deadline);
+			continue;
+		}
+
+		lock.unlock();
+		{
+			std::lock_guard<std::mutex> sync(_syncMutex);
+			replicate();
+		}
+		lock.lock();
+
+		// changes are kept while primary is inside transaction or replicas are locked, next attempt is made after batchDelay
+		if (_running && (_pendingCommits != 0 || _backlog)) _wakeup.wait_for(lock, _config.batchDelay);
+	}
+}
+
+void momo::Replicator::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_running) return;
+		_running = false;
+		_wakeup.notify_all();
+	}
+	_thread.join();
+
+	std::lock_guard<std::mutex> sync(_syncMutex);
+	replicate();
+	ConnectionLock connection(_database.handle());
+	for (int id : _hooks) _database.removeHook(id);
+	_hooks.clear();
+	deleteSession();
+}
+
+bool momo::Replicator::sync()
+{
+	std::lock_guard<std::mutex> sync(_syncMutex);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_running)
+		{
+			_errorMessage = "replicator is not running";
+			return false;
+		}
+	}
+	return replicate();
+}
+
+momo::ReplicationStatistics momo::Replicator::getStatistics() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _statistics;
+}
+
+std::string momo::Replicator::getErrorMessage() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _errorMessage;
+}
+
+momo::Replicator::~Replicator()
+{
+	stop();
+}
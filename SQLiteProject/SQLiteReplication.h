@@ -0,0 +1,202 @@
+#pragma once
+
+#include "SQLite.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <thread>
+
+/*
+session object of SQLite session extension, declared by sqlite3.h only if SQLITE_ENABLE_SESSION is defined
+*/
+struct sqlite3_session;
+
+namespace momo
+{
+	/*
+	enum of actions taken by Replicator when a change can not be applied to a replica as is
+	*/
+	enum CONFLICT_POLICY
+	{
+		/*
+		row of the replica is replaced by the row of the primary, changes to missing rows are skipped
+		*/
+		PRIMARY_WINS,
+
+		/*
+		conflicting change is skipped and replica keeps its row
+		*/
+		REPLICA_WINS,
+
+		/*
+		whole changeset is rolled back on the replica and replication to it is stopped
+		*/
+		ABORT_ON_CONFLICT
+	};
+
+	/*
+	configuration of Replicator
+	*/
+	struct ReplicationConfig
+	{
+		/*
+		tables which are replicated, all tables with PRIMARY KEY if empty
+		*/
+		std::vector<std::string> tables;
+
+		/*
+		time commits of the primary are collected into one changeset after the first of them
+		*/
+		std::chrono::milliseconds batchDelay = std::chrono::milliseconds(5);
+
+		/*
+		number of commits after which changeset is applied without waiting for batchDelay
+		*/
+		size_t maxBatchCommits = 1000;
+
+		CONFLICT_POLICY conflictPolicy = PRIMARY_WINS;
+
+		/*
+		options and busy policy of replica connections
+		*/
+		OpenOptions open;
+		BusyPolicy busy;
+	};
+
+	/*
+	counters of Replicator collected since start()
+	*/
+	struct ReplicationStatistics
+	{
+		/*
+		commits of the primary seen by commit hook
+		*/
+		std::uint64_t commits;
+
+		/*
+		changesets taken from the primary and their total size
+		*/
+		std::uint64_t changesets;
+		std::uint64_t changesetBytes;
+
+		/*
+		changesets applied to replicas, counted once per replica
+		*/
+		std::uint64_t applied;
+		std::uint64_t failed;
+		std::uint64_t conflicts;
+
+		/*
+		time from the first commit of a changeset until it was applied to all replicas
+		*/
+		std::chrono::microseconds lastLag;
+		std::chrono::microseconds maxLag;
+	};
+
+	/*
+	replicates changes of a primary connection to replica database files with SQLite session extension.
+	Session object attached to the primary records changes of committed transactions, background thread takes them
+	as a changeset after batchDelay and applies it to every replica with sqlite3changeset_apply in one transaction.
+	Replicas must start as copies of the primary (e.g. made with backup API) and must not be written by anybody else,
+	schema changes are not replicated. Tables without PRIMARY KEY are ignored by session extension.
+	Primary connection is used from replication thread, so SQLite must run in serialized mode (see SQLite3::isThreadSafe()).
+	Session extension installs preupdate hook, so ChangeStream with values can not be used on the primary.
+	Requires SQLite and wrapper compiled with SQLITE_ENABLE_SESSION and SQLITE_ENABLE_PREUPDATE_HOOK,
+	start() fails otherwise.
+
+	example:
+	Replicator replicator(database);
+	replicator.addReplica("replica.db");
+	replicator.start();
+	*/
+	class Replicator
+	{
+		struct Replica
+		{
+			std::string name;
+			SQLite3 connection;
+
+			/*
+			changesets not applied yet because replica was locked
+			*/
+			std::vector<std::string> backlog;
+			bool failed = false;
+		};
+
+		SQLite3& _database;
+		ReplicationConfig _config;
+		std::list<Replica> _replicas;
+		sqlite3_session* _session;
+		std::vector<int> _hooks;
+		std::thread _thread;
+		mutable std::mutex _mutex;
+		std::condition_variable _wakeup;
+		std::mutex _syncMutex;
+		bool _running;
+		size_t _pendingCommits;
+		std::chrono::steady_clock::time_point _firstCommit;
+
+		/*
+		some replica keeps changesets it could not apply because it was locked, with the oldest commit among them
+		*/
+		bool _backlog;
+		std::chrono::steady_clock::time_point _backlogCommit;
+		ReplicationStatistics _statistics;
+		std::string _errorMessage;
+
+		bool createSession();
+		void deleteSession();
+		void onCommit();
+		void run();
+
+		/*
+		takes changes recorded since the last call and applies them to replicas, _syncMutex must be locked
+		*/
+		bool replicate();
+		bool apply(Replica& replica, std::string& changeset);
+		void setError(const std::string& message);
+	public:
+		/*
+		creates replicator for primary database provided. Database must stay opened while replicator is running
+		*/
+		Replicator(SQLite3& database, const ReplicationConfig& config = ReplicationConfig());
+
+		Replicator(const Replicator&) = delete;
+		Replicator& operator=(const Replicator&) = delete;
+
+		/*
+		opens replica database file, replicas can be added only while replicator is stopped
+		returns true on success, false on failure (see getErrorMessage())
+		*/
+		bool addReplica(const std::string& name);
+
+		/*
+		attaches session to the primary and starts replication thread
+		returns true on success, false on failure (see getErrorMessage())
+		*/
+		bool start();
+
+		/*
+		applies remaining changes, stops replication thread and closes session
+		automatically called in the destructor
+		*/
+		void stop();
+
+		/*
+		applies changes committed so far to replicas without waiting for batchDelay
+		returns true if all replicas are up to date, false either
+		*/
+		bool sync();
+
+		ReplicationStatistics getStatistics() const;
+
+		/*
+		returns last replication error
+		*/
+		std::string getErrorMessage() const;
+
+		~Replicator();
+	};
+}
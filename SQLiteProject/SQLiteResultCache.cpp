@@ -0,0 +1,493 @@
+#include "SQLiteResultCache.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace
+{
+	std::string lowercase(const char* text)
+	{
+		std::string result(text);
+		for (char& c : result) c = (char)std::tolower((unsigned char)c);
+		return result;
+	}
+
+	/*
+	built-in functions whose result depends on something other than their arguments and database content
+	CURRENT_TIMESTAMP, CURRENT_DATE and CURRENT_TIME are reported to authorizer as functions
+	*/
+	bool isNonDeterministic(const std::string& function)
+	{
+		static const char* const functions[] = {
+			"random", "randomblob", "changes", "total_changes", "last_insert_rowid",
+			"date", "time", "datetime", "julianday", "strftime", "unixepoch", "sqlite_offset",
+			"current_timestamp", "current_date", "current_time",
+		};
+		for (const char* name : functions)
+		{
+			if (function == name) return true;
+		}
+		return false;
+	}
+
+	/*
+	appends parameters to cache key, each value is prefixed with its type and length so keys can not collide
+	*/
+	void appendParameters(std::string& key, const std::vector<momo::Value>& parameters)
+	{
+		for (const momo::Value& value : parameters)
+		{
+			key += '\0';
+			switch (value.type())
+			{
+			case momo::Value::NULL_VALUE:
+				key += 'N';
+				break;
+			case momo::Value::INTEGER:
+				key += 'I';
+				key += std::to_string(value.asInteger());
+				break;
+			case momo::Value::REAL:
+			{
+				double real = value.asReal();
+				key += 'R';
+				key.append(reinterpret_cast<const char*>(&real), sizeof(real));
+				break;
+			}
+			case momo::Value::TEXT:
+			case momo::Value::BLOB:
+				key += value.type() == momo::Value::TEXT ? 'T' : 'B';
+				key += std::to_string(value.asText().size());
+				key += ':';
+				key += value.asText();
+				break;
+			case momo::Value::ARRAY:
+			{
+				const momo::Value::Array& array = value.asArray();
+				key += 'A';
+				key += std::to_string(array.count);
+				for (size_t i = 0; i < array.count; i++)
+				{
+					key += ':';
+					switch (array.element)
+					{
+					case momo::Value::Array::INT64:
+						key += std::to_string(static_cast<const std::int64_t*>(array.data)[i]);
+						break;
+					case momo::Value::Array::STRING:
+					{
+						const std::string& text = static_cast<const std::string*>(array.data)[i];
+						key += std::to_string(text.size()) + ':' + text;
+						break;
+					}
+					case momo::Value::Array::STRING_VIEW:
+					{
+						std::string_view text = static_cast<const std::string_view*>(array.data)[i];
+						key += std::to_string(text.size()) + ':';
+						key.append(text.data(), text.size());
+						break;
+					}
+					}
+				}
+				break;
+			}
+			}
+		}
+	}
+}
+
+double momo::ResultCacheStatistics::hitRatio() const
+{
+	std::uint64_t lookups = hits + misses;
+	return lookups == 0 ? 0.0 : (double)hits / (double)lookups;
+}
+
+momo::ResultCache::ResultCache(const ResultCacheConfig& config)
+	: _config(config), _shards(config.shards == 0 ? 1 : config.shards),
+	_hits(0), _misses(0), _bypasses(0), _evictions(0), _invalidations(0)
+{
+
+}
+
+std::string momo::ResultCache::normalize(const std::string& SQL)
+{
+	std::string result;
+	result.reserve(SQL.size());
+	char quote = '\0';
+	bool space = false;
+	for (char c : SQL)
+	{
+		if (quote != '\0')
+		{
+			result += c;
+			if (c == quote) quote = '\0';
+			continue;
+		}
+		if (std::isspace((unsigned char)c))
+		{
+			space = true;
+			continue;
+		}
+		if (space && !result.empty()) result += ' ';
+		space = false;
+		if (c == '\'' || c == '"' || c == '`') quote = c;
+		else if (c == '[') quote = ']';
+		result += c;
+	}
+	while (!result.empty() && (result.back() == ';' || result.back() == ' ')) result.pop_back();
+	return result;
+}
+
+momo::ResultCache::Shard& momo::ResultCache::shardOf(const std::string& key)
+{
+	return _shards[std::hash<std::string>()(key) % _shards.size()];
+}
+
+std::uint64_t momo::ResultCache::generation(const std::string& table)
+{
+	// table is registered, so invalidate() of unqualified name finds tables of running queries
+	std::lock_guard<std::mutex> lock(_generationMutex);
+	return _generations[table];
+}
+
+std::string momo::ResultCache::qualify(sqlite3* database, const char* schema, const std::string& table)
+{
+	const char* filename = sqlite3_db_filename(database, schema == nullptr ? "main" : schema);
+	std::string qualified;
+	if (filename != nullptr && *filename != '\0')
+	{
+		qualified = filename;
+	}
+	else
+	{
+		// in-memory and temporary databases belong to their connection
+		qualified = std::to_string((std::uintptr_t)database) + ':' + (schema == nullptr ? "main" : schema);
+	}
+	qualified += '\0';
+	qualified += table;
+	return qualified;
+}
+
+int momo::ResultCache::collect(Collector& collector, int action, const char* first, const char* second, const char* database)
+{
+	if (collector.tables == nullptr) return SQLITE_OK;
+	if (action == SQLITE_READ && first != nullptr)
+	{
+		std::pair<std::string, std::string> table(database == nullptr ? "main" : database, lowercase(first));
+		if (std::find(collector.tables->begin(), collector.tables->end(), table) == collector.tables->end())
+			collector.tables->push_back(std::move(table));
+	}
+	else if (action == SQLITE_FUNCTION && second != nullptr && isNonDeterministic(lowercase(second)))
+	{
+		collector.deterministic = false;
+	}
+	return SQLITE_OK;
+}
+
+momo::ResultCache::Attachment* momo::ResultCache::findAttachment(SQLite3& database)
+{
+	std::lock_guard<std::mutex> lock(_attachmentMutex);
+	for (Attachment& attachment : _attachments)
+	{
+		if (attachment.database == &database) return &attachment;
+	}
+	return nullptr;
+}
+
+void momo::ResultCache::attach(SQLite3& database)
+{
+	if (findAttachment(database) != nullptr) return;
+	Attachment* attachment;
+	{
+		std::lock_guard<std::mutex> lock(_attachmentMutex);
+		_attachments.push_back(Attachment{ &database, {}, {}, {}, {} });
+		attachment = &_attachments.back();
+	}
+
+	sqlite3* handle = database.handle();
+	attachment->hooks.push_back(database.addUpdateHook([attachment, handle](int, const char* schema, const char* table, sqlite3_int64)
+	{
+		attachment->changedTables.insert(qualify(handle, schema, lowercase(table)));
+	}));
+	attachment->hooks.push_back(database.addCommitHook([this, attachment]()
+	{
+		for (const std::string& table : attachment->changedTables) invalidateTable(table);
+		attachment->committedTables = std::move(attachment->changedTables);
+		attachment->changedTables.clear();
+	}));
+	attachment->hooks.push_back(database.addRollbackHook([attachment]()
+	{
+		attachment->changedTables.clear();
+	}));
+	// commit hook runs before commit is visible, a query of another connection running at that moment
+	// may read old rows and cache them under new generation, so tables are invalidated again after commit
+	attachment->hooks.push_back(database.addWalHook([this, attachment](const char*, int)
+	{
+		for (const std::string& table : attachment->committedTables) invalidateTable(table);
+		attachment->committedTables.clear();
+	}));
+	attachment->hooks.push_back(database.addAuthorizer([attachment](int action, const char* first, const char* second, const char* schema, const char*)
+	{
+		// row by row deletion keeps update hook informed, truncate optimization does not call it
+		if (action == SQLITE_DELETE) return SQLITE_IGNORE;
+		return collect(attachment->collector, action, first, second, schema);
+	}));
+}
+
+void momo::ResultCache::detach(SQLite3& database)
+{
+	std::lock_guard<std::mutex> lock(_attachmentMutex);
+	for (auto attachment = _attachments.begin(); attachment != _attachments.end(); ++attachment)
+	{
+		if (attachment->database != &database) continue;
+		for (int hook : attachment->hooks) database.removeHook(hook);
+		_attachments.erase(attachment);
+		return;
+	}
+}
+
+bool momo::ResultCache::prepare(SQLite3& database, const std::string& SQL, Statement& statement, std::vector<std::string>& tables, bool& cacheable)
+{
+	Attachment* attachment = findAttachment(database);
+	Collector local;
+	Collector& collector = attachment != nullptr ? attachment->collector : local;
+	std::vector<std::pair<std::string, std::string>> read;
+	collector.tables = &read;
+	collector.deterministic = true;
+	int hook = 0;
+	if (attachment == nullptr)
+	{
+		hook = database.addAuthorizer([&local](int action, const char* first, const char* second, const char* schema, const char*)
+		{
+			return collect(local, action, first, second, schema);
+		});
+	}
+
+	bool prepared = database.prepare(SQL, statement);
+
+	collector.tables = nullptr;
+	if (attachment == nullptr) database.removeHook(hook);
+	for (const auto& table : read) tables.push_back(qualify(database.handle(), table.first.c_str(), table.second));
+	cacheable = prepared && collector.deterministic && sqlite3_stmt_readonly(statement.handle()) != 0;
+	return prepared;
+}
+
+std::shared_ptr<momo::ResultSet> momo::ResultCache::run(Statement& statement, const std::vector<Value>& parameters, std::string* errorMessage)
+{
+	int parameterCount = std::min((int)parameters.size(), sqlite3_bind_parameter_count(statement.handle()));
+	for (int i = 0; i < parameterCount; i++)
+	{
+		if (!statement.bind(i + 1, parameters[i]))
+		{
+			if (errorMessage != nullptr) *errorMessage = statement.getErrorMessage();
+			return nullptr;
+		}
+	}
+
+	auto result = std::make_shared<ResultSet>();
+	int count = statement.columnCount();
+	result->bytes = sizeof(ResultSet);
+	for (int i = 0; i < count; i++)
+	{
+		result->columns.emplace_back(statement.columnName(i));
+		result->bytes += sizeof(std::string) + result->columns.back().size();
+	}
+	while (statement.step())
+	{
+		std::vector<Value> row;
+		row.reserve(count);
+		for (int i = 0; i < count; i++)
+		{
+			row.push_back(statement.column(i));
+			result->bytes += sizeof(Value) + row.back().asText().size();
+		}
+		result->rows.push_back(std::move(row));
+	}
+	if (!statement.success())
+	{
+		if (errorMessage != nullptr) *errorMessage = statement.getErrorMessage();
+		return nullptr;
+	}
+	return result;
+}
+
+std::shared_ptr<const momo::ResultSet> momo::ResultCache::query(SQLite3& database, const std::string& SQL, const std::vector<Value>& parameters, std::string* errorMessage)
+{
+	// the same SQL reads different rows in different databases
+	std::string key = qualify(database.handle(), "main", std::string());
+	key += normalize(SQL);
+	appendParameters(key, parameters);
+	// explicit transaction may have uncommitted changes, which must not be cached or hidden by cache
+	bool transaction = sqlite3_get_autocommit(database.handle()) == 0;
+
+	if (!transaction)
+	{
+		Shard& shard = shardOf(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto found = shard.index.find(key);
+		if (found != shard.index.end())
+		{
+			auto entry = found->second;
+			if (_config.maxAge.count() > 0 && std::chrono::steady_clock::now() - entry->created > _config.maxAge)
+			{
+				remove(shard, entry);
+			}
+			else
+			{
+				shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+				_hits.fetch_add(1, std::memory_order_relaxed);
+				return entry->result;
+			}
+		}
+	}
+
+	Statement statement;
+	std::vector<std::string> tables;
+	bool cacheable = false;
+	if (!prepare(database, SQL, statement, tables, cacheable))
+	{
+		if (errorMessage != nullptr) *errorMessage = database.getErrorMessage();
+		return nullptr;
+	}
+	if (transaction || !cacheable)
+	{
+		_bypasses.fetch_add(1, std::memory_order_relaxed);
+		return run(statement, parameters, errorMessage);
+	}
+	_misses.fetch_add(1, std::memory_order_relaxed);
+
+	// result is cached only if none of its tables was changed while query was running
+	std::vector<std::uint64_t> generations;
+	for (const std::string& table : tables) generations.push_back(generation(table));
+	auto created = std::chrono::steady_clock::now();
+	std::shared_ptr<ResultSet> result = run(statement, parameters, errorMessage);
+	if (result == nullptr || result->bytes > _config.maxResultBytes) return result;
+
+	Entry entry{ key, result, tables, created };
+	Shard& shard = shardOf(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	for (size_t i = 0; i < tables.size(); i++)
+	{
+		if (generation(tables[i]) != generations[i]) return result;
+	}
+	auto found = shard.index.find(key);
+	if (found != shard.index.end()) remove(shard, found->second);
+
+	shard.entries.push_front(std::move(entry));
+	shard.index[key] = shard.entries.begin();
+	for (const std::string& table : tables) shard.tableKeys[table].insert(key);
+	shard.bytes += result->bytes + key.size();
+
+	size_t budget = _config.maxBytes / _shards.size();
+	while (shard.bytes > budget && shard.entries.size() > 1)
+	{
+		remove(shard, std::prev(shard.entries.end()));
+		_evictions.fetch_add(1, std::memory_order_relaxed);
+	}
+	return result;
+}
+
+void momo::ResultCache::remove(Shard& shard, std::list<Entry>::iterator entry)
+{
+	for (const std::string& table : entry->tables)
+	{
+		auto keys = shard.tableKeys.find(table);
+		if (keys == shard.tableKeys.end()) continue;
+		keys->second.erase(entry->key);
+		if (keys->second.empty()) shard.tableKeys.erase(keys);
+	}
+	shard.bytes -= entry->result->bytes + entry->key.size();
+	shard.index.erase(entry->key);
+	shard.entries.erase(entry);
+}
+
+void momo::ResultCache::invalidateTable(const std::string& table)
+{
+	{
+		std::lock_guard<std::mutex> lock(_generationMutex);
+		_generations[table]++;
+	}
+	for (Shard& shard : _shards)
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto keys = shard.tableKeys.find(table);
+		if (keys == shard.tableKeys.end()) continue;
+		std::vector<std::string> removed(keys->second.begin(), keys->second.end());
+		for (const std::string& key : removed)
+		{
+			remove(shard, shard.index[key]);
+			_invalidations.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+void momo::ResultCache::invalidate(const std::string& table)
+{
+	std::string name = lowercase(table.c_str());
+	std::vector<std::string> matching;
+	{
+		std::lock_guard<std::mutex> lock(_generationMutex);
+		for (const auto& generation : _generations)
+		{
+			const std::string& qualified = generation.first;
+			size_t separator = qualified.rfind('\0');
+			if (qualified.compare(separator + 1, std::string::npos, name) == 0) matching.push_back(qualified);
+		}
+	}
+	for (const std::string& qualified : matching) invalidateTable(qualified);
+}
+
+void momo::ResultCache::invalidate(SQLite3& database, const std::string& table)
+{
+	invalidateTable(qualify(database.handle(), "main", lowercase(table.c_str())));
+}
+
+void momo::ResultCache::clear()
+{
+	{
+		// running queries must not cache results read before clear()
+		std::lock_guard<std::mutex> lock(_generationMutex);
+		for (auto& generation : _generations) generation.second++;
+	}
+	for (Shard& shard : _shards)
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.entries.clear();
+		shard.index.clear();
+		shard.tableKeys.clear();
+		shard.bytes = 0;
+	}
+}
+
+momo::ResultCacheStatistics momo::ResultCache::getStatistics()
+{
+	ResultCacheStatistics statistics;
+	statistics.hits = _hits;
+	statistics.misses = _misses;
+	statistics.bypasses = _bypasses;
+	statistics.evictions = _evictions;
+	statistics.invalidations = _invalidations;
+	statistics.entries = 0;
+	statistics.bytes = 0;
+	for (Shard& shard : _shards)
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		statistics.entries += shard.entries.size();
+		statistics.bytes += shard.bytes;
+	}
+	return statistics;
+}
+
+momo::ResultCache::~ResultCache()
+{
+	while (true)
+	{
+		SQLite3* database;
+		{
+			std::lock_guard<std::mutex> lock(_attachmentMutex);
+			if (_attachments.empty()) break;
+			database = _attachments.front().database;
+		}
+		detach(*database);
+	}
+}
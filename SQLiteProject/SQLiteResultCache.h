@@ -0,0 +1,212 @@
+#pragma once
+
+#include "SQLite.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace momo
+{
+	/*
+	rows returned by a query, shared by all readers of a cache entry
+	*/
+	struct ResultSet
+	{
+		std::vector<std::string> columns;
+		std::vector<std::vector<Value>> rows;
+
+		/*
+		approximate memory used by the result in bytes
+		*/
+		size_t bytes = 0;
+	};
+
+	/*
+	configuration of ResultCache
+	*/
+	struct ResultCacheConfig
+	{
+		/*
+		memory budget of all cached results in bytes. Least recently used results are evicted first
+		*/
+		size_t maxBytes = 64 * 1024 * 1024;
+
+		/*
+		results larger than this size (in bytes) are not cached
+		*/
+		size_t maxResultBytes = 1024 * 1024;
+
+		/*
+		number of independently locked parts of the cache
+		*/
+		size_t shards = 16;
+
+		/*
+		maximal age of cached result, zero for no limit
+		In WAL mode cached tables are invalidated again after commit, in other journal modes a query which ran
+		while another connection was committing may cache rows read before the commit, maxAge limits their staleness
+		*/
+		std::chrono::milliseconds maxAge = std::chrono::milliseconds(1000);
+	};
+
+	/*
+	counters of ResultCache collected since it was created
+	*/
+	struct ResultCacheStatistics
+	{
+		std::uint64_t hits;
+		std::uint64_t misses;
+
+		/*
+		queries which can not be cached (not read-only, non-deterministic or executed inside write transaction)
+		*/
+		std::uint64_t bypasses;
+
+		std::uint64_t evictions;
+		std::uint64_t invalidations;
+
+		std::uint64_t entries;
+		std::uint64_t bytes;
+
+		/*
+		returns hits / (hits + misses), or 0 if there were no lookups
+		*/
+		double hitRatio() const;
+	};
+
+	/*
+	in-process cache of query results keyed by database file, normalized SQL and bound parameters.
+	Tables read by a query are collected with an authorizer (SQLite3::addAuthorizer) when it is prepared,
+	tables of different database files are cached separately.
+	Cached results are invalidated per table when attached connections commit changes to the table
+	(update, commit and WAL hooks), so every connection writing to cached tables must be attached.
+	Changes made by other processes, schema changes and changes of WITHOUT ROWID tables (not reported by update hook)
+	are not seen by the cache, call invalidate() or clear() after them.
+	Queries calling built-in non-deterministic functions (random(), date and time functions, CURRENT_TIMESTAMP, ...)
+	are not cached, user-defined non-deterministic functions are not detected.
+	Attached connections delete rows one by one, because DELETE without WHERE is not reported to update hook
+	otherwise, so it costs as much as deleting every row separately.
+
+	example:
+	ResultCache cache;
+	cache.attach(database);
+	auto result = cache.query(database, SQLBuilder<SELECT>("COMPANY").where("AGE > ?1"), { 30 });
+	*/
+	class ResultCache
+	{
+		struct Entry
+		{
+			std::string key;
+			std::shared_ptr<const ResultSet> result;
+			std::vector<std::string> tables;
+			std::chrono::steady_clock::time_point created;
+		};
+
+		struct Shard
+		{
+			std::mutex mutex;
+			std::list<Entry> entries;
+			std::unordered_map<std::string, std::list<Entry>::iterator> index;
+			std::unordered_map<std::string, std::unordered_set<std::string>> tableKeys;
+			size_t bytes = 0;
+		};
+
+		/*
+		state of authorizer callback. Tables are collected only while query is prepared
+		*/
+		struct Collector
+		{
+			std::vector<std::pair<std::string, std::string>>* tables = nullptr;
+			bool deterministic = true;
+		};
+
+		struct Attachment
+		{
+			SQLite3* database;
+			std::vector<int> hooks;
+			std::unordered_set<std::string> changedTables;
+			std::unordered_set<std::string> committedTables;
+			Collector collector;
+		};
+
+		ResultCacheConfig _config;
+		std::vector<Shard> _shards;
+		std::mutex _attachmentMutex;
+		std::list<Attachment> _attachments;
+		std::mutex _generationMutex;
+		std::unordered_map<std::string, std::uint64_t> _generations;
+		std::atomic<std::uint64_t> _hits;
+		std::atomic<std::uint64_t> _misses;
+		std::atomic<std::uint64_t> _bypasses;
+		std::atomic<std::uint64_t> _evictions;
+		std::atomic<std::uint64_t> _invalidations;
+
+		Shard& shardOf(const std::string& key);
+		std::uint64_t generation(const std::string& table);
+		void remove(Shard& shard, std::list<Entry>::iterator entry);
+		void insert(Entry entry);
+		void invalidateTable(const std::string& table);
+		static int collect(Collector& collector, int action, const char* first, const char* second, const char* database);
+
+		/*
+		returns name of table qualified with file of its database, so tables of different databases do not collide
+		*/
+		static std::string qualify(sqlite3* database, const char* schema, const std::string& table);
+		Attachment* findAttachment(SQLite3& database);
+
+		/*
+		prepares SQL collecting tables it reads, returns false if SQL can not be prepared
+		*/
+		bool prepare(SQLite3& database, const std::string& SQL, Statement& statement, std::vector<std::string>& tables, bool& cacheable);
+		std::shared_ptr<ResultSet> run(Statement& statement, const std::vector<Value>& parameters, std::string* errorMessage);
+	public:
+		/*
+		returns SQL with whitespace outside of literals collapsed and trailing semicolons removed
+		*/
+		static std::string normalize(const std::string& SQL);
+
+		ResultCache(const ResultCacheConfig& config = ResultCacheConfig());
+
+		ResultCache(const ResultCache&) = delete;
+		ResultCache& operator=(const ResultCache&) = delete;
+
+		/*
+		installs hooks which invalidate cached results when the connection commits changes
+		connection must be detached before it is destroyed
+		*/
+		void attach(SQLite3& database);
+		void detach(SQLite3& database);
+
+		/*
+		returns result of a single SQL statement with parameters ?1, ?2, ... bound to values provided,
+		from the cache if possible. Queries which are not read-only or use non-deterministic functions are executed
+		without caching, as are queries run inside explicit transaction (they may see uncommitted changes)
+		returns nullptr on failure, error message is stored to errorMessage if it is not nullptr
+		*/
+		std::shared_ptr<const ResultSet> query(SQLite3& database, const std::string& SQL, const std::vector<Value>& parameters = std::vector<Value>(), std::string* errorMessage = nullptr);
+
+		/*
+		removes cached results which read table provided, of all databases
+		*/
+		void invalidate(const std::string& table);
+
+		/*
+		removes cached results which read table provided of the database connection is opened to
+		*/
+		void invalidate(SQLite3& database, const std::string& table);
+
+		/*
+		removes all cached results
+		*/
+		void clear();
+
+		ResultCacheStatistics getStatistics();
+
+		~ResultCache();
+	};
+}
@@ -0,0 +1,242 @@
+#include "SQLiteScatterGather.h"
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <queue>
+#include <thread>
+
+struct momo::ScatterGather::Source
+{
+	std::string name;
+	SQLite3 database;
+	std::thread thread;
+	const std::atomic<bool>* stop = nullptr;
+
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::condition_variable space;
+	std::deque<std::vector<std::vector<Value>>> chunks;
+	std::vector<std::string> columns;
+	bool described = false;
+	bool done = false;
+	std::string errorMessage;
+
+	/*
+	chunk being merged and position of the head row in it, used by merging thread only
+	*/
+	std::vector<std::vector<Value>> current;
+	size_t row = 0;
+};
+
+momo::ScatterGather::ScatterGather(std::vector<std::string> databases, const ScatterGatherConfig& config)
+	: _databases(std::move(databases)), _config(config)
+{
+	if (_config.chunkRows == 0) _config.chunkRows = 1;
+	if (_config.bufferedChunks == 0) _config.bufferedChunks = 1;
+}
+
+momo::ScatterGather::ScatterGather(const ShardedDatabase& database, const ScatterGatherConfig& config)
+	: ScatterGather(std::vector<std::string>(), config)
+{
+	for (size_t i = 0; i < database.shardCount(); i++) _databases.push_back(database.shardName(i));
+}
+
+void momo::ScatterGather::produce(Source& source, const std::string& SQL, const std::vector<Value>& parameters, const ScatterGatherConfig& config)
+{
+	Statement statement;
+	bool success;
+	{
+		// connection is interrupted by merging thread under the same lock
+		std::lock_guard<std::mutex> lock(source.mutex);
+		success = !source.stop->load() && source.database.open(source.name, config.open);
+	}
+	success = success && source.database.prepare(SQL, statement);
+	std::string errorMessage = success ? std::string() : source.database.getErrorMessage();
+	if (success && !statement.bind(parameters))
+	{
+		success = false;
+		errorMessage = statement.getErrorMessage();
+	}
+	{
+		std::lock_guard<std::mutex> lock(source.mutex);
+		for (int i = 0; success && i < statement.columnCount(); i++) source.columns.push_back(statement.columnName(i));
+		source.described = true;
+	}
+	source.ready.notify_one();
+
+	if (success)
+	{
+		statement.setLimits(config.limits);
+		std::vector<std::vector<Value>> chunk;
+		int columns = statement.columnCount();
+		while (!source.stop->load() && statement.step())
+		{
+			std::vector<Value> row;
+			row.reserve(columns);
+			for (int i = 0; i < columns; i++) row.push_back(statement.column(i));
+			chunk.push_back(std::move(row));
+			if (chunk.size() < config.chunkRows) continue;
+
+			std::unique_lock<std::mutex> lock(source.mutex);
+			while (source.chunks.size() >= config.bufferedChunks && !source.stop->load()) source.space.wait(lock);
+			source.chunks.push_back(std::move(chunk));
+			lock.unlock();
+			source.ready.notify_one();
+			chunk.clear();
+		}
+		if (!statement.success() && !source.stop->load()) errorMessage = statement.getErrorMessage();
+
+		std::lock_guard<std::mutex> lock(source.mutex);
+		if (!chunk.empty()) source.chunks.push_back(std::move(chunk));
+	}
+	{
+		std::lock_guard<std::mutex> lock(source.mutex);
+		source.errorMessage = errorMessage;
+		source.done = true;
+	}
+	source.ready.notify_one();
+}
+
+bool momo::ScatterGather::next(Source& source)
+{
+	if (++source.row < source.current.size()) return true;
+
+	std::unique_lock<std::mutex> lock(source.mutex);
+	while (source.chunks.empty() && !source.done) source.ready.wait(lock);
+	source.current.clear();
+	source.row = 0;
+	if (source.chunks.empty()) return false;
+	source.current = std::move(source.chunks.front());
+	source.chunks.pop_front();
+	lock.unlock();
+	source.space.notify_one();
+	return true;
+}
+
+bool momo::ScatterGather::query(const SQLBuilder<OPERATION::SELECT>& sql, const RowVisitor& visitor)
+{
+	if (sql.limitCount() == SIZE_MAX) return query(sql, sql.orderColumns(), sql.parameters(), visitor);
+
+	// every database returns rows up to the end of the global page, which is cut from the merged rows
+	size_t count = sql.limitCount();
+	size_t offset = sql.limitOffset();
+	size_t end = count > (size_t)INT64_MAX - offset ? (size_t)INT64_MAX : count + offset;
+	SQLBuilder<OPERATION::SELECT> limited = sql;
+	limited.limit(end);
+	size_t merged = 0;
+	return query(limited, sql.orderColumns(), sql.parameters(), [&merged, count, offset, &visitor](const std::vector<Value>& row)
+	{
+		if (merged++ < offset) return true;
+		return merged - offset <= count && visitor(row) && merged - offset < count;
+	});
+}
+
+bool momo::ScatterGather::query(const std::string& SQL, const std::vector<std::pair<std::string, ORDER>>& order, const std::vector<Value>& parameters, const RowVisitor& visitor)
+{
+	_columns.clear();
+	_errorMessage.clear();
+
+	std::atomic<bool> stop(false);
+	std::vector<std::unique_ptr<Source>> sources;
+	for (const std::string& name : _databases)
+	{
+		sources.emplace_back(new Source());
+		sources.back()->name = name;
+		sources.back()->stop = &stop;
+	}
+	for (auto& source : sources)
+	{
+		Source& current = *source;
+		current.thread = std::thread([&current, &SQL, &parameters, this]() { produce(current, SQL, parameters, _config); });
+	}
+
+	// all databases must describe the same columns before rows can be compared
+	std::vector<int> keys;
+	bool success = true;
+	for (auto& source : sources)
+	{
+		std::unique_lock<std::mutex> lock(source->mutex);
+		while (!source->described) source->ready.wait(lock);
+		if (_columns.empty()) _columns = source->columns;
+	}
+	for (const auto& column : order)
+	{
+		int key = detail::findColumn(_columns, column.first);
+		if (key < 0 && !_columns.empty())
+		{
+			_errorMessage = "ORDER BY column " + column.first + " must be selected";
+			success = false;
+			break;
+		}
+		keys.push_back(key);
+	}
+
+	// exception of visitor is rethrown after producers are stopped, as joinable threads must not be destroyed
+	std::exception_ptr exception;
+	try
+	{
+		if (success)
+		{
+			// heap keeps database with the smallest head row on top, ties are broken by database index
+			auto greater = [&sources, &keys, &order](size_t left, size_t right)
+			{
+				const std::vector<Value>& a = sources[left]->current[sources[left]->row];
+				const std::vector<Value>& b = sources[right]->current[sources[right]->row];
+				for (size_t i = 0; i < keys.size(); i++)
+				{
+					int result = Value::compare(a[keys[i]], b[keys[i]]);
+					if (result != 0) return order[i].second == ORDER::ASC ? result > 0 : result < 0;
+				}
+				return left > right;
+			};
+			std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heads(greater);
+			for (size_t i = 0; i < sources.size(); i++)
+			{
+				sources[i]->row = 0;
+				if (next(*sources[i])) heads.push(i);
+			}
+			while (!heads.empty())
+			{
+				size_t top = heads.top();
+				heads.pop();
+				Source& source = *sources[top];
+				if (!visitor(source.current[source.row])) break;
+				if (next(source)) heads.push(top);
+			}
+		}
+	}
+	catch (...)
+	{
+		exception = std::current_exception();
+	}
+
+	stop = true;
+	for (auto& source : sources)
+	{
+		std::lock_guard<std::mutex> lock(source->mutex);
+		source->space.notify_all();
+		source->database.interrupt();
+	}
+	for (auto& source : sources) source->thread.join();
+	if (exception) std::rethrow_exception(exception);
+
+	for (auto& source : sources)
+	{
+		if (success && !source->errorMessage.empty())
+		{
+			_errorMessage = source->name + ": " + source->errorMessage;
+			success = false;
+		}
+	}
+	return success;
+}
+
+const std::vector<std::string>& momo::ScatterGather::columns() const
+{
+	return _columns;
+}
+
+const std::string& momo::ScatterGather::getErrorMessage() const
+{
+	return _errorMessage;
+}
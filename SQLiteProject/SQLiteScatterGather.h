@@ -0,0 +1,96 @@
+#pragma once
+
+#include "SQLiteSharding.h"
+
+namespace momo
+{
+	/*
+	function called for every merged row, returns false to stop the query
+	*/
+	using RowVisitor = std::function<bool(const std::vector<Value>& row)>;
+
+	/*
+	configuration of ScatterGather
+	*/
+	struct ScatterGatherConfig
+	{
+		/*
+		rows read by a database thread before they are passed to the merge
+		*/
+		size_t chunkRows = 256;
+
+		/*
+		chunks buffered for each database, thread waits when the merge falls behind
+		*/
+		size_t bufferedChunks = 4;
+
+		/*
+		options of connections opened by database threads
+		*/
+		OpenOptions open;
+
+		/*
+		limits applied to the statement of every database
+		*/
+		QueryLimits limits;
+	};
+
+	/*
+	runs one SELECT on several databases in parallel (one thread and connection per database) and merges results.
+	Every database returns rows sorted by the builder's orderBy() columns, merge takes the smallest head row
+	each time (k-way merge), so visitor gets globally sorted rows without sorting them on the client.
+	orderBy() columns must be among selected columns (matched by name, table qualifier is ignored)
+	and are compared as Value::compare does, so TEXT columns must use BINARY collation.
+	Without orderBy() rows of databases are passed one database after another.
+	limit() of the builder applies to merged rows: every database returns up to count + offset rows,
+	then offset rows are skipped and count rows are passed to visitor, so deep offsets read many rows per database.
+	Tables of attached databases are queried by listing their files.
+
+	example:
+	ScatterGather query(shardedDatabase);
+	query.query(SQLBuilder<SELECT>("ORDERS").where("TOTAL > 100").orderBy("ID"), [](const std::vector<Value>& row)
+	{
+		...
+		return true;
+	});
+	*/
+	class ScatterGather
+	{
+		struct Source;
+
+		std::vector<std::string> _databases;
+		ScatterGatherConfig _config;
+		std::vector<std::string> _columns;
+		std::string _errorMessage;
+
+		static void produce(Source& source, const std::string& SQL, const std::vector<Value>& parameters, const ScatterGatherConfig& config);
+		static bool next(Source& source);
+	public:
+		ScatterGather(std::vector<std::string> databases, const ScatterGatherConfig& config = ScatterGatherConfig());
+
+		/*
+		queries all shards of database provided
+		*/
+		ScatterGather(const ShardedDatabase& database, const ScatterGatherConfig& config = ScatterGatherConfig());
+
+		/*
+		runs query on all databases, calling visitor for each row in order of orderBy() columns
+		returns true on success, false on failure (see getErrorMessage()), stopping by visitor is not a failure
+		exception thrown by visitor stops the query and is rethrown
+		*/
+		bool query(const SQLBuilder<OPERATION::SELECT>& sql, const RowVisitor& visitor);
+
+		/*
+		runs SQL with parameters ?1, ?2, ... bound on all databases, merging rows by order provided
+		SQL must sort rows by the same columns
+		*/
+		bool query(const std::string& SQL, const std::vector<std::pair<std::string, ORDER>>& order, const std::vector<Value>& parameters, const RowVisitor& visitor);
+
+		/*
+		returns names of columns of the last query
+		*/
+		const std::vector<std::string>& columns() const;
+
+		const std::string& getErrorMessage() const;
+	};
+}
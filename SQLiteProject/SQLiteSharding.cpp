@@ -0,0 +1,210 @@
+#include "SQLiteSharding.h"
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const std::uint64_t FNV_OFFSET = 14695981039346656037ull;
+	const std::uint64_t FNV_PRIME = 1099511628211ull;
+
+	std::uint64_t fnv(std::uint64_t hash, const void* data, size_t size)
+	{
+		auto bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	/*
+	hashes integer byte by byte from the lowest one, so hash does not depend on byte order of the platform
+	*/
+	std::uint64_t fnv(std::uint64_t hash, std::uint64_t value)
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			hash ^= (value >> (i * 8)) & 0xFF;
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	/*
+	REAL values equal to integers are treated as integers, as SQLite compares them as equal
+	*/
+	bool isIntegral(const momo::Value& value)
+	{
+		double real = value.asReal();
+		return std::floor(real) == real && real >= -9223372036854775808.0 && real < 9223372036854775808.0;
+	}
+}
+
+std::string momo::ShardedDatabase::shardName(const std::string& name, size_t shard)
+{
+	size_t separator = name.find_last_of("/\\");
+	size_t extension = name.rfind('.');
+	if (extension == std::string::npos || (separator != std::string::npos && extension < separator) || extension == separator + 1)
+		return name + "." + std::to_string(shard);
+	return name.substr(0, extension) + "." + std::to_string(shard) + name.substr(extension);
+}
+
+std::uint64_t momo::ShardedDatabase::hash(const Value& key)
+{
+	std::uint64_t result = FNV_OFFSET;
+	switch (key.type())
+	{
+	case Value::INTEGER:
+		return fnv(fnv(result, "I", 1), (std::uint64_t)key.asInteger());
+	case Value::REAL:
+	{
+		if (isIntegral(key)) return fnv(fnv(result, "I", 1), (std::uint64_t)(sqlite3_int64)key.asReal());
+		double real = key.asReal();
+		std::uint64_t bits;
+		std::memcpy(&bits, &real, sizeof(bits));
+		return fnv(fnv(result, "R", 1), bits);
+	}
+	case Value::TEXT:
+		result = fnv(result, "T", 1);
+		return fnv(result, key.asText().data(), key.asText().size());
+	case Value::BLOB:
+		result = fnv(result, "B", 1);
+		return fnv(result, key.asText().data(), key.asText().size());
+	default:
+		return fnv(result, "N", 1);
+	}
+}
+
+momo::ShardedDatabase::ShardedDatabase(const std::string& name, const ShardingConfig& config)
+	: _config(config)
+{
+	size_t count = _config.partitioning == RANGE_PARTITIONING ? _config.rangeBounds.size() + 1 : _config.shards;
+	if (count == 0) count = 1;
+	for (size_t i = 0; i < count; i++)
+	{
+		_names.push_back(shardName(name, i));
+		_shards.emplace_back(new WriteQueue(_names.back(), _config.writeQueue));
+	}
+}
+
+bool momo::ShardedDatabase::start()
+{
+	for (size_t i = 0; i < _shards.size(); i++)
+	{
+		if (!_shards[i]->start())
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_errorMessage = _names[i] + ": " + _shards[i]->getErrorMessage();
+			for (size_t j = 0; j < i; j++) _shards[j]->stop();
+			return false;
+		}
+	}
+	return true;
+}
+
+void momo::ShardedDatabase::stop()
+{
+	for (auto& shard : _shards) shard->stop();
+}
+
+size_t momo::ShardedDatabase::shardCount() const
+{
+	return _shards.size();
+}
+
+size_t momo::ShardedDatabase::shardOf(const Value& key) const
+{
+	if (_config.partitioning == RANGE_PARTITIONING)
+	{
+		// first shard whose upper bound is above the key
+		size_t low = 0, high = _config.rangeBounds.size();
+		while (low < high)
+		{
+			size_t middle = (low + high) / 2;
+			if (Value::compare(key, _config.rangeBounds[middle]) < 0) high = middle;
+			else low = middle + 1;
+		}
+		return low;
+	}
+	return (size_t)(hash(key) % _shards.size());
+}
+
+const std::string& momo::ShardedDatabase::shardName(size_t shard) const
+{
+	return _names[shard];
+}
+
+std::future<bool> momo::ShardedDatabase::execute(const Value& key, std::string SQL, std::vector<Value> parameters)
+{
+	return _shards[shardOf(key)]->submit(std::move(SQL), std::move(parameters));
+}
+
+std::future<bool> momo::ShardedDatabase::insert(const Value& key, const SQLBuilder<OPERATION::INSERT>& sql)
+{
+	if (sql.rowCount() > 1)
+	{
+		// rows of other keys would be written to the shard of this one
+		std::lock_guard<std::mutex> lock(_mutex);
+		_errorMessage = "insert of " + std::to_string(sql.rowCount()) + " rows under one key, rows must be inserted one by one";
+		std::promise<bool> rejected;
+		rejected.set_value(false);
+		return rejected.get_future();
+	}
+	return _shards[shardOf(key)]->submit(sql);
+}
+
+std::future<bool> momo::ShardedDatabase::remove(const Value& key, const SQLBuilder<OPERATION::DELETE>& sql)
+{
+	return _shards[shardOf(key)]->submit(sql);
+}
+
+std::future<bool> momo::ShardedDatabase::all(std::vector<std::future<bool>> results)
+{
+	// real promise, so wait_for() of the result reports ready instead of deferred
+	auto promise = std::make_shared<std::promise<bool>>();
+	std::future<bool> result = promise->get_future();
+	std::thread([promise](std::vector<std::future<bool>> results)
+	{
+		bool success = true;
+		for (auto& result : results) success = result.get() && success;
+		promise->set_value(success);
+	}, std::move(results)).detach();
+	return result;
+}
+
+std::future<bool> momo::ShardedDatabase::broadcast(std::string SQL)
+{
+	std::vector<std::future<bool>> results;
+	for (auto& shard : _shards) results.push_back(shard->submit(SQL));
+	return all(std::move(results));
+}
+
+std::future<bool> momo::ShardedDatabase::remove(const SQLBuilder<OPERATION::DELETE>& sql)
+{
+	std::vector<std::future<bool>> results;
+	for (auto& shard : _shards) results.push_back(shard->submit(sql));
+	return all(std::move(results));
+}
+
+momo::WriteQueueStatistics momo::ShardedDatabase::getStatistics(size_t shard) const
+{
+	return _shards[shard]->getStatistics();
+}
+
+std::string momo::ShardedDatabase::getErrorMessage() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_errorMessage.empty()) return _errorMessage;
+	for (size_t i = 0; i < _shards.size(); i++)
+	{
+		std::string message = _shards[i]->getErrorMessage();
+		if (!message.empty()) return _names[i] + ": " + message;
+	}
+	return std::string();
+}
+
+momo::ShardedDatabase::~ShardedDatabase()
+{
+	stop();
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "SQLiteWriteQueue.h"
+#include <memory>
+
+namespace momo
+{
+	/*
+	enum of ways ShardedDatabase maps keys to shards
+	*/
+	enum PARTITIONING
+	{
+		/*
+		shard is chosen by stable hash of the key, spreading keys evenly
+		*/
+		HASH_PARTITIONING,
+
+		/*
+		shard is chosen by sorted bounds of key ranges, keeping neighbouring keys together
+		*/
+		RANGE_PARTITIONING,
+	};
+
+	/*
+	configuration of ShardedDatabase
+	*/
+	struct ShardingConfig
+	{
+		PARTITIONING partitioning = HASH_PARTITIONING;
+
+		/*
+		number of shards for HASH_PARTITIONING
+		*/
+		size_t shards = 4;
+
+		/*
+		sorted upper bounds (exclusive) of all shards but the last one for RANGE_PARTITIONING,
+		keys are compared as in SQLite (see Value::compare)
+		example: { 1000, 2000 } makes 3 shards: keys below 1000, keys from 1000 to 1999 and keys from 2000
+		*/
+		std::vector<Value> rangeBounds;
+
+		/*
+		configuration of writer of each shard
+		*/
+		WriteQueueConfig writeQueue;
+	};
+
+	/*
+	database partitioned by key over several files, so writers of different shards do not share a file lock.
+	Every shard is a separate database file written by its own WriteQueue (with its own writer thread),
+	statements are sent to the shard owning the key provided with them. Files are named after the database
+	with shard number inserted before extension: "orders.db" is split into "orders.0.db", "orders.1.db", ...
+	Shards can be read with connections opened to shardName().
+	Transactions span one shard only, and number of shards or range bounds must not change for existing files.
+
+	example:
+	ShardedDatabase database("orders.db");
+	database.start();
+	database.broadcast(SQLBuilder<CREATE>("ORDERS").addColumn("ID", INT, NOT_NULL, PRIMARY_KEY)).get();
+	database.insert(42, SQLBuilder<INSERT>("ORDERS", "ID").addValues("42"));
+	*/
+	class ShardedDatabase
+	{
+		ShardingConfig _config;
+		std::vector<std::string> _names;
+		std::vector<std::unique_ptr<WriteQueue>> _shards;
+		mutable std::mutex _mutex;
+		std::string _errorMessage;
+
+		/*
+		returns future completed by a detached thread with true when all futures provided are true
+		*/
+		static std::future<bool> all(std::vector<std::future<bool>> results);
+	public:
+		/*
+		returns name of file of shard provided
+		*/
+		static std::string shardName(const std::string& name, size_t shard);
+
+		/*
+		returns stable hash of value used by HASH_PARTITIONING
+		*/
+		static std::uint64_t hash(const Value& key);
+
+		ShardedDatabase(const std::string& name, const ShardingConfig& config = ShardingConfig());
+
+		ShardedDatabase(const ShardedDatabase&) = delete;
+		ShardedDatabase& operator=(const ShardedDatabase&) = delete;
+
+		/*
+		opens all shards and starts their writers
+		returns true on success, false on failure (see getErrorMessage())
+		*/
+		bool start();
+
+		/*
+		commits submitted statements and stops writers of all shards
+		automatically called in the destructor
+		*/
+		void stop();
+
+		size_t shardCount() const;
+
+		/*
+		returns index of shard which owns key provided
+		*/
+		size_t shardOf(const Value& key) const;
+
+		/*
+		returns name of database file of shard provided
+		*/
+		const std::string& shardName(size_t shard) const;
+
+		/*
+		submits statement to the shard owning key, returns future completed with true when statement is committed
+		*/
+		std::future<bool> execute(const Value& key, std::string SQL, std::vector<Value> parameters = std::vector<Value>());
+
+		/*
+		submits insert of one row to the shard owning key,
+		builders of several rows are rejected with false (see getErrorMessage()), as rows may belong to other shards
+		*/
+		std::future<bool> insert(const Value& key, const SQLBuilder<OPERATION::INSERT>& sql);
+		std::future<bool> remove(const Value& key, const SQLBuilder<OPERATION::DELETE>& sql);
+
+		/*
+		submits statement to every shard (e.g. CREATE TABLE or DELETE without key),
+		returns future completed with true when statement is committed on all shards
+		*/
+		std::future<bool> broadcast(std::string SQL);
+		std::future<bool> remove(const SQLBuilder<OPERATION::DELETE>& sql);
+
+		/*
+		returns statistics of writer of shard provided
+		*/
+		WriteQueueStatistics getStatistics(size_t shard) const;
+
+		std::string getErrorMessage() const;
+
+		~ShardedDatabase();
+	};
+}
@@ -0,0 +1,112 @@
+#include "SQLiteSnapshot.h"
+
+momo::Snapshot::Snapshot()
+	: _snapshot(nullptr), _holder(nullptr)
+{
+
+}
+
+bool momo::Snapshot::fail(const std::string& message)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_errorMessage = message;
+	return false;
+}
+
+bool momo::Snapshot::isValid() const
+{
+	return _snapshot != nullptr;
+}
+
+std::string momo::Snapshot::getErrorMessage() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _errorMessage;
+}
+
+momo::Snapshot::~Snapshot()
+{
+	release();
+}
+
+#if defined(SQLITE_ENABLE_SNAPSHOT)
+
+bool momo::Snapshot::take(SQLite3& database, const std::string& schema)
+{
+	release();
+	if (database.handle() == nullptr) return fail("database is not opened");
+
+	if (sqlite3_get_autocommit(database.handle()))
+	{
+		// snapshot can be taken only inside read transaction
+		if (!database.execute("BEGIN; PRAGMA " + schema + ".schema_version;")) return fail(database.getErrorMessage());
+		_holder = &database;
+	}
+	int result = sqlite3_snapshot_get(database.handle(), schema.c_str(), &_snapshot);
+	if (result != SQLITE_OK)
+	{
+		_snapshot = nullptr;
+		release();
+		return fail(std::string("failed to take snapshot (database must be in WAL mode): ") + sqlite3_errstr(result));
+	}
+	_schema = schema;
+	return true;
+}
+
+bool momo::Snapshot::open(SQLite3& connection)
+{
+	if (_snapshot == nullptr) return fail("snapshot is not taken");
+	if (connection.handle() == nullptr) return fail("connection is not opened");
+	if (!sqlite3_get_autocommit(connection.handle())) return fail("connection is inside transaction");
+
+	if (!connection.execute("BEGIN;")) return fail(connection.getErrorMessage());
+	int result = sqlite3_snapshot_open(connection.handle(), _schema.c_str(), _snapshot);
+	if (result != SQLITE_OK)
+	{
+		connection.execute("ROLLBACK;");
+		return fail(std::string("failed to open snapshot: ") + sqlite3_errstr(result));
+	}
+	return true;
+}
+
+int momo::Snapshot::compare(const Snapshot& other) const
+{
+	return sqlite3_snapshot_cmp(_snapshot, other._snapshot);
+}
+
+void momo::Snapshot::release()
+{
+	if (_snapshot != nullptr) sqlite3_snapshot_free(_snapshot);
+	_snapshot = nullptr;
+	if (_holder != nullptr && _holder->handle() != nullptr && !sqlite3_get_autocommit(_holder->handle())) _holder->execute("COMMIT;");
+	_holder = nullptr;
+}
+
+#else
+
+bool momo::Snapshot::take(SQLite3&, const std::string&)
+{
+	return fail("snapshots are not available, SQLITE_ENABLE_SNAPSHOT must be defined");
+}
+
+bool momo::Snapshot::open(SQLite3&)
+{
+	return fail("snapshot is not taken");
+}
+
+int momo::Snapshot::compare(const Snapshot&) const
+{
+	return 0;
+}
+
+void momo::Snapshot::release()
+{
+
+}
+
+#endif
+
+void momo::Snapshot::close(SQLite3& connection)
+{
+	if (connection.handle() != nullptr && !sqlite3_get_autocommit(connection.handle())) connection.execute("COMMIT;");
+}
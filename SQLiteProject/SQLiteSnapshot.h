@@ -0,0 +1,80 @@
+#pragma once
+
+#include "SQLite.h"
+#include <mutex>
+
+namespace momo
+{
+	/*
+	historical version of WAL database which several connections can read at once (sqlite3_snapshot).
+	Snapshot is taken from a connection with read transaction, and every connection opened with open()
+	starts its read transaction at the same version, so parallel readers see consistent data.
+	If the connection had no transaction, take() starts one and keeps it until release(), so checkpoints
+	can not overwrite pages of the snapshot. That connection must not write while snapshot is held.
+	open() and close() can be called from several threads for different connections.
+	Requires SQLite and wrapper compiled with SQLITE_ENABLE_SNAPSHOT, take() fails otherwise.
+
+	example:
+	Snapshot snapshot;
+	snapshot.take(database);
+	snapshot.open(reader1);
+	snapshot.open(reader2);
+	... // readers see the same data
+	snapshot.close(reader1);
+	snapshot.close(reader2);
+	snapshot.release();
+	*/
+	class Snapshot
+	{
+		sqlite3_snapshot* _snapshot;
+		SQLite3* _holder;
+		std::string _schema;
+		mutable std::mutex _mutex;
+		std::string _errorMessage;
+
+		bool fail(const std::string& message);
+	public:
+		Snapshot();
+
+		Snapshot(const Snapshot&) = delete;
+		Snapshot& operator=(const Snapshot&) = delete;
+
+		/*
+		records current version of schema (database name) seen by connection provided, releasing previous snapshot
+		returns true on success, false on failure (see getErrorMessage())
+		*/
+		bool take(SQLite3& database, const std::string& schema = "main");
+
+		/*
+		returns true if snapshot was taken and not released, false either
+		*/
+		bool isValid() const;
+
+		/*
+		starts read transaction of connection at the snapshot. Connection must not be inside transaction
+		returns true on success, false on failure (e.g. if WAL was reset since snapshot was taken)
+		*/
+		bool open(SQLite3& connection);
+
+		/*
+		ends read transaction started by open()
+		*/
+		void close(SQLite3& connection);
+
+		/*
+		returns negative number if this snapshot is older than other one, zero if they are the same and positive number either
+		both snapshots must be valid and taken from the same database
+		*/
+		int compare(const Snapshot& other) const;
+
+		/*
+		frees snapshot and ends read transaction started by take()
+		automatically called in the destructor
+		*/
+		void release();
+
+		std::string getErrorMessage() const;
+
+		~Snapshot();
+	};
+}
@@ -0,0 +1,715 @@
+#include "SQLiteVFS.h"
+
+const char* const momo::URING_VFS = "momo-uring";
+
+#if defined(__linux__)
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace
+{
+	/*
+	minimal io_uring submission / completion ring used by a single database file
+	*/
+	class Ring
+	{
+		int _fd;
+		void* _sqRing;
+		size_t _sqRingSize;
+		void* _cqRing;
+		size_t _cqRingSize;
+		io_uring_sqe* _sqes;
+		size_t _sqesSize;
+		unsigned* _sqTail;
+		unsigned* _sqMask;
+		unsigned* _sqArray;
+		unsigned* _cqHead;
+		unsigned* _cqTail;
+		unsigned* _cqMask;
+		io_uring_cqe* _cqes;
+	public:
+		Ring()
+			: _fd(-1), _sqRing(MAP_FAILED), _sqRingSize(0), _cqRing(MAP_FAILED), _cqRingSize(0), _sqes(nullptr), _sqesSize(0)
+		{
+
+		}
+
+		Ring(const Ring&) = delete;
+		Ring& operator=(const Ring&) = delete;
+
+		bool init(unsigned entries)
+		{
+			io_uring_params params;
+			memset(&params, 0, sizeof(params));
+			_fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+			if (_fd < 0) return false;
+
+			_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+			_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+			if (singleMap && _cqRingSize > _sqRingSize) _sqRingSize = _cqRingSize;
+
+			_sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+			if (_sqRing == MAP_FAILED) return false;
+			if (singleMap)
+			{
+				_cqRing = _sqRing;
+			}
+			else
+			{
+				_cqRing = mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+				if (_cqRing == MAP_FAILED) return false;
+			}
+			_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+			void* sqes = mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+			if (sqes == MAP_FAILED) return false;
+			_sqes = static_cast<io_uring_sqe*>(sqes);
+
+			char* sq = static_cast<char*>(_sqRing);
+			_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+			_sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+			_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+			char* cq = static_cast<char*>(_cqRing);
+			_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+			_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+			_cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+			_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+			return true;
+		}
+
+		/*
+		queues read of iov->iov_len bytes at offset into iov->iov_base and submits it to the kernel
+		iov must stay alive until completion with the same tag is returned by wait()
+		*/
+		bool submitRead(int fd, iovec* iov, sqlite3_int64 offset, std::uint64_t tag)
+		{
+			unsigned tail = *_sqTail;
+			unsigned index = tail & *_sqMask;
+			io_uring_sqe* sqe = &_sqes[index];
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = IORING_OP_READV;
+			sqe->fd = fd;
+			sqe->addr = reinterpret_cast<std::uint64_t>(iov);
+			sqe->len = 1;
+			sqe->off = (std::uint64_t)offset;
+			sqe->user_data = tag;
+			_sqArray[index] = index;
+			__atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+			while (syscall(__NR_io_uring_enter, _fd, 1, 0, 0, nullptr, 0) < 0)
+			{
+				if (errno != EINTR && errno != EAGAIN) return false;
+			}
+			return true;
+		}
+
+		/*
+		waits for one completion and returns its tag and result (bytes read or -errno)
+		*/
+		bool wait(std::uint64_t& tag, int& result)
+		{
+			for (;;)
+			{
+				unsigned head = *_cqHead;
+				if (head != __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE))
+				{
+					const io_uring_cqe& cqe = _cqes[head & *_cqMask];
+					tag = cqe.user_data;
+					result = cqe.res;
+					__atomic_store_n(_cqHead, head + 1, __ATOMIC_RELEASE);
+					return true;
+				}
+				if (syscall(__NR_io_uring_enter, _fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR)
+					return false;
+			}
+		}
+
+		~Ring()
+		{
+			if (_sqes != nullptr) munmap(_sqes, _sqesSize);
+			if (_cqRing != MAP_FAILED && _cqRing != _sqRing) munmap(_cqRing, _cqRingSize);
+			if (_sqRing != MAP_FAILED) munmap(_sqRing, _sqRingSize);
+			if (_fd >= 0) close(_fd);
+		}
+	};
+
+	/*
+	read-only descriptors shared by all connections to the same database file
+	descriptor is never closed while another shim file on the same inode is open,
+	because closing any descriptor releases POSIX locks held by the process
+	*/
+	class DescriptorRegistry
+	{
+		struct Entry
+		{
+			int fd;
+			int references;
+		};
+		std::mutex _mutex;
+		std::map<std::pair<dev_t, ino_t>, Entry> _entries;
+	public:
+		int acquire(const char* path)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			struct stat info;
+			if (stat(path, &info) != 0) return -1;
+			auto key = std::make_pair(info.st_dev, info.st_ino);
+			auto it = _entries.find(key);
+			if (it != _entries.end())
+			{
+				it->second.references++;
+				return it->second.fd;
+			}
+			int fd = open(path, O_RDONLY | O_CLOEXEC);
+			if (fd < 0) return -1;
+			_entries[key] = Entry{ fd, 1 };
+			return fd;
+		}
+
+		void release(int fd)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			for (auto it = _entries.begin(); it != _entries.end(); ++it)
+			{
+				if (it->second.fd != fd) continue;
+				if (--it->second.references == 0)
+				{
+					close(fd);
+					_entries.erase(it);
+				}
+				return;
+			}
+		}
+	};
+
+	DescriptorRegistry& descriptors()
+	{
+		// never destroyed: files may be closed by static destructors of other objects
+		static DescriptorRegistry* registry = new DescriptorRegistry();
+		return *registry;
+	}
+
+	momo::UringConfig uringConfig;
+	sqlite3_vfs uringVfs;
+
+	/*
+	tag of completions which belong to synchronous reads, windows use their index as tag
+	*/
+	const std::uint64_t SYNC_READ = 2;
+
+	/*
+	read-ahead buffer covering [offset, offset + readAheadSize) of database file
+	window with start S lives in slot (S / readAheadSize) % 2, so two consecutive windows never share a slot
+	*/
+	struct Window
+	{
+		char* buffer;
+		iovec iov;
+		sqlite3_int64 offset;
+		int length;
+		bool pending;
+		bool ready;
+	};
+
+	/*
+	io_uring state of main database file
+	*/
+	struct UringState
+	{
+		Ring ring;
+		int fd;
+		Window windows[2];
+		sqlite3_int64 lastEnd;
+		int sequentialReads;
+	};
+
+	/*
+	file opened by the shim. Real file of default VFS is stored right after this struct
+	*/
+	struct UringFile
+	{
+		sqlite3_file base;
+		sqlite3_file* real;
+		UringState* state;
+	};
+
+	sqlite3_vfs* rootVfs()
+	{
+		return static_cast<sqlite3_vfs*>(uringVfs.pAppData);
+	}
+
+	sqlite3_file* realFile(sqlite3_file* file)
+	{
+		return reinterpret_cast<UringFile*>(file)->real;
+	}
+
+	/*
+	stores completion in the window it belongs to
+	*/
+	void completeWindow(UringState* state, std::uint64_t tag, int result)
+	{
+		if (tag >= 2) return;
+		Window& window = state->windows[tag];
+		window.pending = false;
+		window.ready = result >= 0;
+		window.length = result >= 0 ? result : 0;
+	}
+
+	/*
+	waits until window has no read in flight
+	*/
+	bool waitWindow(UringState* state, Window& window)
+	{
+		while (window.pending)
+		{
+			std::uint64_t tag;
+			int result;
+			if (!state->ring.wait(tag, result))
+			{
+				window.pending = false;
+				window.ready = false;
+				return false;
+			}
+			completeWindow(state, tag, result);
+		}
+		return true;
+	}
+
+	/*
+	drops read-ahead data, called when file may have been changed
+	*/
+	void invalidate(UringState* state)
+	{
+		if (state == nullptr) return;
+		for (auto& window : state->windows)
+		{
+			waitWindow(state, window);
+			window.ready = false;
+		}
+		state->sequentialReads = 0;
+	}
+
+	/*
+	starts asynchronous read of window beginning at offset, unless it is already read
+	*/
+	void readAhead(UringState* state, sqlite3_int64 offset)
+	{
+		sqlite3_int64 size = (sqlite3_int64)uringConfig.readAheadSize;
+		int slot = (int)((offset / size) % 2);
+		Window& window = state->windows[slot];
+		if ((window.pending || window.ready) && window.offset == offset) return;
+		if (!waitWindow(state, window)) return;
+
+		window.offset = offset;
+		window.ready = false;
+		window.iov.iov_base = window.buffer;
+		window.iov.iov_len = uringConfig.readAheadSize;
+		window.pending = state->ring.submitRead(state->fd, &window.iov, offset, (std::uint64_t)slot);
+	}
+
+	/*
+	copies [offset, offset + amount) from read-ahead window if it is fully there
+	*/
+	bool readFromWindow(UringState* state, void* buffer, int amount, sqlite3_int64 offset)
+	{
+		for (auto& window : state->windows)
+		{
+			if (!window.pending && !window.ready) continue;
+			if (offset < window.offset || offset + amount > window.offset + (sqlite3_int64)uringConfig.readAheadSize) continue;
+			if (!waitWindow(state, window) || !window.ready) return false;
+			if (offset + amount > window.offset + window.length) return false;
+			memcpy(buffer, window.buffer + (offset - window.offset), amount);
+			return true;
+		}
+		return false;
+	}
+
+	/*
+	reads through the ring and waits for result
+	returns number of bytes read (less than amount at the end of file) or -1 on error
+	*/
+	int readSync(UringState* state, void* buffer, int amount, sqlite3_int64 offset)
+	{
+		int total = 0;
+		while (total < amount)
+		{
+			iovec iov;
+			iov.iov_base = static_cast<char*>(buffer) + total;
+			iov.iov_len = (size_t)(amount - total);
+			if (!state->ring.submitRead(state->fd, &iov, offset + total, SYNC_READ)) return -1;
+
+			int result = 0;
+			for (;;)
+			{
+				std::uint64_t tag;
+				if (!state->ring.wait(tag, result)) return -1;
+				if (tag == SYNC_READ) break;
+				completeWindow(state, tag, result);
+			}
+			if (result == -EINTR || result == -EAGAIN) continue;
+			if (result < 0) return -1;
+			if (result == 0) break;
+			total += result;
+		}
+		return total;
+	}
+
+	int uringClose(sqlite3_file* file)
+	{
+		auto uringFile = reinterpret_cast<UringFile*>(file);
+		if (uringFile->state != nullptr)
+		{
+			invalidate(uringFile->state);
+			descriptors().release(uringFile->state->fd);
+			for (auto& window : uringFile->state->windows) sqlite3_free(window.buffer);
+			delete uringFile->state;
+			uringFile->state = nullptr;
+		}
+		return uringFile->real->pMethods->xClose(uringFile->real);
+	}
+
+	int uringRead(sqlite3_file* file, void* buffer, int amount, sqlite3_int64 offset)
+	{
+		auto uringFile = reinterpret_cast<UringFile*>(file);
+		UringState* state = uringFile->state;
+		if (state == nullptr)
+			return uringFile->real->pMethods->xRead(uringFile->real, buffer, amount, offset);
+
+		state->sequentialReads = (offset == state->lastEnd) ? state->sequentialReads + 1 : 0;
+		state->lastEnd = offset + amount;
+
+		if (!readFromWindow(state, buffer, amount, offset))
+		{
+			int read = readSync(state, buffer, amount, offset);
+			if (read < 0) return SQLITE_IOERR_READ;
+			if (read < amount)
+			{
+				// SQLite requires unread part of the buffer to be zero-filled
+				memset(static_cast<char*>(buffer) + read, 0, amount - read);
+				return SQLITE_IOERR_SHORT_READ;
+			}
+		}
+
+		if (state->sequentialReads >= uringConfig.sequentialThreshold)
+		{
+			sqlite3_int64 size = (sqlite3_int64)uringConfig.readAheadSize;
+			sqlite3_int64 next = state->lastEnd - state->lastEnd % size;
+			readAhead(state, next);
+			readAhead(state, next + size);
+		}
+		return SQLITE_OK;
+	}
+
+	int uringWrite(sqlite3_file* file, const void* buffer, int amount, sqlite3_int64 offset)
+	{
+		invalidate(reinterpret_cast<UringFile*>(file)->state);
+		return realFile(file)->pMethods->xWrite(realFile(file), buffer, amount, offset);
+	}
+
+	int uringTruncate(sqlite3_file* file, sqlite3_int64 size)
+	{
+		invalidate(reinterpret_cast<UringFile*>(file)->state);
+		return realFile(file)->pMethods->xTruncate(realFile(file), size);
+	}
+
+	int uringSync(sqlite3_file* file, int flags)
+	{
+		return realFile(file)->pMethods->xSync(realFile(file), flags);
+	}
+
+	int uringFileSize(sqlite3_file* file, sqlite3_int64* size)
+	{
+		return realFile(file)->pMethods->xFileSize(realFile(file), size);
+	}
+
+	/*
+	other connections may change the file between transactions, so read-ahead data is dropped on lock changes
+	*/
+	int uringLock(sqlite3_file* file, int lock)
+	{
+		invalidate(reinterpret_cast<UringFile*>(file)->state);
+		return realFile(file)->pMethods->xLock(realFile(file), lock);
+	}
+
+	int uringUnlock(sqlite3_file* file, int lock)
+	{
+		invalidate(reinterpret_cast<UringFile*>(file)->state);
+		return realFile(file)->pMethods->xUnlock(realFile(file), lock);
+	}
+
+	int uringCheckReservedLock(sqlite3_file* file, int* result)
+	{
+		return realFile(file)->pMethods->xCheckReservedLock(realFile(file), result);
+	}
+
+	int uringFileControl(sqlite3_file* file, int op, void* arg)
+	{
+		return realFile(file)->pMethods->xFileControl(realFile(file), op, arg);
+	}
+
+	int uringSectorSize(sqlite3_file* file)
+	{
+		return realFile(file)->pMethods->xSectorSize(realFile(file));
+	}
+
+	int uringDeviceCharacteristics(sqlite3_file* file)
+	{
+		return realFile(file)->pMethods->xDeviceCharacteristics(realFile(file));
+	}
+
+	int uringShmMap(sqlite3_file* file, int region, int size, int extend, void volatile** memory)
+	{
+		return realFile(file)->pMethods->xShmMap(realFile(file), region, size, extend, memory);
+	}
+
+	/*
+	in WAL mode read transactions start by locking WAL-index, so read-ahead data is dropped here as well
+	*/
+	int uringShmLock(sqlite3_file* file, int offset, int count, int flags)
+	{
+		invalidate(reinterpret_cast<UringFile*>(file)->state);
+		return realFile(file)->pMethods->xShmLock(realFile(file), offset, count, flags);
+	}
+
+	void uringShmBarrier(sqlite3_file* file)
+	{
+		realFile(file)->pMethods->xShmBarrier(realFile(file));
+	}
+
+	int uringShmUnmap(sqlite3_file* file, int deleteFlag)
+	{
+		return realFile(file)->pMethods->xShmUnmap(realFile(file), deleteFlag);
+	}
+
+	int uringFetch(sqlite3_file* file, sqlite3_int64 offset, int amount, void** pointer)
+	{
+		return realFile(file)->pMethods->xFetch(realFile(file), offset, amount, pointer);
+	}
+
+	int uringUnfetch(sqlite3_file* file, sqlite3_int64 offset, void* pointer)
+	{
+		return realFile(file)->pMethods->xUnfetch(realFile(file), offset, pointer);
+	}
+
+	/*
+	methods for each version of real file methods, so SQLite never calls missing ones
+	*/
+	sqlite3_io_methods uringMethods[3];
+
+	void initMethods()
+	{
+		for (int version = 1; version <= 3; version++)
+		{
+			sqlite3_io_methods& methods = uringMethods[version - 1];
+			memset(&methods, 0, sizeof(methods));
+			methods.iVersion = version;
+			methods.xClose = uringClose;
+			methods.xRead = uringRead;
+			methods.xWrite = uringWrite;
+			methods.xTruncate = uringTruncate;
+			methods.xSync = uringSync;
+			methods.xFileSize = uringFileSize;
+			methods.xLock = uringLock;
+			methods.xUnlock = uringUnlock;
+			methods.xCheckReservedLock = uringCheckReservedLock;
+			methods.xFileControl = uringFileControl;
+			methods.xSectorSize = uringSectorSize;
+			methods.xDeviceCharacteristics = uringDeviceCharacteristics;
+			if (version >= 2)
+			{
+				methods.xShmMap = uringShmMap;
+				methods.xShmLock = uringShmLock;
+				methods.xShmBarrier = uringShmBarrier;
+				methods.xShmUnmap = uringShmUnmap;
+			}
+			if (version >= 3)
+			{
+				methods.xFetch = uringFetch;
+				methods.xUnfetch = uringUnfetch;
+			}
+		}
+	}
+
+	/*
+	creates io_uring state for main database file
+	returns nullptr if it can not be created, so file falls back to default reads
+	*/
+	UringState* createState(const char* path)
+	{
+		int fd = descriptors().acquire(path);
+		if (fd < 0) return nullptr;
+
+		UringState* state = new UringState();
+		state->fd = fd;
+		state->lastEnd = -1;
+		state->sequentialReads = 0;
+		bool allocated = true;
+		for (auto& window : state->windows)
+		{
+			window.buffer = static_cast<char*>(sqlite3_malloc64(uringConfig.readAheadSize));
+			window.offset = -1;
+			window.length = 0;
+			window.pending = false;
+			window.ready = false;
+			allocated = allocated && window.buffer != nullptr;
+		}
+		// queue holds two read-ahead windows and one synchronous read
+		if (!allocated || !state->ring.init(4))
+		{
+			for (auto& window : state->windows) sqlite3_free(window.buffer);
+			descriptors().release(fd);
+			delete state;
+			return nullptr;
+		}
+		return state;
+	}
+
+	int uringOpen(sqlite3_vfs*, const char* name, sqlite3_file* file, int flags, int* outFlags)
+	{
+		auto uringFile = reinterpret_cast<UringFile*>(file);
+		uringFile->real = reinterpret_cast<sqlite3_file*>(uringFile + 1);
+		uringFile->state = nullptr;
+
+		int code = rootVfs()->xOpen(rootVfs(), name, uringFile->real, flags, outFlags);
+		if (code != SQLITE_OK || uringFile->real->pMethods == nullptr)
+		{
+			file->pMethods = nullptr;
+			return code;
+		}
+		int version = uringFile->real->pMethods->iVersion;
+		file->pMethods = &uringMethods[(version < 1 ? 1 : (version > 3 ? 3 : version)) - 1];
+
+		if ((flags & SQLITE_OPEN_MAIN_DB) && name != nullptr)
+		{
+			uringFile->state = createState(name);
+		}
+		return SQLITE_OK;
+	}
+
+	int uringDelete(sqlite3_vfs*, const char* name, int syncDir)
+	{
+		return rootVfs()->xDelete(rootVfs(), name, syncDir);
+	}
+
+	int uringAccess(sqlite3_vfs*, const char* name, int flags, int* result)
+	{
+		return rootVfs()->xAccess(rootVfs(), name, flags, result);
+	}
+
+	int uringFullPathname(sqlite3_vfs*, const char* name, int size, char* output)
+	{
+		return rootVfs()->xFullPathname(rootVfs(), name, size, output);
+	}
+
+	void* uringDlOpen(sqlite3_vfs*, const char* name)
+	{
+		return rootVfs()->xDlOpen(rootVfs(), name);
+	}
+
+	void uringDlError(sqlite3_vfs*, int size, char* message)
+	{
+		rootVfs()->xDlError(rootVfs(), size, message);
+	}
+
+	void (*uringDlSym(sqlite3_vfs*, void* handle, const char* symbol))(void)
+	{
+		return rootVfs()->xDlSym(rootVfs(), handle, symbol);
+	}
+
+	void uringDlClose(sqlite3_vfs*, void* handle)
+	{
+		rootVfs()->xDlClose(rootVfs(), handle);
+	}
+
+	int uringRandomness(sqlite3_vfs*, int size, char* output)
+	{
+		return rootVfs()->xRandomness(rootVfs(), size, output);
+	}
+
+	int uringSleep(sqlite3_vfs*, int microseconds)
+	{
+		return rootVfs()->xSleep(rootVfs(), microseconds);
+	}
+
+	int uringCurrentTime(sqlite3_vfs*, double* time)
+	{
+		return rootVfs()->xCurrentTime(rootVfs(), time);
+	}
+
+	int uringGetLastError(sqlite3_vfs*, int size, char* message)
+	{
+		return rootVfs()->xGetLastError(rootVfs(), size, message);
+	}
+
+	int uringCurrentTimeInt64(sqlite3_vfs*, sqlite3_int64* time)
+	{
+		return rootVfs()->xCurrentTimeInt64(rootVfs(), time);
+	}
+
+	/*
+	checks that kernel supports io_uring
+	*/
+	bool uringAvailable()
+	{
+		Ring ring;
+		return ring.init(1);
+	}
+}
+
+bool momo::registerUringVFS(const UringConfig& config)
+{
+	static std::mutex mutex;
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (sqlite3_initialize() != SQLITE_OK) return false;
+	if (sqlite3_vfs_find(URING_VFS) != nullptr)
+		return sqlite3_vfs_register(&uringVfs, config.makeDefault ? 1 : 0) == SQLITE_OK;
+
+	sqlite3_vfs* root = sqlite3_vfs_find(nullptr);
+	if (root == nullptr || config.readAheadSize == 0 || !uringAvailable()) return false;
+
+	uringConfig = config;
+	initMethods();
+	memset(&uringVfs, 0, sizeof(uringVfs));
+	uringVfs.iVersion = root->iVersion < 2 ? root->iVersion : 2;
+	uringVfs.szOsFile = (int)sizeof(UringFile) + root->szOsFile;
+	uringVfs.mxPathname = root->mxPathname;
+	uringVfs.zName = URING_VFS;
+	uringVfs.pAppData = root;
+	uringVfs.xOpen = uringOpen;
+	uringVfs.xDelete = uringDelete;
+	uringVfs.xAccess = uringAccess;
+	uringVfs.xFullPathname = uringFullPathname;
+	uringVfs.xDlOpen = root->xDlOpen ? uringDlOpen : nullptr;
+	uringVfs.xDlError = root->xDlError ? uringDlError : nullptr;
+	uringVfs.xDlSym = root->xDlSym ? uringDlSym : nullptr;
+	uringVfs.xDlClose = root->xDlClose ? uringDlClose : nullptr;
+	uringVfs.xRandomness = uringRandomness;
+	uringVfs.xSleep = uringSleep;
+	uringVfs.xCurrentTime = uringCurrentTime;
+	uringVfs.xGetLastError = uringGetLastError;
+	if (uringVfs.iVersion >= 2) uringVfs.xCurrentTimeInt64 = uringCurrentTimeInt64;
+	return sqlite3_vfs_register(&uringVfs, config.makeDefault ? 1 : 0) == SQLITE_OK;
+}
+
+#else
+
+bool momo::registerUringVFS(const UringConfig&)
+{
+	return false;
+}
+
+#endif
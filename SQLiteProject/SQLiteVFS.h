@@ -0,0 +1,48 @@
+#pragma once
+
+#include "sqlite3.h"
+#include <cstddef>
+
+namespace momo
+{
+	/*
+	name of VFS registered by registerUringVFS()
+	can be passed to SQLite3::open using OpenOptions::vfs
+	*/
+	extern const char* const URING_VFS;
+
+	/*
+	configuration of io_uring VFS
+	*/
+	struct UringConfig
+	{
+		/*
+		size of each of two read-ahead windows in bytes
+		*/
+		size_t readAheadSize = 128 * 1024;
+
+		/*
+		number of consecutive sequential reads of database file after which read-ahead starts
+		*/
+		int sequentialThreshold = 2;
+
+		/*
+		makes VFS default for all databases opened without explicit VFS
+		*/
+		bool makeDefault = false;
+	};
+
+	/*
+	registers VFS shim over default VFS which reads main database files through Linux io_uring.
+	When database file is read sequentially (table scans), next pages are read ahead asynchronously
+	into two windows, so disk works while SQLite processes current pages. Writes, locks and
+	journal / WAL files are passed to default VFS unchanged.
+
+	Shim keeps one extra read-only descriptor per database file, which is closed when the last
+	connection to the file is closed. As closing a descriptor releases POSIX locks of the process,
+	the same file must not be opened with URING_VFS and another VFS in one process at the same time.
+
+	returns true on success, false if io_uring is not available (non-Linux system or old kernel)
+	*/
+	bool registerUringVFS(const UringConfig& config = UringConfig());
+}
@@ -0,0 +1,383 @@
+#include "SQLiteWriteQueue.h"
+
+momo::detail::WriteJobQueue::WriteJobQueue()
+	: _head(&_stub), _tail(&_stub)
+{
+	_stub.next = nullptr;
+}
+
+void momo::detail::WriteJobQueue::push(WriteJob* job)
+{
+	job->next.store(nullptr, std::memory_order_relaxed);
+	WriteJob* previous = _head.exchange(job);
+	previous->next.store(job, std::memory_order_release);
+}
+
+momo::detail::WriteJob* momo::detail::WriteJobQueue::pop()
+{
+	WriteJob* tail = _tail;
+	WriteJob* next = tail->next.load(std::memory_order_acquire);
+	if (tail == &_stub)
+	{
+		if (next == nullptr) return nullptr;
+		_tail = next;
+		tail = next;
+		next = next->next.load(std::memory_order_acquire);
+	}
+	if (next != nullptr)
+	{
+		_tail = next;
+		return tail;
+	}
+	// last job can be taken only after stub is pushed behind it
+	if (tail != _head.load()) return nullptr;
+	push(&_stub);
+	next = tail->next.load(std::memory_order_acquire);
+	if (next == nullptr) return nullptr;
+	_tail = next;
+	return tail;
+}
+
+bool momo::detail::WriteJobQueue::empty() const
+{
+	WriteJob* tail = _tail;
+	return tail->next.load(std::memory_order_acquire) == nullptr && _head.load() == tail;
+}
+
+momo::WriteQueue::WriteQueue(const std::string& name, const WriteQueueConfig& config)
+	: _name(name), _config(config), _running(false), _stopped(true), _producers(0), _sleeping(false),
+	_blocked(0), _queuedJobs(0), _queuedBytes(0), _rejectedJobs(0), _droppedJobs(0), _blockedSubmits(0),
+	_lastCommitLag(0), _maxCommitLag(0), _committedJobs(0), _failedJobs(0), _batches(0), _maxBatchSize(0)
+{
+	if (_config.maxBatchSize == 0) _config.maxBatchSize = 1;
+	if (_config.maxQueuedJobs == 0) _config.maxQueuedJobs = 1;
+}
+
+bool momo::WriteQueue::start()
+{
+	if (_running) return true;
+	_connection.setBusyPolicy(_config.busy);
+	if (!_connection.open(_name, _config.open))
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_errorMessage = _connection.getErrorMessage();
+		return false;
+	}
+	_committedJobs = 0;
+	_failedJobs = 0;
+	_batches = 0;
+	_maxBatchSize = 0;
+	_rejectedJobs = 0;
+	_droppedJobs = 0;
+	_blockedSubmits = 0;
+	_lastCommitLag = 0;
+	_maxCommitLag = 0;
+	_stopped = false;
+	_running = true;
+	_thread = std::thread(&WriteQueue::run, this);
+	return true;
+}
+
+void momo::WriteQueue::stop()
+{
+	if (!_running.exchange(false)) return;
+	{
+		// wake producers blocked by full queue, they see queue stopped
+		std::lock_guard<std::mutex> lock(_spaceMutex);
+		_space.notify_all();
+	}
+	// jobs of producers which saw queue running must be pushed before writer drains the queue
+	while (_producers.load() != 0) std::this_thread::yield();
+	_stopped = true;
+	notify();
+	_thread.join();
+	_connection.close();
+}
+
+std::future<bool> momo::WriteQueue::push(detail::WriteJob* job)
+{
+	std::future<bool> result = job->promise.get_future();
+	job->size = sizeof(detail::WriteJob);
+	for (const auto& command : job->commands)
+	{
+		job->size += command.first.size();
+		for (const Value& parameter : command.second)
+			job->size += sizeof(Value) + parameter.asText().size();
+	}
+
+	_producers.fetch_add(1);
+	if (!_running.load() || !admit(job))
+	{
+		_producers.fetch_sub(1);
+		job->promise.set_value(false);
+		delete job;
+		return result;
+	}
+	job->submitted = std::chrono::steady_clock::now();
+	_queue.push(job);
+	_producers.fetch_sub(1);
+	if (_sleeping.load()) notify();
+	return result;
+}
+
+bool momo::WriteQueue::admit(detail::WriteJob* job)
+{
+	while (!reserve(job->size))
+	{
+		switch (_config.overflowPolicy)
+		{
+		case REJECT:
+			_rejectedJobs.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		case DROP_OLDEST:
+			// queue may look full while other producers are pushing jobs they reserved room for
+			if (!dropOldest()) std::this_thread::yield();
+			break;
+		case BLOCK:
+		{
+			_blockedSubmits.fetch_add(1, std::memory_order_relaxed);
+			std::unique_lock<std::mutex> lock(_spaceMutex);
+			_blocked.fetch_add(1);
+			bool reserved = false;
+			while (_running.load() && !(reserved = reserve(job->size, true))) _space.wait(lock);
+			_blocked.fetch_sub(1);
+			return reserved;
+		}
+		}
+	}
+	return true;
+}
+
+bool momo::WriteQueue::reserve(size_t size, bool locked)
+{
+	size_t jobs = _queuedJobs.load();
+	do
+	{
+		if (jobs >= _config.maxQueuedJobs) return false;
+	} while (!_queuedJobs.compare_exchange_weak(jobs, jobs + 1));
+
+	size_t bytes = _queuedBytes.fetch_add(size);
+	if (bytes != 0 && bytes + size > _config.maxQueuedBytes)
+	{
+		release(size, locked);
+		return false;
+	}
+	return true;
+}
+
+void momo::WriteQueue::release(size_t size, bool locked)
+{
+	_queuedBytes.fetch_sub(size);
+	_queuedJobs.fetch_sub(1);
+	// blocked producer either sees released room or is waiting when notified
+	if (_blocked.load() == 0) return;
+	if (locked)
+	{
+		_space.notify_all();
+		return;
+	}
+	std::lock_guard<std::mutex> lock(_spaceMutex);
+	_space.notify_all();
+}
+
+bool momo::WriteQueue::dropOldest()
+{
+	detail::WriteJob* job = take();
+	if (job == nullptr) return false;
+	_droppedJobs.fetch_add(1, std::memory_order_relaxed);
+	job->promise.set_value(false);
+	delete job;
+	return true;
+}
+
+momo::detail::WriteJob* momo::WriteQueue::take()
+{
+	detail::WriteJob* job;
+	{
+		std::lock_guard<std::mutex> lock(_popMutex);
+		job = _queue.pop();
+	}
+	if (job != nullptr) release(job->size);
+	return job;
+}
+
+bool momo::WriteQueue::isEmpty()
+{
+	std::lock_guard<std::mutex> lock(_popMutex);
+	return _queue.empty();
+}
+
+void momo::WriteQueue::notify()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_wakeup.notify_one();
+}
+
+std::future<bool> momo::WriteQueue::submit(std::string SQL)
+{
+	auto job = new detail::WriteJob();
+	job->commands.emplace_back(std::move(SQL), std::vector<Value>());
+	return push(job);
+}
+
+std::future<bool> momo::WriteQueue::submit(std::string SQL, std::vector<Value> parameters)
+{
+	auto job = new detail::WriteJob();
+	job->commands.emplace_back(std::move(SQL), std::move(parameters));
+	return push(job);
+}
+
+std::future<bool> momo::WriteQueue::submit(const SQLBuilder<OPERATION::DELETE>& sql)
+{
+	return submit(sql, sql.parameters());
+}
+
+std::future<bool> momo::WriteQueue::submit(const SQLBuilder<OPERATION::INSERT>& sql)
+{
+	if (sql.parameters().empty()) return submit(std::string(sql));
+	auto job = new detail::WriteJob();
+	job->commands = sql.statements();
+	return push(job);
+}
+
+bool momo::WriteQueue::wait(std::chrono::steady_clock::time_point deadline)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		_sleeping = true;
+		// producer either sees writer sleeping or its job is seen here
+		if (!isEmpty() || _stopped.load()) break;
+		if (_wakeup.wait_until(lock, deadline) == std::cv_status::timeout) break;
+	}
+	_sleeping = false;
+	return !isEmpty();
+}
+
+void momo::WriteQueue::run()
+{
+	std::vector<detail::WriteJob*> batch;
+	batch.reserve(_config.maxBatchSize);
+	while (true)
+	{
+		// all jobs are pushed before queue is stopped, so flag is read before the queue
+		bool stopped = _stopped.load();
+		detail::WriteJob* job = take();
+		if (job == nullptr)
+		{
+			if (!isEmpty())
+			{
+				// producer is in the middle of push
+				std::this_thread::yield();
+				continue;
+			}
+			if (stopped) break;
+			wait(std::chrono::steady_clock::now() + std::chrono::seconds(1));
+			continue;
+		}
+
+		batch.push_back(job);
+		auto deadline = std::chrono::steady_clock::now() + _config.maxLatency;
+		while (batch.size() < _config.maxBatchSize)
+		{
+			job = take();
+			if (job != nullptr)
+			{
+				batch.push_back(job);
+				continue;
+			}
+			if (!isEmpty()) std::this_thread::yield();
+			else if (_stopped.load() || !wait(deadline)) break;
+		}
+		commit(batch);
+		batch.clear();
+	}
+}
+
+void momo::WriteQueue::commit(std::vector<detail::WriteJob*>& batch)
+{
+	bool committed = _connection.writeTransaction([&batch](Transaction& transaction)
+	{
+		SQLite3& database = transaction.database();
+		for (detail::WriteJob* job : batch)
+		{
+			if (!transaction.execute("SAVEPOINT momo_job;")) return;
+			job->result = true;
+			for (const auto& command : job->commands)
+			{
+				job->result = command.second.empty() ? database.execute(command.first) : database.execute(command.first, command.second);
+				if (!job->result) break;
+			}
+			if (!job->result)
+			{
+				int code = database.getErrorCode() & 0xff;
+				// lock errors are retried by replaying the whole batch
+				if (code == SQLITE_BUSY || code == SQLITE_LOCKED)
+				{
+					transaction.check(false);
+					return;
+				}
+				if (!transaction.execute("ROLLBACK TO momo_job;")) return;
+			}
+			if (!transaction.execute("RELEASE momo_job;")) return;
+		}
+	}, _config.transaction);
+
+	if (!committed)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_errorMessage = _connection.getErrorMessage();
+	}
+	else
+	{
+		auto oldest = batch.front()->submitted;
+		for (detail::WriteJob* job : batch)
+			if (job->submitted < oldest) oldest = job->submitted;
+		std::int64_t lag = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - oldest).count();
+		_lastCommitLag.store(lag, std::memory_order_relaxed);
+		std::int64_t maxLag = _maxCommitLag.load(std::memory_order_relaxed);
+		while (lag > maxLag && !_maxCommitLag.compare_exchange_weak(maxLag, lag, std::memory_order_relaxed));
+
+		_batches.fetch_add(1, std::memory_order_relaxed);
+		std::uint64_t size = batch.size();
+		std::uint64_t maxSize = _maxBatchSize.load(std::memory_order_relaxed);
+		while (size > maxSize && !_maxBatchSize.compare_exchange_weak(maxSize, size, std::memory_order_relaxed));
+	}
+
+	for (detail::WriteJob* job : batch)
+	{
+		bool result = committed && job->result;
+		if (result) _committedJobs.fetch_add(1, std::memory_order_relaxed);
+		else _failedJobs.fetch_add(1, std::memory_order_relaxed);
+		job->promise.set_value(result);
+		delete job;
+	}
+}
+
+momo::WriteQueueStatistics momo::WriteQueue::getStatistics() const
+{
+	WriteQueueStatistics statistics;
+	statistics.committedJobs = _committedJobs;
+	statistics.failedJobs = _failedJobs;
+	statistics.batches = _batches;
+	statistics.maxBatchSize = _maxBatchSize;
+	statistics.queuedJobs = _queuedJobs;
+	statistics.queuedBytes = _queuedBytes;
+	statistics.rejectedJobs = _rejectedJobs;
+	statistics.droppedJobs = _droppedJobs;
+	statistics.blockedSubmits = _blockedSubmits;
+	statistics.lastCommitLag = std::chrono::microseconds(_lastCommitLag.load());
+	statistics.maxCommitLag = std::chrono::microseconds(_maxCommitLag.load());
+	return statistics;
+}
+
+std::string momo::WriteQueue::getErrorMessage() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _errorMessage;
+}
+
+momo::WriteQueue::~WriteQueue()
+{
+	stop();
+}
@@ -0,0 +1,291 @@
+#pragma once
+
+#include "SQLite.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace momo
+{
+	/*
+	enum of policies applied by WriteQueue when a job does not fit into the queue
+	*/
+	enum OVERFLOW_POLICY
+	{
+		/*
+		submit() waits until writer takes enough jobs from the queue
+		*/
+		BLOCK,
+
+		/*
+		submit() returns future completed with false immediately
+		*/
+		REJECT,
+
+		/*
+		oldest queued jobs are removed (their futures are completed with false) to make room for the new job
+		*/
+		DROP_OLDEST,
+	};
+
+	/*
+	configuration of WriteQueue
+	*/
+	struct WriteQueueConfig
+	{
+		/*
+		maximal number of jobs committed in one transaction
+		*/
+		size_t maxBatchSize = 128;
+
+		/*
+		maximal time writer waits for more jobs after the first job of a batch arrived
+		larger values give bigger batches (less commits), but increase latency of each write
+		*/
+		std::chrono::microseconds maxLatency = std::chrono::milliseconds(1);
+
+		/*
+		maximal number of jobs and bytes (SQL text, parameters and job itself) waiting in the queue
+		job larger than maxQueuedBytes is accepted only into empty queue
+		*/
+		size_t maxQueuedJobs = 10000;
+		size_t maxQueuedBytes = 64 * 1024 * 1024;
+
+		/*
+		what submit() does when queue is full
+		*/
+		OVERFLOW_POLICY overflowPolicy = BLOCK;
+
+		/*
+		options of writer connection
+		*/
+		OpenOptions open;
+
+		/*
+		busy policy of writer connection and retry policy of its transactions
+		*/
+		BusyPolicy busy;
+		TransactionPolicy transaction;
+	};
+
+	/*
+	counters of WriteQueue collected since start()
+	*/
+	struct WriteQueueStatistics
+	{
+		/*
+		jobs committed successfully
+		*/
+		std::uint64_t committedJobs;
+
+		/*
+		jobs which failed (their changes were rolled back, other jobs of the batch are committed)
+		*/
+		std::uint64_t failedJobs;
+
+		/*
+		number of transactions committed by writer, and the largest number of jobs in one of them
+		*/
+		std::uint64_t batches;
+		std::uint64_t maxBatchSize;
+
+		/*
+		jobs and bytes currently waiting in the queue (not taken by writer yet)
+		*/
+		std::uint64_t queuedJobs;
+		std::uint64_t queuedBytes;
+
+		/*
+		jobs refused by REJECT policy or removed by DROP_OLDEST policy, and submits which waited because of BLOCK policy
+		*/
+		std::uint64_t rejectedJobs;
+		std::uint64_t droppedJobs;
+		std::uint64_t blockedSubmits;
+
+		/*
+		time from submit() of the oldest job of a batch to commit of the batch: of the last batch and maximal one
+		*/
+		std::chrono::microseconds lastCommitLag;
+		std::chrono::microseconds maxCommitLag;
+	};
+
+	namespace detail
+	{
+		struct WriteJob
+		{
+			std::atomic<WriteJob*> next;
+
+			/*
+			SQL commands of the job with values bound to their parameters, run in order in one savepoint
+			*/
+			std::vector<std::pair<std::string, std::vector<Value>>> commands;
+			std::promise<bool> promise;
+			bool result = false;
+			size_t size = 0;
+			std::chrono::steady_clock::time_point submitted;
+		};
+
+		/*
+		intrusive multi-producer single-consumer queue (D. Vyukov). push never blocks or locks,
+		pop may be called only from one thread
+		*/
+		class WriteJobQueue
+		{
+			std::atomic<WriteJob*> _head;
+			WriteJob* _tail;
+			WriteJob _stub;
+		public:
+			WriteJobQueue();
+
+			WriteJobQueue(const WriteJobQueue&) = delete;
+			WriteJobQueue& operator=(const WriteJobQueue&) = delete;
+
+			void push(WriteJob* job);
+
+			/*
+			returns oldest job, or nullptr if queue is empty or a producer has not finished push yet
+			*/
+			WriteJob* pop();
+
+			/*
+			returns true if there are no jobs and no push in progress, false either
+			*/
+			bool empty() const;
+		};
+	}
+
+	/*
+	single writer which commits write jobs of many threads in shared transactions (group commit).
+	Jobs are passed through lock-free queue to a writer thread with its own connection.
+	Writer takes jobs until maxBatchSize jobs are collected or maxLatency passes, and runs them in one
+	write transaction, each job in its own SAVEPOINT, so a failed job does not roll back the others.
+	Future of each job is completed after the transaction is committed: true if the job was committed,
+	false if it failed. With synchronous=FULL (SQLite default) commit is durable when future completes.
+	Queue is bounded by maxQueuedJobs / maxQueuedBytes, overflowPolicy decides what happens to producers
+	when writer cannot keep up, so bursts slow producers down instead of growing memory.
+
+	example:
+	WriteQueue queue("myDB.dblite");
+	queue.start();
+	auto done = queue.submit(SQLBuilder<INSERT>("COMPANY", "ID, NAME, AGE").addRow({ 1, "Paul", 32 }));
+	done.get();
+	*/
+	class WriteQueue
+	{
+		std::string _name;
+		WriteQueueConfig _config;
+		SQLite3 _connection;
+		detail::WriteJobQueue _queue;
+		std::thread _thread;
+		std::atomic<bool> _running;
+		std::atomic<bool> _stopped;
+		std::atomic<int> _producers;
+		std::atomic<bool> _sleeping;
+		mutable std::mutex _mutex;
+		std::condition_variable _wakeup;
+		std::mutex _popMutex;
+		std::mutex _spaceMutex;
+		std::condition_variable _space;
+		std::atomic<int> _blocked;
+		std::atomic<size_t> _queuedJobs;
+		std::atomic<size_t> _queuedBytes;
+		std::atomic<std::uint64_t> _rejectedJobs;
+		std::atomic<std::uint64_t> _droppedJobs;
+		std::atomic<std::uint64_t> _blockedSubmits;
+		std::atomic<std::int64_t> _lastCommitLag;
+		std::atomic<std::int64_t> _maxCommitLag;
+		std::atomic<std::uint64_t> _committedJobs;
+		std::atomic<std::uint64_t> _failedJobs;
+		std::atomic<std::uint64_t> _batches;
+		std::atomic<std::uint64_t> _maxBatchSize;
+		std::string _errorMessage;
+
+		std::future<bool> push(detail::WriteJob* job);
+		void notify();
+
+		/*
+		reserves room for job according to overflow policy, returns false if job is not accepted
+		*/
+		bool admit(detail::WriteJob* job);
+		bool reserve(size_t size, bool locked = false);
+
+		/*
+		returns room of job to the queue and wakes blocked producers, locked is true if _spaceMutex is held by caller
+		*/
+		void release(size_t size, bool locked = false);
+
+		/*
+		removes oldest job from the queue and completes it with false, returns false if there was no job to remove
+		*/
+		bool dropOldest();
+
+		/*
+		pops job from the queue. Queue is popped by writer and by producers with DROP_OLDEST policy
+		*/
+		detail::WriteJob* take();
+		bool isEmpty();
+
+		/*
+		waits until queue has a job or deadline passes, returns false if queue is still empty
+		*/
+		bool wait(std::chrono::steady_clock::time_point deadline);
+		void run();
+		void commit(std::vector<detail::WriteJob*>& batch);
+	public:
+		/*
+		creates queue writing to database with name provided
+		*/
+		WriteQueue(const std::string& name, const WriteQueueConfig& config = WriteQueueConfig());
+
+		WriteQueue(const WriteQueue&) = delete;
+		WriteQueue& operator=(const WriteQueue&) = delete;
+
+		/*
+		opens writer connection and starts writer thread
+		returns true on success, false on failure (see getErrorMessage())
+		*/
+		bool start();
+
+		/*
+		commits all submitted jobs and stops writer thread
+		automatically called in the destructor
+		*/
+		void stop();
+
+		/*
+		adds SQL command to the queue. Can be called from any thread
+		if queue is not running or job is rejected by overflow policy, returned future is completed with false immediately
+		with BLOCK policy call waits while queue is full
+		*/
+		std::future<bool> submit(std::string SQL);
+
+		/*
+		adds SQL command with parameters ?1, ?2, ... bound to values provided
+		array values are not copied and must stay alive until future is completed
+		*/
+		std::future<bool> submit(std::string SQL, std::vector<Value> parameters);
+
+		/*
+		adds DELETE command together with its bound parameters
+		*/
+		std::future<bool> submit(const SQLBuilder<OPERATION::DELETE>& sql);
+
+		/*
+		adds INSERT command together with its bound parameters
+		*/
+		std::future<bool> submit(const SQLBuilder<OPERATION::INSERT>& sql);
+
+		WriteQueueStatistics getStatistics() const;
+
+		/*
+		returns error message of writer connection, set when start() or a commit fails
+		*/
+		std::string getErrorMessage() const;
+
+		~WriteQueue();
+	};
+}
@@ -1,83 +1,189 @@
-#include <iostream>
-#include "SQLite.h"
-
-static int callback(void *data, int argc, char **argv, char **azColName)
-{
-	int i;
-	fprintf(stderr, "%s: ", (const char*)data);
-
-	for (i = 0; i < argc; i++) {
-		printf("%s = %s\n", azColName[i], argv[i] ? argv[i] : "NULL");
-	}
-
-	printf("\n");
-	return 0;
-}
-
-using namespace momo;
-
-int main() 
-{
-	SQLite3 database;
-	database.open("sampleSQLiteDB.dblite");
-	 
-	SQLBuilder<OPERATION::CREATE> sqlCreate("COMPANY");
-	sqlCreate
-		.addColumn("ID", INT, NOT_NULL, PRIMARY_KEY)
-		.addColumn("NAME", TEXT, NOT_NULL)
-		.addColumn("AGE", INT, NOT_NULL)
-		.addColumn("ADDRESS", "VARCHAR(10)")
-		.addColumn("SALARY", REAL);
-
-	database << sqlCreate;
-	if (!database.success())
-	{
-		std::cout << "error while creating table: " << database.getErrorMessage() << std::endl;
-	}
-
-	SQLBuilder<OPERATION::INSERT> sqlInsert(sqlCreate.tableName, "ID, NAME, AGE, ADDRESS, SALARY");
-	sqlInsert
-		.addValues(pack(0, "Allen", 25, "Texas", 15000.00))
-		.addValues(pack(1, "Teddy", 23, "Norway", 20000.0))
-		.addValues(pack(2, "Mark", 25, "Rich-Mond", 65000.00))
-		.addValues(pack(3, "Paul", 32, "Califonia", 20000.0))
-		.addValues(pack(4, "Alex", 16, "Moscow", 10000.00))
-		.addValues(pack(5, "Harry", 25, "Boston", 40000));
-
-	database << sqlInsert;
-	if (!database.success())
-	{
-		std::cout << database.getErrorMessage() << std::endl;
-	}
-	SQLBuilder<OPERATION::SELECT> select(sqlCreate.tableName);
-
-	//sqlCreate.tableName = "MY_DB";
-	SQLBuilder<OPERATION::ALTER> sqlAlter(sqlCreate.tableName);
-	sqlAlter
-		.renameColumn("SALARY", "MONTH_PAYOFF")
-		.renameColumn("ADDRESS", "HOME");
-
-	database << sqlAlter;
-	if (!database.success())
-	{
-		std::cout << database.getErrorMessage() << std::endl;
-	}
-
-	SQLBuilder<OPERATION::DELETE> sqlDelete(sqlCreate.tableName);
-	sqlDelete.where("ID < 2").where("MONTH_PAYOFF < 20000");
-	database << sqlDelete;
-
-	SQLBuilder<OPERATION::SELECT> sqlSelect(sqlCreate.tableName);
-	sqlSelect.callback = callback;
-
-	database << sqlSelect;
-	if (!database.success())
-	{
-		std::cout << database.getErrorMessage() << std::endl;
-	}
-	SQLBuilder<OPERATION::DROP> sqlDrop(sqlCreate.tableName);
-	database.execute(sqlDrop);
-	database.close();
-	system("pause");
-	return 0;
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "SQLite.h"
+#include "SQLiteVFS.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static int callback(void *data, int argc, char **argv, char **azColName)
+{
+	int i;
+	fprintf(stderr, "%s: ", (const char*)data);
+
+	for (i = 0; i < argc; i++) {
+		printf("%s = %s\n", azColName[i], argv[i] ? argv[i] : "NULL");
+	}
+
+	printf("\n");
+	return 0;
+}
+
+using namespace momo;
+
+/*
+drops pages of file from OS page cache where it is supported, so scans read from disk
+*/
+static void dropFileCache(const char* filename)
+{
+#if defined(__linux__)
+	int file = ::open(filename, O_RDONLY);
+	if (file < 0) return;
+	fdatasync(file);
+	posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+	::close(file);
+#else
+	(void)filename;
+#endif
+}
+
+/*
+scans table of benchmark database through VFS provided (empty for default) and prints throughput
+returns best time of `runs` scans in seconds, negative value on error
+*/
+static double scanBenchmark(const char* filename, const std::string& vfs, int runs)
+{
+	double best = -1.0;
+	for (int run = 0; run < runs; run++)
+	{
+		dropFileCache(filename);
+		SQLite3 database;
+		OpenOptions options;
+		options.flags = SQLITE_OPEN_READONLY;
+		options.vfs = vfs;
+		if (!database.open(filename, options))
+		{
+			std::cout << "cannot open " << filename << ": " << database.getErrorMessage() << std::endl;
+			return -1.0;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		Statement scan;
+		sqlite3_int64 bytes = 0;
+		database.prepare("SELECT sum(length(PAYLOAD)) FROM BENCH;", scan);
+		if (scan.step()) bytes = scan.column(0).asInteger();
+		if (!scan.success())
+		{
+			std::cout << "scan failed: " << scan.getErrorMessage() << std::endl;
+			return -1.0;
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (best < 0.0 || seconds < best) best = seconds;
+		std::cout << (vfs.empty() ? "default" : vfs) << " run " << run + 1 << ": " << seconds * 1000.0 << " ms, "
+			<< bytes / seconds / (1024.0 * 1024.0) << " MB/s" << std::endl;
+	}
+	return best;
+}
+
+/*
+compares sequential scan throughput of io_uring VFS with default VFS
+usage: SQLiteProject --bench-scan [database file] [rows]
+database is created with `rows` rows of 1 KB if it has no benchmark table
+*/
+static int runScanBenchmark(int argc, char* argv[])
+{
+	const char* filename = argc > 2 ? argv[2] : "scanBenchmark.dblite";
+	int rows = argc > 3 ? atoi(argv[3]) : 200000;
+	const int runs = 3;
+
+	{
+		SQLite3 database;
+		database.open(filename);
+		if (!database.execute("SELECT 1 FROM BENCH LIMIT 1;"))
+		{
+			std::cout << "creating " << rows << " rows in " << filename << std::endl;
+			database.execute("CREATE TABLE BENCH(ID INTEGER PRIMARY KEY, PAYLOAD BLOB NOT NULL);") &&
+			database.execute("WITH RECURSIVE N(I) AS (SELECT 1 UNION ALL SELECT I + 1 FROM N WHERE I < ?1) "
+				"INSERT INTO BENCH(PAYLOAD) SELECT randomblob(1024) FROM N;", { rows });
+		}
+		if (!database.success())
+		{
+			std::cout << "cannot create benchmark database: " << database.getErrorMessage() << std::endl;
+			return 1;
+		}
+	}
+
+	double defaultTime = scanBenchmark(filename, "", runs);
+	if (!registerUringVFS())
+	{
+		std::cout << "io_uring VFS is not available" << std::endl;
+		return defaultTime < 0.0 ? 1 : 0;
+	}
+	double uringTime = scanBenchmark(filename, URING_VFS, runs);
+	if (defaultTime < 0.0 || uringTime < 0.0) return 1;
+	std::cout << "io_uring speedup: " << defaultTime / uringTime << "x" << std::endl;
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && strcmp(argv[1], "--bench-scan") == 0)
+		return runScanBenchmark(argc, argv);
+
+	SQLite3 database;
+	database.open("sampleSQLiteDB.dblite");
+	 
+	SQLBuilder<OPERATION::CREATE> sqlCreate("COMPANY");
+	sqlCreate
+		.addColumn("ID", INT, NOT_NULL, PRIMARY_KEY)
+		.addColumn("NAME", TEXT, NOT_NULL)
+		.addColumn("AGE", INT, NOT_NULL)
+		.addColumn("ADDRESS", "VARCHAR(10)")
+		.addColumn("SALARY", REAL);
+
+	database << sqlCreate;
+	if (!database.success())
+	{
+		std::cout << "error while creating table: " << database.getErrorMessage() << std::endl;
+	}
+
+	SQLBuilder<OPERATION::INSERT> sqlInsert(sqlCreate.tableName, "ID, NAME, AGE, ADDRESS, SALARY");
+	sqlInsert
+		.addValues(pack(0, "Allen", 25, "Texas", 15000.00))
+		.addValues(pack(1, "Teddy", 23, "Norway", 20000.0))
+		.addValues(pack(2, "Mark", 25, "Rich-Mond", 65000.00))
+		.addValues(pack(3, "Paul", 32, "Califonia", 20000.0))
+		.addValues(pack(4, "Alex", 16, "Moscow", 10000.00))
+		.addValues(pack(5, "Harry", 25, "Boston", 40000));
+
+	database << sqlInsert;
+	if (!database.success())
+	{
+		std::cout << database.getErrorMessage() << std::endl;
+	}
+	SQLBuilder<OPERATION::SELECT> select(sqlCreate.tableName);
+
+	//sqlCreate.tableName = "MY_DB";
+	SQLBuilder<OPERATION::ALTER> sqlAlter(sqlCreate.tableName);
+	sqlAlter
+		.renameColumn("SALARY", "MONTH_PAYOFF")
+		.renameColumn("ADDRESS", "HOME");
+
+	database << sqlAlter;
+	if (!database.success())
+	{
+		std::cout << database.getErrorMessage() << std::endl;
+	}
+
+	SQLBuilder<OPERATION::DELETE> sqlDelete(sqlCreate.tableName);
+	sqlDelete.where("ID < 2").where("MONTH_PAYOFF < 20000");
+	database << sqlDelete;
+
+	SQLBuilder<OPERATION::SELECT> sqlSelect(sqlCreate.tableName);
+	sqlSelect.callback = callback;
+
+	database << sqlSelect;
+	if (!database.success())
+	{
+		std::cout << database.getErrorMessage() << std::endl;
+	}
+	SQLBuilder<OPERATION::DROP> sqlDrop(sqlCreate.tableName);
+	database.execute(sqlDrop);
+	database.close();
+	system("pause");
+	return 0;
 }
\ No newline at end of file